@@ -2,11 +2,16 @@
 #include "Model.h"
 #include "Utility.h"
 #include "Group.h"
+#include "Snapshot.h"
+#include "Profiler.h"
+#include "Event_log.h"
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include <cassert>
 
 using std::string;
+using std::vector;
 using std::cout; using std::endl;
 using std::shared_ptr; using std::static_pointer_cast;
 using std::for_each; using std::find; using std::any_of;
@@ -14,7 +19,8 @@ using std::for_each; using std::find; using std::any_of;
 const double kAGENT_INITIAL_SPEED = 5.0;
 
 Agent::Agent(const string& name_, const Point& location_, int start_health_)
-    : Sim_object(name_), m_moving_obj(location_, kAGENT_INITIAL_SPEED),
+    : Sim_object(name_),
+    m_moving_obj(Model::get_instance()->get_movement_system(), this, location_, kAGENT_INITIAL_SPEED),
     m_health(start_health_), m_alive_state(Alive_State::ALIVE)
 {
 }
@@ -31,14 +37,19 @@ bool Agent::is_moving() const {
     return m_moving_obj.is_currently_moving();
 }
 
+double Agent::get_speed() const {
+    return m_moving_obj.get_current_speed();
+}
+
 void Agent::move_to(const Point& destination_) {
     m_moving_obj.start_moving(destination_);
 
     if (m_moving_obj.is_currently_moving()) {
-        cout << get_name() << ": I'm on the way" << endl;
+        LOG_EVENT(MOVEMENT, INFO) << get_name() << ": I'm on the way" << endl;
+        wake();
     }
     else {
-        cout << get_name() << ": I'm already there" << endl;
+        LOG_EVENT(MOVEMENT, INFO) << get_name() << ": I'm already there" << endl;
     }
 }
 
@@ -50,7 +61,7 @@ void Agent::stop() {
 
     // otherwise, stop moving and print message
     m_moving_obj.stop_moving();
-    cout << get_name() << ": I'm stopped" << endl;
+    LOG_EVENT(MOVEMENT, INFO) << get_name() << ": I'm stopped" << endl;
 }
 
 // calculate loss of health due to hit.
@@ -64,20 +75,29 @@ void Agent::lose_health(int attack_strength) {
         // Agent was killed, set Agent to dead state
         m_alive_state = Alive_State::DEAD;
         m_moving_obj.stop_moving();
-        cout << get_name() << ": Arrggh!" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Arrggh!" << endl;
+
+        // let each Group know it has a dead member, the Groups are released
+        // so that no Group is kept alive by a dead member
+        vector<shared_ptr<Group>> groups;
+        groups.swap(m_groups);
+        for (auto& group_ptr : groups) {
+            group_ptr->member_died();
+        }
 
         // notify Model to remove Agent from simulation
-        Model::get_instance()->notify_gone(get_name());
+        Model::get_instance()->notify_gone(get_id());
         Model::get_instance()->remove_agent(static_pointer_cast<Agent>(shared_from_this()));
     }
     else {
         // Acknowledge damage and notify of Model of updated health
-        cout << get_name() << ": Ouch!" << endl;
-        Model::get_instance()->notify_health(get_name(), static_cast<double>(m_health));
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Ouch!" << endl;
+        Model::get_instance()->notify_health(get_id(), static_cast<double>(m_health));
     }
 }
 
 void Agent::take_hit(int attack_strength, shared_ptr<Agent> attacker_ptr) {
+    PROFILE_COUNT(HITS_TAKEN);
     lose_health(attack_strength);
 }
 
@@ -86,21 +106,45 @@ void Agent::update() {
     // Should never update dead Agent
     assert(m_alive_state == Alive_State::ALIVE);
 
-    if (m_moving_obj.is_currently_moving()) {
-        // update position and have Model notify View
-        bool has_arrived = m_moving_obj.update_location();
-
-        Model::get_instance()->notify_location(get_name(), get_location());
+    // update position and have Model notify View
+    bool has_arrived = false;
+    if (m_moving_obj.advance(has_arrived)) {
+        Model::get_instance()->update_agent_location(this);
+        Model::get_instance()->notify_location(get_id(), get_location());
 
         if (has_arrived) {
-            cout << get_name() << ": I'm there!" << endl;
+            LOG_EVENT(MOVEMENT, INFO) << get_name() << ": I'm there!" << endl;
         }
         else {
-            cout << get_name() << ": step..." << endl;
+            LOG_EVENT(MOVEMENT, DEBUG) << get_name() << ": step..." << endl;
         }
     }
 }
 
+bool Agent::is_active() const {
+    return is_alive() && m_moving_obj.is_currently_moving();
+}
+
+int Agent::get_quiet_updates() const {
+    return is_alive() ? m_moving_obj.get_steps_before_arrival() : 0;
+}
+
+void Agent::fast_forward(int ticks_) {
+    assert(ticks_ <= get_quiet_updates() || !is_moving());
+
+    if (!is_moving() || ticks_ == 0) {
+        return;
+    }
+
+    m_moving_obj.skip_steps(ticks_);
+    Model::get_instance()->update_agent_location(this);
+    Model::get_instance()->notify_location(get_id(), get_location());
+}
+
+void Agent::wake() const {
+    Model::get_instance()->wake(get_id());
+}
+
 // output information about the current state
 void Agent::describe() const {
     cout << get_name() << " at " << m_moving_obj.get_current_location() << endl;
@@ -128,36 +172,53 @@ void Agent::describe() const {
 void Agent::broadcast_current_state() const {
     assert(m_alive_state == Alive_State::ALIVE);
     // Tell Views where agents are and their health
-    Model::get_instance()->notify_location(get_name(), get_location());
-    Model::get_instance()->notify_health(get_name(), static_cast<double>(m_health));
+    Model::get_instance()->notify_location(get_id(), get_location());
+    Model::get_instance()->notify_health(get_id(), static_cast<double>(m_health));
+}
+
+// Only living Agents are saved
+void Agent::save_state(Snapshot_writer& writer) const {
+    assert(m_alive_state == Alive_State::ALIVE);
+    writer.write_i32(m_health);
+    m_moving_obj.save_state(writer);
+}
+
+void Agent::restore_state(Snapshot_reader& reader) {
+    m_health = reader.read_i32();
+    if (m_health <= 0) {
+        throw Error("Snapshot file is corrupt!");
+    }
+    m_moving_obj.restore_state(reader);
 }
 
 /* Fat Interface for derived classes */
 // Prints message that Agent cant work
 void Agent::start_working(shared_ptr<Structure> dst, shared_ptr<Structure> src) {
-    cout << get_name() + ": Sorry, I can't work!" << endl;
+    LOG_EVENT(WORK, WARNING) << get_name() + ": Sorry, I can't work!" << endl;
 }
 
 // Prints message that an Agent cannot attack.
 void Agent::start_attacking(shared_ptr<Agent> target) {
-    cout << get_name() + ": Sorry, I can't attack!" << endl;
+    LOG_EVENT(COMBAT, WARNING) << get_name() + ": Sorry, I can't attack!" << endl;
 }
 
 // Jump Agent to target location
 void Agent::jump_to_location(const Point& target) {
     m_moving_obj.jump_to_location(target);
-    Model::get_instance()->notify_location(get_name(), get_location());
+    Model::get_instance()->update_agent_location(this);
+    Model::get_instance()->notify_location(get_id(), get_location());
 }
 
-// returns true if this Agent shares a group with the other Agent
-bool Agent::agents_share_group(shared_ptr<Agent> other_agent) {
+// returns true if this Agent shares a group with the other Agent, either
+// directly or through a Group that one of this Agent's Groups is nested in
+bool Agent::agents_share_group(shared_ptr<Agent> other_agent) const {
     // Unary predicate returns true if passed in group contains agent
     // used in construction.
     struct Group_has_agent_pred {
         Group_has_agent_pred(shared_ptr<Agent> agent) : mp_agent(agent)
         {}
 
-        bool operator()(shared_ptr<Group> group) { return group->is_agent_member(mp_agent); }
+        bool operator()(const shared_ptr<Group>& group) const { return group->is_agent_in_hierarchy(mp_agent); }
 
         shared_ptr<Agent> mp_agent;
     };
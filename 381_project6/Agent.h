@@ -31,8 +31,21 @@ public:
     // return this Agent's location
     Point get_location() const override;
 
+    // return the distance this Agent covers in one update while moving
+    double get_speed() const;
+
     // update the moving state and Agent state of this object.
     void update() override;
+    // an Agent has work to do while it is moving, derived classes add their own
+    bool is_active() const override;
+    // Returns how far an idle Agent looks for hostiles on each update, 0 if it
+    // does not. The Model only wakes an idle watching Agent when another Agent
+    // comes within this distance or group memberships shrink.
+    virtual double get_watch_range() const { return 0.0; }
+    // a moving Agent is quiet until the update in which it arrives
+    int get_quiet_updates() const override;
+    // take the steps at once, then have Model reindex and notify Views once
+    void fast_forward(int ticks_) override;
 
     // output information about the current state
     void describe() const override;
@@ -40,6 +53,11 @@ public:
     // ask Model to broadcast our current state to all Views
     void broadcast_current_state() const override;
 
+    // write the health and movement to a snapshot, and read them back,
+    // derived classes add their own state after the Agent's
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // tell this Agent to start moving to location destination_
     virtual void move_to(const Point& destination_);
 
@@ -60,7 +78,7 @@ public:
     virtual void start_attacking(std::shared_ptr<Agent>);
 
     // returns true if this Agent shares a group with the other Agent
-    bool agents_share_group(std::shared_ptr<Agent> other_agent);
+    bool agents_share_group(std::shared_ptr<Agent> other_agent) const;
 
     // Allow Agents to keep pointers to the groups they are members of.
     void add_to_my_groups(std::shared_ptr<Group> group_ptr);
@@ -77,6 +95,9 @@ protected:
     // Jump Agent to target location
     void jump_to_location(const Point& target);
 
+    // ask the Model to update this Agent again, called whenever it is given work
+    void wake() const;
+
 private:
     enum class Alive_State { ALIVE, DEAD };
 
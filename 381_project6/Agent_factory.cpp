@@ -6,28 +6,30 @@
 #include "Peasant.h"
 #include "Geometry.h"
 #include "Utility.h"
+#include "Pool_allocator.h"
 #include <string>
 #include <memory>
 
 using std::string;
-using std::shared_ptr; using std::make_shared;
+using std::shared_ptr; using std::allocate_shared;
 
 shared_ptr<Agent> create_agent(const string& name, const string& type, Point location) {
     shared_ptr<Agent> new_agent_ptr;
 
-    // Determine what type of Agent to create, throw Error if no such type
+    // Determine what type of Agent to create, throw Error if no such type;
+    // each type is allocated together with its control block from a pool of its own
     if (type == "Peasant") {
-        new_agent_ptr = make_shared<Peasant>(name, location);
+        new_agent_ptr = allocate_shared<Peasant>(Pool_allocator<Peasant>(), name, location);
     }
     else if (type == "Soldier") {
-        new_agent_ptr = make_shared<Soldier>(name, location);
+        new_agent_ptr = allocate_shared<Soldier>(Pool_allocator<Soldier>(), name, location);
     }
     else if (type == "Archer") {
-        new_agent_ptr = make_shared<Archer>(name, location);
+        new_agent_ptr = allocate_shared<Archer>(Pool_allocator<Archer>(), name, location);
     }
     else if (type == "Mage") {
         // TODO create the Mage bud
-        new_agent_ptr = make_shared<Mage>(name, location);
+        new_agent_ptr = allocate_shared<Mage>(Pool_allocator<Mage>(), name, location);
     }
     else {
         throw Error("Trying to create agent of unknown type!");
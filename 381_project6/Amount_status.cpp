@@ -3,18 +3,18 @@
 #include <string>
 
 using std::string;
-using std::cout; using std::endl;
+using std::ostream; using std::endl;
 
 Amount_status::Amount_status() : Status("amounts")
 {
 }
 
-void Amount_status::update_amount(const string& name, double amount) {
-    update_status(name, amount);
+void Amount_status::update_amount(Object_id_t id, double amount) {
+    update_status(id, amount);
 }
 
-void Amount_status::do_draw_header() {
-    cout << "Current Amounts:\n--------------" << endl;
+void Amount_status::do_draw_header(ostream& os) {
+    os << "Current Amounts:\n--------------" << endl;
 }
 
 
@@ -9,9 +9,9 @@ class Amount_status : public Status {
 public:
     explicit Amount_status();
 
-    // Updates an objects amount value, adds object name to container if the
+    // Updates an objects amount value, adds object id to container if the
     // object is not already there.
-    void update_amount(const std::string& name, double amount) override;
+    void update_amount(Object_id_t id, double amount) override;
 
     Amount_status(const Amount_status&) = delete;
     Amount_status& operator= (const Amount_status&) = delete;
@@ -20,5 +20,5 @@ public:
 
 private:
     //Hook for drawing
-    void do_draw_header() override;
+    void do_draw_header(std::ostream& os) override;
 };
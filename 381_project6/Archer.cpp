@@ -3,11 +3,12 @@
 #include "Model.h"
 #include "Utility.h"
 #include "Geometry.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 
 using std::string;
-using std::cout; using std::endl;
+using std::endl;
 using std::shared_ptr; using std::static_pointer_cast;
 
 
@@ -26,7 +27,7 @@ void Archer::attack_helper() {
     // Archer is attacking
     // if target is dead, report it, stop attacking and forget target
     if (!is_target_alive()) {
-        cout << get_name() << ": Target is dead" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Target is dead" << endl;
         stop_attacking();
         return;
     }
@@ -40,15 +41,8 @@ void Archer::attack_helper() {
     }
 
     // target is in range, aim to maim!
-    cout << get_name() << ": Twang!" << endl;
-    get_target().lock()->take_hit(kARCHER_INITIAL_STRENGTH,
-                                  static_pointer_cast<Agent>(shared_from_this()));
-
-    // If Archer killed the target, report it, stop attacking and forget target
-    if (!is_target_alive()) {
-        cout << get_name() << ": I triumph!" << endl;
-        stop_attacking();
-    }
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": Twang!" << endl;
+    hit_target(kARCHER_INITIAL_STRENGTH);
 }
 
 void Archer::do_update() {
@@ -98,7 +92,7 @@ void Archer::take_hit(int attack_strength, shared_ptr<Agent> attacker) {
     }
 
     // Run away!
-    cout << get_name() << ": I'm going to run away to " << closest_structure->get_name() << endl;
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": I'm going to run away to " << closest_structure->get_name() << endl;
     move_to(closest_structure->get_location());
 }
 
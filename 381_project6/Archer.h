@@ -27,6 +27,8 @@ private:
     void attack_helper();
     // returns Archer's attack range
     double get_range() const override;
+    // an idle Archer looks for hostiles within its range
+    double get_watch_range() const override { return get_range(); }
     // return string "Archer"
     const std::string& get_type_string() const override;
 };
@@ -0,0 +1,111 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+A Command_table maps command words to values, typically function pointers, through a
+perfect hash: whenever a word is added a seed is chosen under which every word hashes
+to a slot of its own, so a lookup hashes the word once and compares it with at most one
+entry. Words can be looked up in place, without making a string of them.
+*/
+
+template<typename T>
+class Command_table {
+public:
+    Command_table() : m_seed(0) {}
+
+    // Adds word with value, replacing the value if word is already in the table
+    void add(const std::string& word, T value);
+
+    // Returns the value of the word of length characters at word, a value initialized
+    // T (nullptr for pointers) if it is not in the table
+    T find(const char* word, std::size_t length) const;
+    T find(const std::string& word) const { return find(word.data(), word.size()); }
+
+private:
+    // FNV-1a mixed with the seed
+    static std::uint32_t hash(const char* word, std::size_t length, std::uint32_t seed);
+    // Chooses a seed and table size under which no two words share a slot
+    void rebuild();
+
+    std::vector<std::pair<std::string, T>> m_entries;
+    // index into m_entries of the word hashing to each slot, -1 if none
+    std::vector<int>                       m_slots;
+    std::uint32_t                          m_seed;
+};
+
+// Seeds tried at one table size before the table is doubled
+const std::uint32_t kCOMMAND_TABLE_SEED_TRIES = 1000;
+
+template<typename T>
+void Command_table<T>::add(const std::string& word, T value) {
+    for (auto& entry : m_entries) {
+        if (entry.first == word) {
+            entry.second = value;
+            return;
+        }
+    }
+    m_entries.emplace_back(word, value);
+    rebuild();
+}
+
+template<typename T>
+T Command_table<T>::find(const char* word, std::size_t length) const {
+    if (m_slots.empty()) {
+        return T();
+    }
+    const int index = m_slots[hash(word, length, m_seed) & (m_slots.size() - 1)];
+    if (index < 0) {
+        return T();
+    }
+    const std::string& entry_word = m_entries[index].first;
+    if (entry_word.size() != length || std::memcmp(entry_word.data(), word, length) != 0) {
+        return T();
+    }
+    return m_entries[index].second;
+}
+
+template<typename T>
+std::uint32_t Command_table<T>::hash(const char* word, std::size_t length, std::uint32_t seed) {
+    std::uint32_t result = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (std::size_t i = 0; i < length; ++i) {
+        result ^= static_cast<unsigned char>(word[i]);
+        result *= 16777619u;
+    }
+    return result ^ (result >> 15);
+}
+
+// Tables start at twice the number of words, rounded up to a power of two
+template<typename T>
+void Command_table<T>::rebuild() {
+    std::size_t size = 1;
+    while (size < 2 * m_entries.size()) {
+        size *= 2;
+    }
+
+    while (true) {
+        for (std::uint32_t seed = 0; seed < kCOMMAND_TABLE_SEED_TRIES; ++seed) {
+            m_slots.assign(size, -1);
+            bool collision = false;
+            for (std::size_t i = 0; i < m_entries.size() && !collision; ++i) {
+                const std::string& word = m_entries[i].first;
+                int& slot = m_slots[hash(word.data(), word.size(), seed) & (size - 1)];
+                collision = slot >= 0;
+                slot = static_cast<int>(i);
+            }
+            if (!collision) {
+                m_seed = seed;
+                return;
+            }
+        }
+        size *= 2;
+    }
+}
+
+#endif // COMMAND_TABLE_H
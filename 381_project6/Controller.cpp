@@ -2,6 +2,7 @@
 #include "Model.h"
 #include "View.h"
 #include "World_map.h"
+#include "Status.h"
 #include "Utility.h"
 #include "Geometry.h"
 #include "Structure_factory.h"
@@ -10,13 +11,23 @@
 #include "Agent.h"
 #include "Structure.h"
 #include "Group.h"
+#include "Profiler.h"
+#include "Logistics.h"
+#include "Input_source.h"
+#include "Event_log.h"
+#include "Journal.h"
+#include "Render_pipeline.h"
 #include <vector>
 #include <iostream>
+#include <sstream>
+#include <chrono>
 #include <exception>
 #include <stdexcept>
 #include <algorithm>
 #include <functional>
 #include <utility>
+#include <thread>
+#include <cctype>
 #include <cassert>
 
 using std::string;
@@ -24,8 +35,6 @@ using std::vector;
 using std::cin; using std::cout; using std::endl;
 using std::shared_ptr; using std::weak_ptr; using std::make_shared;
 using std::exception; using std::runtime_error;
-using std::numeric_limits;
-using std::streamsize;
 using std::for_each; using std::find_if;
 using namespace std::placeholders;
 
@@ -38,25 +47,116 @@ static void read_in_string(string& str);
 static void read_new_obj_info(New_obj_info& info);
 
 Controller::Controller()
+    : m_headless(false), mp_suppressed_output(new Counting_streambuf()),
+    mp_console_buf(cout.rdbuf()), m_tick_seconds(0.0), m_fast_forward(false),
+    m_quit_requested(false), m_script_depth(0), m_is_recorded(false),
+    mp_verified_journal(nullptr), m_next_state_hash(0), m_divergence_time(-1),
+    m_render_async(false)
 {
 }
 
+Controller::~Controller() {
+}
+
+// Sends everything written to cout to buf for the lifetime of the object,
+// a nullptr buf leaves cout alone
+class Cout_redirect {
+public:
+    explicit Cout_redirect(std::streambuf* buf) :
+        mp_old_buf(buf ? cout.rdbuf(buf) : nullptr)
+        {}
+    ~Cout_redirect() {
+        if (mp_old_buf) {
+            cout.rdbuf(mp_old_buf);
+        }
+    }
+
+    // disallow copy/move construction or assignment
+    Cout_redirect(const Cout_redirect&) = delete;
+    Cout_redirect& operator= (const Cout_redirect&) = delete;
+    Cout_redirect(Cout_redirect&&) = delete;
+    Cout_redirect& operator= (Cout_redirect&&) = delete;
+
+private:
+    std::streambuf* mp_old_buf;
+};
+
+// Writes out the events logged during a command once it is done, before anything
+// else is printed
+class Command_events {
+public:
+    Command_events() {}
+    ~Command_events() {
+        Event_log* event_log_ptr = Event_log::get_instance();
+        event_log_ptr->flush();
+        event_log_ptr->wait_until_written();
+    }
+
+    // disallow copy/move construction or assignment
+    Command_events(const Command_events&) = delete;
+    Command_events& operator= (const Command_events&) = delete;
+    Command_events(Command_events&&) = delete;
+    Command_events& operator= (Command_events&&) = delete;
+};
+
+// The input commands are read from, standard input unless a script is being run
+static Stream_input console_input(cin);
+static Input_source* current_input_ptr = &console_input;
+
+// Reads commands from input for the lifetime of the object
+class Input_redirect {
+public:
+    explicit Input_redirect(Input_source& input) :
+        mp_old_input(current_input_ptr)
+        { current_input_ptr = &input; }
+    ~Input_redirect() {
+        current_input_ptr = mp_old_input;
+    }
+
+    // disallow copy/move construction or assignment
+    Input_redirect(const Input_redirect&) = delete;
+    Input_redirect& operator= (const Input_redirect&) = delete;
+    Input_redirect(Input_redirect&&) = delete;
+    Input_redirect& operator= (Input_redirect&&) = delete;
+
+private:
+    Input_source* mp_old_input;
+};
+
 static int read_int() {
     int return_val;
-    cin >> return_val;
-
-    if (!cin.good()) {
+    if (!current_input_ptr->read_int(return_val)) {
         throw Error("Expected an integer!");
     }
 
     return return_val;
 }
 
+// Reads an integer if one follows on the current line, otherwise
+// returns default_val and leaves the input alone
+static int read_optional_int(int default_val) {
+    int next_char = current_input_ptr->peek_past_blanks();
+    if (!isdigit(next_char) && next_char != '-' && next_char != '+') {
+        return default_val;
+    }
+
+    return read_int();
+}
+
+// Reads a word if one follows on the current line, otherwise returns
+// an empty string and leaves the input alone
+static string read_optional_word() {
+    string word;
+    if (isalpha(current_input_ptr->peek_past_blanks())) {
+        current_input_ptr->read_word(word);
+    }
+
+    return word;
+}
+
 static double read_double() {
     double return_val;
-    cin >> return_val;
-
-    if (!cin.good()) {
+    if (!current_input_ptr->read_double(return_val)) {
         throw Error("Expected a double!");
     }
 
@@ -75,32 +175,48 @@ static bool string_is_alnum(const string& str) {
 bool Controller::init_commands() {
     bool success = true;
     try {
-        m_view_commands["default"] = &Controller::view_default_command;
-        m_view_commands["size"] = &Controller::view_size_command;
-        m_view_commands["zoom"] = &Controller::view_zoom_command;
-        m_view_commands["pan"] = &Controller::view_pan_command;
-
-        m_agent_commands["move"] = &Controller::agent_move_command;
-        m_agent_commands["work"] = &Controller::agent_work_command;
-        m_agent_commands["attack"] = &Controller::agent_attack_command;
-        m_agent_commands["stop"] = &Controller::agent_stop_command;
-
-        m_group_commands["disband"] = &Controller::group_disband_command;
-        m_group_commands["add"] = &Controller::group_add_command;
-        m_group_commands["remove"] = &Controller::group_remove_command;
-        m_group_commands["move"] = &Controller::group_move_command;
-        m_group_commands["stop"] = &Controller::group_stop_command;
-        m_group_commands["attack"] = &Controller::group_attack_command;
-        m_group_commands["work"] = &Controller::group_work_command;
-
-        m_program_commands["open"] = &Controller::open_command;
-        m_program_commands["close"] = &Controller::close_command;
-        m_program_commands["status"] = &Controller::status_command;
-        m_program_commands["show"] = &Controller::show_command;
-        m_program_commands["go"] = &Controller::go_command;
-        m_program_commands["build"] = &Controller::build_command;
-        m_program_commands["train"] = &Controller::train_command;
-        m_program_commands["form_group"] = &Controller::create_group_command;
+        m_view_commands.add("default", &Controller::view_default_command);
+        m_view_commands.add("size", &Controller::view_size_command);
+        m_view_commands.add("zoom", &Controller::view_zoom_command);
+        m_view_commands.add("pan", &Controller::view_pan_command);
+        m_view_commands.add("detail", &Controller::view_detail_command);
+
+        m_agent_commands.add("move", &Controller::agent_move_command);
+        m_agent_commands.add("work", &Controller::agent_work_command);
+        m_agent_commands.add("attack", &Controller::agent_attack_command);
+        m_agent_commands.add("stop", &Controller::agent_stop_command);
+
+        m_group_commands.add("disband", &Controller::group_disband_command);
+        m_group_commands.add("add", &Controller::group_add_command);
+        m_group_commands.add("remove", &Controller::group_remove_command);
+        m_group_commands.add("nest", &Controller::group_nest_command);
+        m_group_commands.add("unnest", &Controller::group_unnest_command);
+        m_group_commands.add("move", &Controller::group_move_command);
+        m_group_commands.add("stop", &Controller::group_stop_command);
+        m_group_commands.add("attack", &Controller::group_attack_command);
+        m_group_commands.add("work", &Controller::group_work_command);
+
+        m_program_commands.add("open", &Controller::open_command);
+        m_program_commands.add("close", &Controller::close_command);
+        m_program_commands.add("status", &Controller::status_command);
+        m_program_commands.add("show", &Controller::show_command);
+        m_program_commands.add("go", &Controller::go_command);
+        m_program_commands.add("run_until", &Controller::run_until_command);
+        m_program_commands.add("build", &Controller::build_command);
+        m_program_commands.add("train", &Controller::train_command);
+        m_program_commands.add("form_group", &Controller::create_group_command);
+        m_program_commands.add("tick_mode", &Controller::tick_mode_command);
+        m_program_commands.add("fast_forward", &Controller::fast_forward_command);
+        m_program_commands.add("combat", &Controller::combat_command);
+        m_program_commands.add("logistics", &Controller::logistics_command);
+        m_program_commands.add("save", &Controller::save_command);
+        m_program_commands.add("restore", &Controller::restore_command);
+        m_program_commands.add("profile", &Controller::profile_command);
+        m_program_commands.add("source", &Controller::source_command);
+        m_program_commands.add("log", &Controller::log_command);
+        m_program_commands.add("record", &Controller::record_command);
+        m_program_commands.add("render", &Controller::render_command);
+        m_program_commands.add("rank", &Controller::rank_command);
     }
     catch (...) {
         cout << "Error detected in Controller::init_commands" << endl;
@@ -111,24 +227,17 @@ bool Controller::init_commands() {
 }
 
 static void read_in_string(string& str) {
-    cin >> str;
-
-    if (!cin.good()) {
+    if (!current_input_ptr->read_word(str)) {
         throw runtime_error("Failed to read string from input");
     }
 }
 
-static void discard_rest_of_line(std::istream& is) {
-    is.clear();
-    is.ignore(numeric_limits<streamsize>::max(), '\n');
-}
-
 Controller::Controller_agent_fp_t Controller::get_agent_command() {
     string command;
     read_in_string(command);
 
     // Try to find Agent command function
-    Controller_agent_fp_t command_ptr = get_command_helper(m_agent_commands, command);
+    Controller_agent_fp_t command_ptr = m_agent_commands.find(command);
 
     // if none found, throw error
     if (!command_ptr) {
@@ -143,7 +252,7 @@ Controller::Controller_group_fp_t Controller::get_group_command() {
     read_in_string(command);
 
     // Try to find Agent command function
-    Controller_group_fp_t command_ptr = get_command_helper(m_group_commands, command);
+    Controller_group_fp_t command_ptr = m_group_commands.find(command);
 
     // if none found, throw error
     if (!command_ptr) {
@@ -155,11 +264,11 @@ Controller::Controller_group_fp_t Controller::get_group_command() {
 
 Controller::Controller_fp_t Controller::get_view_program_command(const string& command) {
     // try to find program command
-    Controller_fp_t command_ptr = get_command_helper(m_program_commands, command);
+    Controller_fp_t command_ptr = m_program_commands.find(command);
 
     // if none found, try to find view command
     if (!command_ptr) {
-        command_ptr = get_command_helper(m_view_commands, command);
+        command_ptr = m_view_commands.find(command);
     }
 
     // if none found, throw error
@@ -170,6 +279,65 @@ Controller::Controller_fp_t Controller::get_view_program_command(const string& c
     return command_ptr;
 }
 
+// The command is recorded as the words and numbers it read, even if it failed
+void Controller::execute_command(const string& first_word) {
+    if (!mp_journal) {
+        dispatch_command(first_word);
+        return;
+    }
+
+    const int time = Model::get_instance()->get_time();
+    string command = first_word;
+    try {
+        Recording_input recording(*current_input_ptr, command);
+        Input_redirect read_recording(recording);
+        m_is_recorded = true;
+        dispatch_command(first_word);
+    }
+    catch (...) {
+        if (m_is_recorded && mp_journal) {
+            mp_journal->write_command(time, command);
+        }
+        throw;
+    }
+    if (m_is_recorded && mp_journal) {
+        mp_journal->write_command(time, command);
+    }
+}
+
+void Controller::dispatch_command(const string& first_word) {
+    // Check if first word is name of an Agent and set the Agent ptr
+    // then execute an Agent command
+    shared_ptr<Agent> agent_ptr = Model::get_instance()->find_agent(first_word);
+    if (agent_ptr) {
+        assert(agent_ptr->is_alive());
+
+        // Find Agent command, throws Error if none found
+        Controller_agent_fp_t agent_command_ptr = get_agent_command();
+        // Execute Agent command
+        (this->*agent_command_ptr)(agent_ptr);
+        return;
+    }
+
+    // Check if first word is name of an active Group, if it is then
+    // get the Group and execute the command
+    shared_ptr<Group> group_ptr = Model::get_instance()->find_group(first_word);
+    if (group_ptr) {
+        // Get group command funciton pointer, throws Error if unrecognized command
+        Controller_group_fp_t group_command_ptr = get_group_command();
+
+        (this->*group_command_ptr)(group_ptr);
+        return;
+    }
+
+    // Otherwise check if user input a different command and execute it
+    // Try to find a view or program-wide command, Error thrown
+    // if first_word is not a valid command
+    Controller_fp_t command_ptr = get_view_program_command(first_word);
+    // Execute command
+    (this->*(command_ptr))();
+}
+
 void Controller::run() {
     bool init_commands_success = init_commands(); // Fill command containers
     if (!init_commands_success) {
@@ -184,9 +352,16 @@ void Controller::run() {
         5. Else if user input a Group name attempt to process a Group command
         6. Else attempt to process a whole program command
     */
-    while (true) {
+    while (!m_quit_requested) {
         try {
-            cout << "\nTime " << Model::get_instance()->get_time() << ": Enter command: ";
+            // In headless mode whatever the command prints is only counted
+            Cout_redirect command_output(m_headless ? mp_suppressed_output.get() :
+                                                      get_console_output());
+            Command_events command_events;
+
+            if (!m_headless) {
+                cout << "\nTime " << Model::get_instance()->get_time() << ": Enter command: ";
+            }
             string first_word;
             read_in_string(first_word);
 
@@ -195,48 +370,280 @@ void Controller::run() {
                 break; // break out of main program loop
             }
 
-            // Check if first word is name of an Agent and set the Agent ptr
-            // then execute an Agent command
-            shared_ptr<Agent> agent_ptr = Model::get_instance()->find_agent(first_word);
-            if (agent_ptr) {
-                assert(agent_ptr->is_alive());
-
-                // Find Agent command, throws Error if none found
-                Controller_agent_fp_t agent_command_ptr = get_agent_command();
-                // Execute Agent command
-                (this->*agent_command_ptr)(agent_ptr);
-                continue;
+            execute_command(first_word);
+        } // End try-block
+        catch (exception& e) {
+            Cout_redirect to_console(get_console_output());
+            cout << e.what() << endl;
+            // nothing more will come from an exhausted input
+            if (console_input.at_end()) {
+                break;
             }
+            console_input.skip_line();
+        }
+        catch (...) {
+            Cout_redirect to_console(get_console_output());
+            cout << "Unknown exception caught!" << endl;
+            break;
+        }
+    } // End main program loop
+
+    Cout_redirect to_console(get_console_output());
+    cout << "Done" << endl;
+}
+
+// Scripts may run other scripts up to this depth, which stops a script from running
+// itself forever
+const int kMAX_SCRIPT_DEPTH = 16;
 
-            // Check if first word is name of an active Group, if it is then
-            // get the Group and execute the command
-            shared_ptr<Group> group_ptr = Model::get_instance()->find_group(first_word);
-            if (group_ptr) {
-                // Get group command funciton pointer, throws Error if unrecognized command
-                Controller_group_fp_t group_command_ptr = get_group_command();
+void Controller::run_script(Script_file& script, const string& script_name) {
+    if (m_script_depth >= kMAX_SCRIPT_DEPTH) {
+        throw Error("Scripts are nested too deeply!");
+    }
+    ++m_script_depth;
+    Input_redirect read_script(script);
 
-                (this->*group_command_ptr)(group_ptr);
-                continue;
+    const char* word;
+    std::size_t length;
+    while (!m_quit_requested && script.next_word(word, length)) {
+        const int command_line = script.get_line_number();
+        try {
+            // In headless mode whatever the command prints is only counted
+            Cout_redirect command_output(m_headless ? mp_suppressed_output.get() :
+                                                      get_console_output());
+            Command_events command_events;
+
+            if (length == 4 && std::equal(word, word + length, "quit")) {
+                m_quit_requested = true;
+                break;
             }
 
-            // Otherwise check if user input a different command and execute it
-            // Try to find a view or program-wide command, Error thrown
-            // if first_word is not a valid command
-            Controller_fp_t command_ptr = get_view_program_command(first_word);
-            // Execute command
-            (this->*(command_ptr))();
-        } // End try-block
+            // reusing the buffer spares an allocation per command
+            m_script_word.assign(word, length);
+            execute_command(m_script_word);
+        }
         catch (exception& e) {
-            cout << e.what() << endl;
-            discard_rest_of_line(cin);
+            // errors are shown even in headless mode
+            Cout_redirect to_console(mp_console_buf);
+            cout << script_name << " line " << command_line << ": " << e.what() << endl;
+            script.skip_line();
+        }
+        catch (...) {
+            --m_script_depth;
+            throw;
+        }
+    }
+
+    --m_script_depth;
+}
+
+void Controller::run_headless(const string& script_filename) {
+    std::unique_ptr<Script_file> script_ptr;
+    if (!script_filename.empty()) {
+        try {
+            script_ptr.reset(new Script_file(script_filename));
+        }
+        catch (Error&) {
+            cout << "Could not open " << script_filename << endl;
+            return;
+        }
+    }
+
+    const int start_time = Model::get_instance()->get_time();
+    const long long start_agent_updates = Model::get_instance()->get_agent_update_count();
+    const auto start_clock = std::chrono::steady_clock::now();
+
+    m_headless = true;
+    if (!script_ptr) {
+        run();
+    }
+    else if (init_commands()) {
+        try {
+            run_script(*script_ptr, script_filename);
         }
         catch (...) {
+            Cout_redirect to_console(get_console_output());
             cout << "Unknown exception caught!" << endl;
+        }
+        Cout_redirect to_console(get_console_output());
+        cout << "Done" << endl;
+    }
+    m_headless = false;
+    wait_until_rendered();
+
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start_clock;
+    print_run_report(Model::get_instance()->get_time() - start_time,
+        Model::get_instance()->get_agent_update_count() - start_agent_updates, wall_time.count());
+}
+
+std::streambuf* Controller::get_console_output() const {
+    return mp_render_pipeline ? mp_console_buf : nullptr;
+}
+
+void Controller::wait_until_rendered() {
+    if (mp_render_pipeline) {
+        mp_render_pipeline->wait_until_written();
+    }
+}
+
+void Controller::print_run_report(int ticks, long long agent_updates, double wall_seconds) const {
+    const double ticks_per_sec = m_tick_seconds > 0.0 ? ticks / m_tick_seconds : 0.0;
+    const double updates_per_sec = m_tick_seconds > 0.0 ? agent_updates / m_tick_seconds : 0.0;
+
+    cout << "Headless run: " << ticks << " ticks, " << agent_updates << " agent updates" << endl;
+    cout << "Wall time: " << wall_seconds << " s, " << m_tick_seconds << " s updating" << endl;
+    cout << "Ticks/sec: " << ticks_per_sec << ", agent updates/sec: " << updates_per_sec << endl;
+    cout << "Suppressed output: " << mp_suppressed_output->get_line_count() << " lines, "
+        << mp_suppressed_output->get_char_count() << " characters" << endl;
+}
+
+// The modes the snapshot does not hold are recorded as the commands that select them
+void Controller::start_recording(const string& journal_filename) {
+    Model* model_ptr = Model::get_instance();
+    std::ostringstream snapshot;
+    model_ptr->save(snapshot);
+    mp_journal.reset(new Journal_writer(journal_filename, get_build_info(), snapshot.str()));
+
+    const int time = model_ptr->get_time();
+    switch (model_ptr->get_tick_mode()) {
+    case Model::Tick_mode::SEQUENTIAL:
+        mp_journal->write_command(time, "tick_mode sequential");
+        break;
+    case Model::Tick_mode::BATCHED:
+        mp_journal->write_command(time, "tick_mode batched");
+        break;
+    case Model::Tick_mode::PARALLEL:
+        mp_journal->write_command(time,
+            "tick_mode parallel " + std::to_string(model_ptr->get_num_threads()));
+        break;
+    default:
+        throw Error("Unrecognized tick mode in Controller::start_recording");
+    }
+    mp_journal->write_command(time, model_ptr->get_combat_mode() == Model::Combat_mode::DEFERRED ?
+        "combat deferred" : "combat immediate");
+    switch (model_ptr->get_logistics().get_mode()) {
+    case Logistics::Mode::OFF:
+        mp_journal->write_command(time, "logistics off");
+        break;
+    case Logistics::Mode::QUEUE:
+        mp_journal->write_command(time, "logistics queue");
+        break;
+    case Logistics::Mode::REBALANCE:
+        mp_journal->write_command(time, "logistics rebalance");
+        break;
+    default:
+        throw Error("Unrecognized logistics mode in Controller::start_recording");
+    }
+    mp_journal->write_command(time, m_fast_forward ? "fast_forward on" : "fast_forward off");
+}
+
+void Controller::run_replay(const string& journal_filename, bool verify) {
+    std::unique_ptr<Journal_reader> journal_ptr;
+    try {
+        journal_ptr.reset(new Journal_reader(journal_filename));
+        Model::get_instance()->restore(journal_ptr->get_start_snapshot());
+    }
+    catch (Error& e) {
+        cout << "Could not replay " << journal_filename << ": " << e.what() << endl;
+        return;
+    }
+    if (!init_commands()) {
+        return;
+    }
+
+    cout << "Journal recorded by the build " << journal_ptr->get_build_info() << endl;
+    if (journal_ptr->get_build_info() != get_build_info()) {
+        cout << "Replaying with the build " << get_build_info() << endl;
+    }
+
+    const int start_time = Model::get_instance()->get_time();
+    const long long start_agent_updates = Model::get_instance()->get_agent_update_count();
+    const auto start_clock = std::chrono::steady_clock::now();
+
+    m_headless = true;
+    if (verify) {
+        mp_verified_journal = journal_ptr.get();
+        m_next_state_hash = 0;
+    }
+    m_divergence_time = -1;
+
+    const vector<Journal_reader::Command>& commands = journal_ptr->get_commands();
+    Text_input command_input;
+    Input_redirect read_commands(command_input);
+    std::size_t num_replayed = 0;
+    for (; num_replayed < commands.size() && m_divergence_time < 0; ++num_replayed) {
+        const Journal_reader::Command& command = commands[num_replayed];
+        if (command.time != Model::get_instance()->get_time()) {
+            m_divergence_time = Model::get_instance()->get_time();
             break;
         }
-    } // End main program loop
 
-    cout << "Done" << endl;
+        command_input.set_text(command.text.data(), command.text.data() + command.text.size());
+        try {
+            // whatever the command prints is only counted
+            Cout_redirect command_output(mp_suppressed_output.get());
+            Command_events command_events;
+
+            string first_word;
+            read_in_string(first_word);
+            execute_command(first_word);
+        }
+        catch (exception& e) {
+            // errors are shown, except the one that reports a divergence
+            if (m_divergence_time < 0) {
+                Cout_redirect to_console(get_console_output());
+                cout << e.what() << endl;
+            }
+        }
+    }
+
+    mp_verified_journal = nullptr;
+    m_headless = false;
+    wait_until_rendered();
+
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start_clock;
+    print_run_report(Model::get_instance()->get_time() - start_time,
+        Model::get_instance()->get_agent_update_count() - start_agent_updates, wall_time.count());
+
+    cout << "Replayed " << num_replayed << " of " << commands.size() << " commands";
+    if (verify) {
+        cout << ", checked " << std::min(m_next_state_hash, journal_ptr->get_state_hashes().size())
+            << " of " << journal_ptr->get_state_hashes().size() << " state hashes";
+    }
+    cout << endl;
+    if (m_divergence_time >= 0) {
+        cout << "Replay diverged from the recording at time " << m_divergence_time << endl;
+    }
+    else {
+        cout << "Replay matched the recording" << endl;
+    }
+}
+
+// Hashing the world takes as long as saving it, so it is only done when needed
+void Controller::check_tick() {
+    if (!mp_journal && !mp_verified_journal) {
+        return;
+    }
+
+    Model* model_ptr = Model::get_instance();
+    const int time = model_ptr->get_time();
+    const std::uint64_t hash = model_ptr->get_state_hash();
+    if (mp_journal) {
+        mp_journal->write_state_hash(time, hash);
+    }
+    if (!mp_verified_journal) {
+        return;
+    }
+
+    const vector<Journal_reader::State_hash>& hashes = mp_verified_journal->get_state_hashes();
+    if (m_next_state_hash >= hashes.size()) {
+        return;
+    }
+    const Journal_reader::State_hash& expected = hashes[m_next_state_hash++];
+    if (expected.time != time || expected.hash != hash) {
+        m_divergence_time = time;
+        throw Error("The state differs from the recording!");
+    }
 }
 
 // Return a shared_ptr to the open map view, throw an Error if no map view open
@@ -277,6 +684,25 @@ void Controller::view_pan_command() {
     map_view_ptr->set_origin(new_origin);
 }
 
+// Show the map's cells by names, counts or density
+void Controller::view_detail_command() {
+    auto map_view_ptr = get_map_view();
+    string detail;
+    read_in_string(detail);
+    if (detail == "names") {
+        map_view_ptr->set_detail(World_map::Detail::NAMES);
+    }
+    else if (detail == "counts") {
+        map_view_ptr->set_detail(World_map::Detail::COUNTS);
+    }
+    else if (detail == "density") {
+        map_view_ptr->set_detail(World_map::Detail::DENSITY);
+    }
+    else {
+        throw Error("Unrecognized map detail!");
+    }
+}
+
 void Controller::agent_move_command(shared_ptr<Agent> agent_ptr) {
     Point move_pt = read_point();
     agent_ptr->move_to(move_pt);
@@ -333,9 +759,12 @@ void Controller::agent_stop_command(shared_ptr<Agent> agent_ptr) {
 }
 
 // Group commands
+// Agents that stop sharing a Group may become hostiles to idle Archers watching
+// them, the disband, remove and unnest commands wake every watcher to look again
 void Controller::group_disband_command(shared_ptr<Group> group_ptr) {
     group_ptr->disband();
     Model::get_instance()->remove_group(group_ptr->get_name());
+    Model::get_instance()->wake_watchers();
 }
 
 // Provides basic framework for adding/removing to/from groups
@@ -373,6 +802,29 @@ void Controller::group_add_command(shared_ptr<Group> group_ptr) {
 
 void Controller::group_remove_command(shared_ptr<Group> group_ptr) {
     group_add_remove_helper(group_ptr, &Group::remove_agent, &Group::remove_group);
+    Model::get_instance()->wake_watchers();
+}
+
+// Reads in the name of a Group, throws Error if there is no such Group
+static shared_ptr<Group> read_in_group() {
+    string group_name;
+    read_in_string(group_name);
+
+    shared_ptr<Group> group_ptr = Model::get_instance()->find_group(group_name);
+    if (!group_ptr) {
+        throw Error("No Group found with that name!");
+    }
+
+    return group_ptr;
+}
+
+void Controller::group_nest_command(shared_ptr<Group> group_ptr) {
+    group_ptr->add_subgroup(read_in_group());
+}
+
+void Controller::group_unnest_command(shared_ptr<Group> group_ptr) {
+    group_ptr->remove_subgroup(read_in_group());
+    Model::get_instance()->wake_watchers();
 }
 
 void Controller::group_move_command(shared_ptr<Group> group_ptr) {
@@ -397,7 +849,8 @@ void Controller::group_work_command(shared_ptr<Group> group_ptr) {
 }
 
 void Controller::status_command() {
-    // tell all objects to describe themselves to the console
+    // tell all objects to describe themselves to the console, even in headless mode
+    Cout_redirect to_console(mp_console_buf);
     Model::get_instance()->describe();
 }
 
@@ -426,7 +879,13 @@ void Controller::open_command() {
         throw Error("View of that name already open!");
     }
 
-    auto create_ret = create_view(helper_ret.name);
+    // a telemetry view also needs the file it writes to
+    string filename;
+    if (helper_ret.name == "telemetry") {
+        read_in_string(filename);
+    }
+
+    auto create_ret = create_view(helper_ret.name, filename);
 
     // If newly created map is the world map then remember this with weak_ptr
     if (!create_ret.world_map_ptr.expired()) {
@@ -445,18 +904,364 @@ void Controller::close_command() {
         throw Error("No view of that name is open!");
     }
 
-    m_views.erase(helper_ret.iter);
+    // detached before it is erased, erasing invalidates the iterator
     Model::get_instance()->detach(*helper_ret.iter);
+    m_views.erase(helper_ret.iter);
 }
 
 // Draw all Views
 void Controller::show_command() {
+    Model::get_instance()->flush_view_changes();
+
+    // the frames are printed while the next commands run
+    if (m_render_async) {
+        vector<std::unique_ptr<View_frame>> frames;
+        frames.reserve(m_views.size());
+        for (shared_ptr<View>& view_ptr : m_views) {
+            frames.push_back(view_ptr->capture());
+        }
+        mp_render_pipeline->render(std::move(frames));
+        return;
+    }
+
+    // shown even in headless mode
+    Cout_redirect to_console(mp_console_buf);
     for_each(m_views.begin(), m_views.end(), [](shared_ptr<View>& v){ v->draw(); });
 }
 
-// Update all Sim_objects
+// Update all Sim_objects, as many times as the optional count says
 void Controller::go_command() {
-    Model::get_instance()->update();
+    int ticks = read_optional_int(1);
+    if (ticks < 0) {
+        throw Error("Tick count must be non-negative!");
+    }
+
+    run_ticks(ticks);
+}
+
+// Update all Sim_objects until the time reaches the one given
+void Controller::run_until_command() {
+    int time = read_int();
+    int current_time = Model::get_instance()->get_time();
+    if (time < current_time) {
+        throw Error("That time has already passed!");
+    }
+
+    run_ticks(time - current_time);
+}
+
+// Only the updates count as time spent updating, not recording or checking the state
+void Controller::run_ticks(int ticks) {
+    using Clock_t = std::chrono::steady_clock;
+    auto add_tick_time = [this](Clock_t::time_point start_clock) {
+        const std::chrono::duration<double> elapsed = Clock_t::now() - start_clock;
+        m_tick_seconds += elapsed.count();
+    };
+
+    while (ticks > 0) {
+        if (m_fast_forward) {
+            const auto start_clock = Clock_t::now();
+            const int jumped = Model::get_instance()->fast_forward(ticks);
+            add_tick_time(start_clock);
+            if (jumped > 0) {
+                ticks -= jumped;
+                check_tick();
+            }
+            if (ticks == 0) {
+                break;
+            }
+        }
+        const auto start_clock = Clock_t::now();
+        Model::get_instance()->update();
+        add_tick_time(start_clock);
+        --ticks;
+        check_tick();
+    }
+}
+
+// Select how the Model advances a tick
+void Controller::tick_mode_command() {
+    string mode;
+    read_in_string(mode);
+
+    if (mode == "sequential") {
+        Model::get_instance()->set_tick_mode(Model::Tick_mode::SEQUENTIAL);
+    }
+    else if (mode == "batched") {
+        Model::get_instance()->set_tick_mode(Model::Tick_mode::BATCHED);
+    }
+    else if (mode == "parallel") {
+        // zero threads means one per core
+        int num_threads = read_int();
+        if (num_threads < 0) {
+            throw Error("Number of threads cannot be negative!");
+        }
+        if (num_threads == 0) {
+            num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+
+        Model::get_instance()->set_tick_mode(Model::Tick_mode::PARALLEL, num_threads);
+    }
+    else {
+        throw Error("Unrecognized tick mode!");
+    }
+}
+
+// Turn jumping over quiet stretches of go and run_until on or off
+void Controller::fast_forward_command() {
+    string setting;
+    read_in_string(setting);
+
+    if (setting == "on") {
+        m_fast_forward = true;
+    }
+    else if (setting == "off") {
+        m_fast_forward = false;
+    }
+    else {
+        throw Error("Fast forward must be on or off!");
+    }
+}
+
+// Select whether hits land as they are made or together at the end of each tick
+void Controller::combat_command() {
+    string mode;
+    read_in_string(mode);
+
+    if (mode == "immediate") {
+        Model::get_instance()->set_combat_mode(Model::Combat_mode::IMMEDIATE);
+    }
+    else if (mode == "deferred") {
+        Model::get_instance()->set_combat_mode(Model::Combat_mode::DEFERRED);
+    }
+    else {
+        throw Error("Unrecognized combat mode!");
+    }
+}
+
+// Select how Peasants that find their source empty wait for food
+void Controller::logistics_command() {
+    string mode;
+    read_in_string(mode);
+
+    Logistics& logistics = Model::get_instance()->get_logistics();
+    if (mode == "off") {
+        logistics.set_mode(Logistics::Mode::OFF);
+    }
+    else if (mode == "queue") {
+        logistics.set_mode(Logistics::Mode::QUEUE);
+    }
+    else if (mode == "rebalance") {
+        logistics.set_mode(Logistics::Mode::REBALANCE);
+    }
+    else {
+        throw Error("Unrecognized logistics mode!");
+    }
+}
+
+// Render views in the background with a number of threads, one per core if none is
+// given, or on the main thread
+void Controller::render_command() {
+    string mode;
+    read_in_string(mode);
+
+    if (mode == "sync") {
+        m_render_async = false;
+        return;
+    }
+    if (mode != "async") {
+        throw Error("Unrecognized render mode!");
+    }
+
+    int num_threads = read_optional_int(0);
+    if (num_threads < 0) {
+        throw Error("Number of threads cannot be negative!");
+    }
+    if (num_threads == 0) {
+        num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    // The pipeline is kept from now on, in case anything still writes to its output
+    if (mp_render_pipeline) {
+        mp_render_pipeline->set_num_threads(num_threads);
+    }
+    else {
+        mp_render_pipeline.reset(new Render_pipeline(mp_console_buf, num_threads));
+        mp_console_buf = mp_render_pipeline->get_output();
+    }
+    m_render_async = true;
+}
+
+// Show only the lowest or highest count values of a status view, or those below or
+// above a value, or all of them again
+void Controller::rank_command() {
+    string view_name;
+    read_in_string(view_name);
+    auto iter = find_if(m_views.begin(), m_views.end(),
+        [&view_name](shared_ptr<View> v){ return v->get_name() == view_name; });
+    shared_ptr<Status> status_ptr;
+    if (iter != m_views.end()) {
+        status_ptr = std::dynamic_pointer_cast<Status>(*iter);
+    }
+    if (!status_ptr) {
+        throw Error("No status view of that name is open!");
+    }
+
+    string mode;
+    read_in_string(mode);
+    if (mode == "lowest") {
+        status_ptr->show_lowest(read_int());
+    }
+    else if (mode == "highest") {
+        status_ptr->show_highest(read_int());
+    }
+    else if (mode == "below") {
+        status_ptr->show_below(read_double());
+    }
+    else if (mode == "above") {
+        status_ptr->show_above(read_double());
+    }
+    else if (mode == "off") {
+        status_ptr->show_all();
+    }
+    else {
+        throw Error("Unrecognized rank mode!");
+    }
+}
+
+// Set the level events of a category, or all of them, are logged at, or turn the
+// background writer on or off
+void Controller::log_command() {
+    string category_name;
+    read_in_string(category_name);
+
+    Event_log* event_log_ptr = Event_log::get_instance();
+    if (category_name == "background") {
+        string setting;
+        read_in_string(setting);
+        if (setting == "on") {
+            event_log_ptr->set_background_writer(true);
+        }
+        else if (setting == "off") {
+            event_log_ptr->set_background_writer(false);
+        }
+        else {
+            throw Error("Background writer must be on or off!");
+        }
+        return;
+    }
+
+    const vector<std::pair<const char*, Event_log::Category>> categories = {
+        {"combat", Event_log::COMBAT}, {"work", Event_log::WORK},
+        {"movement", Event_log::MOVEMENT}, {"group", Event_log::GROUP}
+    };
+    auto category_iter = find_if(categories.begin(), categories.end(),
+        [&category_name](const std::pair<const char*, Event_log::Category>& category) {
+            return category_name == category.first;
+        });
+    if (category_name != "all" && category_iter == categories.end()) {
+        throw Error("Unrecognized log category!");
+    }
+
+    string level_name;
+    read_in_string(level_name);
+    Event_log::Level level;
+    if (level_name == "debug") {
+        level = Event_log::Level::DEBUG;
+    }
+    else if (level_name == "info") {
+        level = Event_log::Level::INFO;
+    }
+    else if (level_name == "warning") {
+        level = Event_log::Level::WARNING;
+    }
+    else if (level_name == "off") {
+        level = Event_log::Level::OFF;
+    }
+    else {
+        throw Error("Unrecognized log level!");
+    }
+
+    if (category_iter != categories.end()) {
+        event_log_ptr->set_level(category_iter->second, level);
+        return;
+    }
+    for (const auto& category : categories) {
+        event_log_ptr->set_level(category.second, level);
+    }
+}
+
+// Write the whole world to a snapshot file
+void Controller::save_command() {
+    string filename;
+    read_in_string(filename);
+    Model::get_instance()->save(filename);
+}
+
+// Replace the whole world with the one in a snapshot file
+void Controller::restore_command() {
+    string filename;
+    read_in_string(filename);
+    Model::get_instance()->restore(filename);
+}
+
+// Print the profile of the most recent ticks, as a table unless csv or json is asked for
+void Controller::profile_command() {
+    constexpr int kDEFAULT_PROFILE_TICKS = 10;
+    const int num_ticks = read_optional_int(kDEFAULT_PROFILE_TICKS);
+    if (num_ticks < 0) {
+        throw Error("Tick count must be non-negative!");
+    }
+
+    const string format_name = read_optional_word();
+    Profiler::Format format = Profiler::Format::TEXT;
+    if (format_name == "csv") {
+        format = Profiler::Format::CSV;
+    }
+    else if (format_name == "json") {
+        format = Profiler::Format::JSON;
+    }
+    else if (!format_name.empty()) {
+        throw Error("Unrecognized profile format!");
+    }
+
+    if (!kPROFILING_ENABLED) {
+        throw Error("Profiling is not compiled in, rebuild with make PROFILE=1!");
+    }
+
+    // shown even in headless mode
+    Cout_redirect to_console(mp_console_buf);
+    Profiler::get_instance()->print(cout, num_ticks, format);
+}
+
+// Run the commands in a script file, throws Error if it cannot be read
+void Controller::source_command() {
+    string filename;
+    read_in_string(filename);
+
+    Script_file script(filename);
+    run_script(script, filename);
+
+    // the commands run from the script were recorded one by one
+    m_is_recorded = false;
+}
+
+// Start recording to a journal, replacing any recording in progress, or stop recording
+void Controller::record_command() {
+    string filename;
+    read_in_string(filename);
+    m_is_recorded = false;
+
+    if (filename == "off") {
+        if (!mp_journal) {
+            throw Error("Not recording!");
+        }
+        mp_journal.reset();
+        return;
+    }
+
+    mp_journal.reset();
+    start_recording(filename);
 }
 
 // Data for creating a new Sim_object
@@ -1,15 +1,22 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
-#include <map>
+#include "Command_table.h"
 #include <vector>
 #include <string>
 #include <memory>
+#include <iosfwd>
+#include <cstddef>
 
 class Agent;
 class Group;
 class View;
 class World_map;
+class Counting_streambuf;
+class Script_file;
+class Journal_writer;
+class Journal_reader;
+class Render_pipeline;
 
 /* Controller
 This class is responsible for controlling the Model and View according to interactions
@@ -19,16 +26,34 @@ with the user.
 class Controller {
 public:
     Controller();
+    ~Controller();
 
     // create View object, run the program by acccepting user commands, then destroy View object
     void run();
 
+    // run the commands in script_filename, or standard input if it is empty, without
+    // prompting, reading a script file as source does, discard whatever the commands
+    // print other than status and show output and error messages, then report how
+    // fast the simulation ran
+    void run_headless(const std::string& script_filename);
+
+    // record every command given from now on, and the state of the world after every
+    // tick, to a journal, see Journal.h. Throws Error if the file cannot be written.
+    void start_recording(const std::string& journal_filename);
+
+    // run the commands recorded in journal_filename headless, starting from the world
+    // recording started from, and report how fast the simulation ran. If verify, the
+    // state after every tick is checked against the recording and the replay stops at
+    // the first tick that differs.
+    void run_replay(const std::string& journal_filename, bool verify);
+
 private:
     // View commands from spec
     void view_default_command();
     void view_size_command();
     void view_zoom_command();
     void view_pan_command();
+    void view_detail_command();
 
     // Agent commands from spec
     void agent_move_command(std::shared_ptr<Agent>);
@@ -42,14 +67,29 @@ private:
     void status_command();
     void show_command();
     void go_command();
+    void run_until_command();
     void build_command();
     void train_command();
     void create_group_command();
+    void tick_mode_command();
+    void fast_forward_command();
+    void combat_command();
+    void logistics_command();
+    void save_command();
+    void restore_command();
+    void profile_command();
+    void source_command();
+    void log_command();
+    void record_command();
+    void render_command();
+    void rank_command();
 
     // Group commands
     void group_disband_command(std::shared_ptr<Group>);
     void group_add_command(std::shared_ptr<Group>);
     void group_remove_command(std::shared_ptr<Group>);
+    void group_nest_command(std::shared_ptr<Group>);
+    void group_unnest_command(std::shared_ptr<Group>);
     void group_move_command(std::shared_ptr<Group>);
     void group_stop_command(std::shared_ptr<Group>);
     void group_attack_command(std::shared_ptr<Group>);
@@ -62,9 +102,9 @@ private:
     using Controller_fp_t = void(Controller::*)();
     using Controller_agent_fp_t = void(Controller::*)(std::shared_ptr<Agent>);
     using Controller_group_fp_t = void(Controller::*)(std::shared_ptr<Group>);
-    using Command_map_t = std::map<std::string, Controller_fp_t>;
-    using Agent_command_map_t = std::map<std::string, Controller_agent_fp_t>;
-    using Group_command_map_t = std::map<std::string, Controller_group_fp_t>;
+    using Command_map_t = Command_table<Controller_fp_t>;
+    using Agent_command_map_t = Command_table<Controller_agent_fp_t>;
+    using Group_command_map_t = Command_table<Controller_group_fp_t>;
 
     // Returns function pointer to associated command if it exists, 
     // returns nullptr otherwise
@@ -74,10 +114,38 @@ private:
     // Returns function ptr to group command associated with next input string
     Controller_group_fp_t get_group_command();
 
+    // Executes the command that starts with first_word, reading the rest of it from
+    // the input: an Agent or Group command if first_word names one, otherwise a
+    // program or view command. Records it if recording.
+    void execute_command(const std::string& first_word);
+    // executes the command without recording it
+    void dispatch_command(const std::string& first_word);
+
+    // Executes every command in script without prompting, until its end or a quit
+    // command, which also ends the program. Errors are reported with script_name and
+    // the line of the command, and the rest of that line is skipped.
+    void run_script(Script_file& script, const std::string& script_name);
+
     // Returns shared_ptr to the map view if one exists, otherwise
     // throws an Error
     std::shared_ptr<World_map> get_map_view();
 
+    // update the Model ticks times, keeping track of the time spent doing so,
+    // jumping over quiet stretches if fast forwarding is on
+    void run_ticks(int ticks);
+    // Records the state the world has reached after a tick or jump, or checks it
+    // against the recording being replayed, throws Error if it differs
+    void check_tick();
+
+    // print how fast the simulation ran over a headless run
+    void print_run_report(int ticks, long long agent_updates, double wall_seconds) const;
+
+    // Returns the buffer output for the console must be written to so that it comes
+    // out after the frames still being rendered, nullptr if cout can be left alone
+    std::streambuf* get_console_output() const;
+    // Returns once every frame shown so far has been written out
+    void wait_until_rendered();
+
     // Containers for user command function pointers
     Agent_command_map_t       m_agent_commands;
     Group_command_map_t       m_group_commands;
@@ -89,8 +157,35 @@ private:
     std::vector<std::shared_ptr<View>> m_views;
     std::weak_ptr<World_map>           mp_map_view;
 
-    template<typename C>
-    typename C::mapped_type get_command_helper(C& commands, const std::string& command);
+    // In headless mode command output goes to mp_suppressed_output, mp_console_buf
+    // is the buffer cout wrote to before, which status and show still write to
+    bool                                m_headless;
+    std::unique_ptr<Counting_streambuf> mp_suppressed_output;
+    std::streambuf*                     mp_console_buf;
+    double                              m_tick_seconds;
+    bool                                m_fast_forward;
+
+    // set once a quit command is read from a script, how many scripts are being run
+    // from inside another, and the buffer words of a script are read into
+    bool                                m_quit_requested;
+    int                                 m_script_depth;
+    std::string                         m_script_word;
+
+    // The journal being recorded to, if any, and whether the command being executed
+    // is recorded, which commands that only run other commands turn off
+    std::unique_ptr<Journal_writer>     mp_journal;
+    bool                                m_is_recorded;
+    // The journal whose state hashes are being checked while replaying, if any, the
+    // next hash to check, and the time of the first tick that differed, -1 if none
+    const Journal_reader*               mp_verified_journal;
+    std::size_t                         m_next_state_hash;
+    int                                 m_divergence_time;
+
+    // Once views have been rendered in the background, everything for the console
+    // goes through the pipeline, and mp_console_buf is its output. Whether show
+    // renders in the background.
+    std::unique_ptr<Render_pipeline>    mp_render_pipeline;
+    bool                                m_render_async;
 
     // disallow copy/move construction or assignment
     Controller(const Controller&) = delete;
@@ -99,15 +194,4 @@ private:
     Controller& operator= (Controller&&) = delete;
 };
 
-template<typename C>
-typename C::mapped_type Controller::get_command_helper(C& commands, const std::string& command) {
-    typename C::iterator iter = commands.find(command);
-
-    if (iter == commands.end()) {
-        return nullptr;
-    }
-
-    return iter->second;
-}
-
 #endif // CONTROLLER_H
@@ -0,0 +1,117 @@
+#include "Event_log.h"
+#include <iostream>
+#include <utility>
+
+using std::string;
+using std::cout;
+
+Event_log* Event_log::get_instance() {
+    static Event_log the_event_log;
+    return &the_event_log;
+}
+
+Event_log::Event_log() :
+    m_stream(&m_buffer), m_writing(false), m_stopping(false)
+{
+    for (Level& min_level : m_min_levels) {
+        min_level = Level::DEBUG;
+    }
+    m_stream.flags(cout.flags());
+    m_stream.precision(cout.precision());
+}
+
+Event_log::~Event_log() {
+    set_background_writer(false);
+}
+
+Event_log::String_buffer::int_type Event_log::String_buffer::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        m_text.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize Event_log::String_buffer::xsputn(const char* s, std::streamsize n) {
+    m_text.append(s, n);
+    return n;
+}
+
+void Event_log::set_background_writer(bool on) {
+    if (on == has_background_writer()) {
+        return;
+    }
+
+    if (on) {
+        m_stopping = false;
+        m_writer = std::thread(&Event_log::writer_loop, this);
+        return;
+    }
+
+    // the writer finishes what it has been handed before it stops
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_cv.notify_one();
+    m_writer.join();
+}
+
+// Events logged from now on are formatted the way cout is set up now
+void Event_log::flush() {
+    m_stream.flags(cout.flags());
+    m_stream.precision(cout.precision());
+
+    string& text = m_buffer.get_text();
+    if (text.empty()) {
+        return;
+    }
+
+    if (!has_background_writer()) {
+        cout.write(text.data(), text.size());
+        cout.flush();
+        text.clear();
+        return;
+    }
+
+    // the buffer goes to the writer, a spare one takes its place
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_chunks.push_back(Chunk{cout.rdbuf(), string()});
+        m_chunks.back().text.swap(text);
+        if (!m_spare_texts.empty()) {
+            text.swap(m_spare_texts.back());
+            m_spare_texts.pop_back();
+        }
+    }
+    m_work_cv.notify_one();
+}
+
+void Event_log::wait_until_written() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]{ return m_chunks.empty() && !m_writing; });
+}
+
+// Writes chunks in the order they were handed over until stopped with none left
+void Event_log::writer_loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [this]{ return m_stopping || !m_chunks.empty(); });
+        if (m_chunks.empty()) {
+            return;
+        }
+
+        Chunk chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+        m_writing = true;
+        lock.unlock();
+
+        chunk.target->sputn(chunk.text.data(), chunk.text.size());
+        chunk.target->pubsync();
+        chunk.text.clear();
+
+        lock.lock();
+        m_spare_texts.push_back(std::move(chunk.text));
+        m_writing = false;
+        m_done_cv.notify_all();
+    }
+}
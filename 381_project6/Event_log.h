@@ -0,0 +1,110 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <streambuf>
+#include <ostream>
+
+/*
+Event_log collects what the objects in the world say as things happen to them. Each
+event has a category and a level, and is only formatted if its category's level
+filter lets it through, all of them by default. Events are formatted into a buffer
+that is written out to cout in one go when the Model finishes a tick and when the
+Controller finishes a command, instead of flushing cout after every line.
+
+With the background writer on, the buffer is instead handed to a writer thread so
+that the next tick can run while it is written. The Controller waits for the writer
+to catch up before prompting or printing anything itself, so either way the output
+comes out exactly as if every event had been printed as it happened.
+
+Events must only be logged from the thread running the Model update.
+*/
+
+class Event_log {
+public:
+    // What an event is about
+    enum Category { COMBAT, WORK, MOVEMENT, GROUP, NUM_CATEGORIES };
+    // How much an event matters: DEBUG for the routine progress of every tick,
+    // INFO for things happening, WARNING for orders that could not be carried out.
+    // A category filtered at OFF logs nothing.
+    enum class Level { DEBUG, INFO, WARNING, OFF };
+
+    // return pointer to the Event_log
+    static Event_log* get_instance();
+
+    // Returns true if events of category at level are logged
+    bool is_enabled(Category category, Level level) const
+        { return level >= m_min_levels[category]; }
+    // Returns the stream an event is formatted into, each event ends with a newline
+    std::ostream& get_stream() { return m_stream; }
+
+    // only log events of category at min_level or above
+    void set_level(Category category, Level min_level) { m_min_levels[category] = min_level; }
+    Level get_level(Category category) const { return m_min_levels[category]; }
+
+    // Turns the background writer thread on or off, waiting for it to finish first
+    void set_background_writer(bool on);
+    bool has_background_writer() const { return m_writer.joinable(); }
+
+    // Writes the events logged since the last flush to where cout currently writes,
+    // or hands them to the background writer
+    void flush();
+    // Returns once the background writer has written everything handed to it
+    void wait_until_written();
+
+    // disallow copy/move construction or assignment
+    Event_log(const Event_log&) = delete;
+    Event_log& operator= (const Event_log&) = delete;
+    Event_log(Event_log&&) = delete;
+    Event_log& operator= (Event_log&&) = delete;
+
+private:
+    Event_log();
+    ~Event_log();
+
+    // A streambuf that appends to a string, keeping its capacity when emptied
+    class String_buffer : public std::streambuf {
+    public:
+        std::string& get_text() { return m_text; }
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+    private:
+        std::string m_text;
+    };
+
+    // Text for the writer and the buffer it goes to
+    struct Chunk {
+        std::streambuf* target;
+        std::string     text;
+    };
+
+    // loop run by the writer thread
+    void writer_loop();
+
+    Level                   m_min_levels[NUM_CATEGORIES];
+    String_buffer           m_buffer;
+    std::ostream            m_stream;
+
+    std::thread             m_writer;
+    std::mutex              m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    std::deque<Chunk>       m_chunks;       // waiting to be written, oldest first
+    std::vector<std::string> m_spare_texts; // written out, kept for their capacity
+    bool                    m_writing;      // the writer is writing a chunk
+    bool                    m_stopping;
+};
+
+// Formats an event into the log if its category and level are enabled, as in
+// LOG_EVENT(COMBAT, INFO) << get_name() << ": Clang!" << endl;
+#define LOG_EVENT(category, level) \
+    if (!Event_log::get_instance()->is_enabled(Event_log::category, Event_log::Level::level)) {} \
+    else Event_log::get_instance()->get_stream()
+
+#endif // EVENT_LOG_H
@@ -2,6 +2,10 @@
 #include "Geometry.h"
 #include "Model.h"
 #include "Utility.h"
+#include "Snapshot.h"
+#include "Profiler.h"
+#include "Logistics.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 #include <cmath>
@@ -26,12 +30,14 @@ Farm::~Farm()
 // returns the specified amount, or the remaining amount, whichever is less,
 // and deducts that amount from the amount on hand
 double Farm::withdraw(double amount_to_get) {
+    PROFILE_COUNT(WITHDRAWALS);
+
     // return the max between the amount requested and the amount on hand
     double return_amount = fmin(amount_to_get, m_food_amount);
 
     // remove return amount from the amount on hand and have Model notify Views
     m_food_amount -= return_amount;
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
 
     return return_amount;
 }
@@ -39,7 +45,7 @@ double Farm::withdraw(double amount_to_get) {
 // ask model to notify views of current state
 void Farm::broadcast_current_state() const {
     Structure::broadcast_current_state();
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
 }
 
 
@@ -47,8 +53,29 @@ void Farm::broadcast_current_state() const {
 // notify Views
 void Farm::update() {
     m_food_amount += kFARM_PRODUCTION_RATE;
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
-    cout << "Farm " << get_name() << " now has " << m_food_amount << endl;
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
+    LOG_EVENT(WORK, DEBUG) << "Farm " << get_name() << " now has " << m_food_amount << endl;
+    Model::get_instance()->get_logistics().food_added(*this);
+}
+
+int Farm::get_quiet_updates() const {
+    return Model::get_instance()->get_logistics().get_updates_before_wake(*this);
+}
+
+double Farm::get_production_rate() const {
+    return kFARM_PRODUCTION_RATE;
+}
+
+// Added one update at a time so the sum rounds as it would have
+void Farm::fast_forward(int ticks_) {
+    if (ticks_ == 0) {
+        return;
+    }
+
+    for (int i = 0; i < ticks_; ++i) {
+        m_food_amount += kFARM_PRODUCTION_RATE;
+    }
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
 }
 
 // output information about the current state
@@ -57,3 +84,18 @@ void Farm::describe() const {
     Structure::describe();
     cout << "   Food available: " << m_food_amount << endl;
 }
+
+const string& Farm::get_type_string() const {
+    static const string my_type = "Farm";
+    return my_type;
+}
+
+void Farm::save_state(Snapshot_writer& writer) const {
+    Structure::save_state(writer);
+    writer.write_double(m_food_amount);
+}
+
+void Farm::restore_state(Snapshot_reader& reader) {
+    Structure::restore_state(reader);
+    m_food_amount = reader.read_double();
+}
@@ -20,6 +20,16 @@ public:
 
     // update adds the production amount to the stored amount
     void update() override;
+    // a Farm is always producing
+    bool is_active() const override { return true; }
+    // producing is quiet until it wakes a Peasant waiting for food
+    int get_quiet_updates() const override;
+    // add each update's production in turn, then have Model notify Views once
+    void fast_forward(int ticks_) override;
+
+    // all of the food on hand can be withdrawn, and the production rate is fixed
+    double get_available_amount() const override { return m_food_amount; }
+    double get_production_rate() const override;
 
     // output information about the current state
     void describe() const override;
@@ -27,6 +37,13 @@ public:
     // ask model to notify views of current state
     void broadcast_current_state() const override;
 
+    // return string "Farm"
+    const std::string& get_type_string() const override;
+
+    // write the food amount to a snapshot, and read it back
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // returns the specified amount, or the remaining amount, whichever is less,
     // and deducts that amount from the amount on hand
     double withdraw(double amount_to_get) override;
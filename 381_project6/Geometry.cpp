@@ -11,6 +11,12 @@ See Geometry.h for comments
 #include <iostream>
 #include <cmath>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 // calculate a value for pi
@@ -233,6 +239,209 @@ Cartesian_vector operator* (const Rotation2D& rot, const Cartesian_vector& cv) {
     return Cartesian_vector(new_cvx, new_cvy);
 }
 
+/***** Batch operations *****/
+// The vectorized loops handle whole groups of lanes, the scalar loops after them
+// the rest, so every element is computed by the same operations in the same order
+// as the operation on single values. The operations on lanes are macros rather than
+// functions so that they cost no more than the instructions themselves in an
+// unoptimized build.
+#if defined(__AVX__)
+#define GEOMETRY_SIMD
+using Lanes_t = __m256d;
+constexpr size_t kNUM_LANES = 4;
+#define LANES_LOAD _mm256_loadu_pd
+// the lanes are p[0], p[s], p[2 * s] and p[3 * s]
+#define LANES_LOAD_STRIDED(p, s) _mm256_set_pd((p)[3 * (s)], (p)[2 * (s)], (p)[(s)], (p)[0])
+#define LANES_STORE _mm256_storeu_pd
+#define LANES_SPLAT _mm256_set1_pd
+#define LANES_ADD _mm256_add_pd
+#define LANES_SUB _mm256_sub_pd
+#define LANES_MUL _mm256_mul_pd
+#define LANES_SQRT _mm256_sqrt_pd
+// the second argument where the first is NaN
+#define LANES_MIN _mm256_min_pd
+// bit i is set if lane i of a <= or == lane i of b
+#define LANES_MASK_LE(a, b) _mm256_movemask_pd(_mm256_cmp_pd((a), (b), _CMP_LE_OQ))
+#define LANES_MASK_EQ(a, b) _mm256_movemask_pd(_mm256_cmp_pd((a), (b), _CMP_EQ_OQ))
+#elif defined(__SSE2__)
+#define GEOMETRY_SIMD
+using Lanes_t = __m128d;
+constexpr size_t kNUM_LANES = 2;
+#define LANES_LOAD _mm_loadu_pd
+#define LANES_LOAD_STRIDED(p, s) _mm_set_pd((p)[(s)], (p)[0])
+#define LANES_STORE _mm_storeu_pd
+#define LANES_SPLAT _mm_set1_pd
+#define LANES_ADD _mm_add_pd
+#define LANES_SUB _mm_sub_pd
+#define LANES_MUL _mm_mul_pd
+#define LANES_SQRT _mm_sqrt_pd
+#define LANES_MIN _mm_min_pd
+#define LANES_MASK_LE(a, b) _mm_movemask_pd(_mm_cmple_pd((a), (b)))
+#define LANES_MASK_EQ(a, b) _mm_movemask_pd(_mm_cmpeq_pd((a), (b)))
+#endif
+
+#ifdef GEOMETRY_SIMD
+// lanes from p, p[s], ..., contiguous ones are loaded at once
+#define LANES_LOAD_ANY(p, s) ((s) == 1 ? LANES_LOAD(p) : LANES_LOAD_STRIDED((p), (s)))
+#endif
+
+namespace {
+    // the distance from p to (x, y), as cartesian_distance computes it
+    inline double distance_to(const Point& p, double x, double y) {
+        const double xd = x - p.x;
+        const double yd = y - p.y;
+        return sqrt(xd * xd + yd * yd);
+    }
+}
+
+void batch_distances(const Point& p, const double* xs, const double* ys, size_t n,
+                     double* distances, size_t stride)
+{
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    const Lanes_t px = LANES_SPLAT(p.x);
+    const Lanes_t py = LANES_SPLAT(p.y);
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        const Lanes_t xd = LANES_SUB(LANES_LOAD_ANY(xs + i * stride, stride), px);
+        const Lanes_t yd = LANES_SUB(LANES_LOAD_ANY(ys + i * stride, stride), py);
+        LANES_STORE(distances + i, LANES_SQRT(LANES_ADD(LANES_MUL(xd, xd), LANES_MUL(yd, yd))));
+    }
+#endif
+    for (; i < n; ++i) {
+        distances[i] = distance_to(p, xs[i * stride], ys[i * stride]);
+    }
+}
+
+size_t batch_within_distance(const Point& p, const double* xs, const double* ys, size_t n,
+                             double radius, char* mask, size_t stride)
+{
+    size_t count = 0;
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    const Lanes_t px = LANES_SPLAT(p.x);
+    const Lanes_t py = LANES_SPLAT(p.y);
+    const Lanes_t r = LANES_SPLAT(radius);
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        const Lanes_t xd = LANES_SUB(LANES_LOAD_ANY(xs + i * stride, stride), px);
+        const Lanes_t yd = LANES_SUB(LANES_LOAD_ANY(ys + i * stride, stride), py);
+        const int bits = LANES_MASK_LE(LANES_SQRT(LANES_ADD(LANES_MUL(xd, xd), LANES_MUL(yd, yd))), r);
+        for (size_t lane = 0; lane < kNUM_LANES; ++lane) {
+            const bool is_within = (bits >> lane) & 1;
+            mask[i + lane] = is_within;
+            count += is_within;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        const bool is_within = distance_to(p, xs[i * stride], ys[i * stride]) <= radius;
+        mask[i] = is_within;
+        count += is_within;
+    }
+    return count;
+}
+
+// The smallest value is found first, then where it first occurs
+size_t batch_arg_min(const double* values, size_t n) {
+    double smallest = HUGE_VAL;
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    if (n >= kNUM_LANES) {
+        Lanes_t lanes_smallest = LANES_SPLAT(HUGE_VAL);
+        for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+            lanes_smallest = LANES_MIN(LANES_LOAD(values + i), lanes_smallest);
+        }
+        double lane_values[kNUM_LANES];
+        LANES_STORE(lane_values, lanes_smallest);
+        for (double value : lane_values) {
+            smallest = (value < smallest) ? value : smallest;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        smallest = (values[i] < smallest) ? values[i] : smallest;
+    }
+
+    i = 0;
+#ifdef GEOMETRY_SIMD
+    const Lanes_t target = LANES_SPLAT(smallest);
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        const int bits = LANES_MASK_EQ(LANES_LOAD(values + i), target);
+        if (bits != 0) {
+            size_t lane = 0;
+            while (!((bits >> lane) & 1)) {
+                ++lane;
+            }
+            return i + lane;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (values[i] == smallest) {
+            return i;
+        }
+    }
+    return n;
+}
+
+void batch_rotate(const Rotation2D& rot, const double* xs, const double* ys, size_t n,
+                  double* out_xs, double* out_ys)
+{
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    const Lanes_t a0 = LANES_SPLAT(rot.a0);
+    const Lanes_t a1 = LANES_SPLAT(rot.a1);
+    const Lanes_t b0 = LANES_SPLAT(rot.b0);
+    const Lanes_t b1 = LANES_SPLAT(rot.b1);
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        const Lanes_t x = LANES_LOAD(xs + i);
+        const Lanes_t y = LANES_LOAD(ys + i);
+        LANES_STORE(out_xs + i, LANES_ADD(LANES_MUL(a0, x), LANES_MUL(a1, y)));
+        LANES_STORE(out_ys + i, LANES_ADD(LANES_MUL(b0, x), LANES_MUL(b1, y)));
+    }
+#endif
+    for (; i < n; ++i) {
+        const double x = xs[i];
+        const double y = ys[i];
+        out_xs[i] = rot.a0 * x + rot.a1 * y;
+        out_ys[i] = rot.b0 * x + rot.b1 * y;
+    }
+}
+
+void batch_translate(const Point& p, const double* delta_xs, const double* delta_ys,
+                     size_t n, double* out_xs, double* out_ys)
+{
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    const Lanes_t px = LANES_SPLAT(p.x);
+    const Lanes_t py = LANES_SPLAT(p.y);
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        LANES_STORE(out_xs + i, LANES_ADD(px, LANES_LOAD(delta_xs + i)));
+        LANES_STORE(out_ys + i, LANES_ADD(py, LANES_LOAD(delta_ys + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out_xs[i] = p.x + delta_xs[i];
+        out_ys[i] = p.y + delta_ys[i];
+    }
+}
+
+void batch_translate(const double* xs, const double* ys,
+                     const double* delta_xs, const double* delta_ys,
+                     size_t n, double* out_xs, double* out_ys)
+{
+    size_t i = 0;
+#ifdef GEOMETRY_SIMD
+    for (; i + kNUM_LANES <= n; i += kNUM_LANES) {
+        LANES_STORE(out_xs + i, LANES_ADD(LANES_LOAD(xs + i), LANES_LOAD(delta_xs + i)));
+        LANES_STORE(out_ys + i, LANES_ADD(LANES_LOAD(ys + i), LANES_LOAD(delta_ys + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out_xs[i] = xs[i] + delta_xs[i];
+        out_ys[i] = ys[i] + delta_ys[i];
+    }
+}
+
 /***** Utility function definitions *****/
 // There are 2pi radians in 360 degrees
 double to_radians (double theta_d)
@@ -3,6 +3,7 @@
 
 #include <iosfwd>
 #include <cmath>
+#include <cstddef>
 
 // TODO
 #include "Utility.h"
@@ -25,6 +26,11 @@ A Cartesian_vector is (delta_x, delta_y) - a displacement in Cartesian coordinat
 A Polar_vector is (r, theta) - a displacement in polar coordinates using radians.
 
 Various overloaded operators support computations of positions and directions.
+
+The batch operations work on many points or vectors at once, kept as separate
+arrays of x and y coordinates. They are vectorized with AVX when compiled with it
+(make AVX=1), otherwise with SSE2, or are plain loops where neither is available.
+Each result is exactly what the operation on single values would give.
 */
 
 // Tolerance used when comparing Points
@@ -173,4 +179,35 @@ std::ostream& operator<< (std::ostream& os, const Polar_vector& pv);
 Point operator* (const Rotation2D& rot, const Point& p);
 Cartesian_vector operator* (const Rotation2D& rot, const Cartesian_vector& cv);
 
+// *** Batch operations ***
+// Points and vectors i are (xs[i], ys[i]), output arrays may be the input arrays.
+// Where a stride is given they are (xs[i * stride], ys[i * stride]) instead, so the
+// coordinates can be read from an array of structs holding them.
+
+// distances[i] = cartesian_distance(p, point i), bit for bit, every lane performs the
+// same correctly rounded operations in the same order
+void batch_distances(const Point& p, const double* xs, const double* ys, std::size_t n,
+                     double* distances, std::size_t stride = 1);
+
+// mask[i] = whether cartesian_distance(p, point i) <= radius, returns how many are
+std::size_t batch_within_distance(const Point& p, const double* xs, const double* ys,
+                                  std::size_t n, double radius, char* mask,
+                                  std::size_t stride = 1);
+
+// Returns the index of the smallest of n values, the first if several are equal,
+// n if there are none. NaN values are never the smallest.
+std::size_t batch_arg_min(const double* values, std::size_t n);
+
+// point or vector i out = rot * point or vector i
+void batch_rotate(const Rotation2D& rot, const double* xs, const double* ys, std::size_t n,
+                  double* out_xs, double* out_ys);
+
+// point i out = p + vector i
+void batch_translate(const Point& p, const double* delta_xs, const double* delta_ys,
+                     std::size_t n, double* out_xs, double* out_ys);
+// point i out = point i + vector i
+void batch_translate(const double* xs, const double* ys,
+                     const double* delta_xs, const double* delta_ys,
+                     std::size_t n, double* out_xs, double* out_ys);
+
 #endif
@@ -2,39 +2,55 @@
 #include "Agent.h"
 #include "Utility.h"
 #include "Geometry.h"
+#include "Snapshot.h"
+#include "Profiler.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 #include <algorithm>
-#include <functional>
 #include <memory>
+#include <vector>
+#include <utility>
+#include <iterator>
 #include <cassert>
 
 using std::string;
 using std::cout; using std::endl;
-using std::for_each;
-using std::bind; using namespace std::placeholders;
+using std::vector;
+using std::for_each; using std::sort;
 using std::shared_ptr;
+using std::size_t;
 
 
 // How far away from the destination point each member should be when a move
 // command is given to a group with multiple members
 constexpr double kGROUP_MOVE_OFFSET_MAGNITUDE = 0.5;
 
-Group::Group(const string& name_) : m_name(name_)
+Group::Group(const string& name_) : m_num_dead_members(0), m_members_by_name_valid(false),
+    m_name(name_)
 {
 }
 
+Group::Group_members_t::const_iterator Group::lower_bound(Object_id_t id) const {
+    return std::lower_bound(m_members.begin(), m_members.end(), id,
+        [](const Member& member, Object_id_t query_id){ return member.id < query_id; });
+}
+
 bool Group::add_agent_helper(std::shared_ptr<Agent> agent) {
-    // Attempt to insert agent
-    auto return_val = m_members.insert(agent);
+    const Object_id_t id = agent->get_id();
+    auto iter = lower_bound(id);
 
-    // If agent was inserted then add this Group as a Death_observer
-    if (return_val.second) {
-        agent->add_to_my_groups(shared_from_this());
+    // Return false if agent is already present
+    if (iter != m_members.end() && iter->id == id) {
+        return false;
     }
 
-    // Returns true if agent was added, false if agent was already present
-    return return_val.second;
+    // Insert agent in id order and add this Group to the agent's Groups
+    m_members.insert(iter, Member{ id, agent });
+    agent->add_to_my_groups(shared_from_this());
+    invalidate_members_by_name();
+
+    return true;
 }
 
 void Group::add_agent(std::shared_ptr<Agent> agent) {
@@ -45,20 +61,22 @@ void Group::add_agent(std::shared_ptr<Agent> agent) {
         throw Error("Agent already a member of that Group!");
     }
 
-    cout << "Group " << m_name << ":  " << agent->get_name() << " added" << endl;
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  " << agent->get_name() << " added" << endl;
 }
 
 bool Group::remove_agent_helper(std::shared_ptr<Agent> agent) {
     // Try to find the Agent in the Group
-    auto iter = m_members.find(agent);
+    const Object_id_t id = agent->get_id();
+    auto iter = lower_bound(id);
 
     // return false if agent is not a member of this Group
-    if (iter == m_members.end()) {
+    if (iter == m_members.end() || iter->id != id) {
         return false;
     }
 
     // Remove Agent from Group
     m_members.erase(iter);
+    invalidate_members_by_name();
 
     // Indicate successful removal of agent from group
     return true;
@@ -75,37 +93,89 @@ void Group::remove_agent(std::shared_ptr<Agent> agent) {
     // Remove this Group from agent's death observers
     agent->remove_from_my_groups(shared_from_this());
 
-    cout << "Group " << m_name << ":  " << agent->get_name() << " removed" << endl;
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  " << agent->get_name() << " removed" << endl;
 }
 
+// The living members of other_group that are not already members are found and
+// merged in with one pass over each Group
 void Group::add_group(shared_ptr<Group> other_group) {
-    for_each(other_group->m_members.begin(), other_group->m_members.end(),
-        bind(&Group::add_agent_helper, this, _1));
+    auto member_id_less = [](const Member& lhs, const Member& rhs){ return lhs.id < rhs.id; };
+
+    Group_members_t new_members;
+    std::set_difference(other_group->m_members.begin(), other_group->m_members.end(),
+        m_members.begin(), m_members.end(), std::back_inserter(new_members), member_id_less);
+    new_members.erase(std::remove_if(new_members.begin(), new_members.end(),
+        [](const Member& member){ return !member.agent->is_alive(); }), new_members.end());
+
+    if (!new_members.empty()) {
+        const shared_ptr<Group>& this_ptr = shared_from_this();
+        for (auto& member : new_members) {
+            member.agent->add_to_my_groups(this_ptr);
+        }
+
+        Group_members_t merged_members;
+        merged_members.reserve(m_members.size() + new_members.size());
+        std::merge(std::make_move_iterator(m_members.begin()), std::make_move_iterator(m_members.end()),
+            std::make_move_iterator(new_members.begin()), std::make_move_iterator(new_members.end()),
+            std::back_inserter(merged_members), member_id_less);
+        m_members.swap(merged_members);
+        invalidate_members_by_name();
+    }
 
-    cout << "Group " << m_name << ":  group " << other_group->m_name << " added" << endl;
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  group " << other_group->m_name << " added" << endl;
 }
 
+// Members of other_group are removed with one pass over each Group
 void Group::remove_group(shared_ptr<Group> other_group) {
-    for_each(other_group->m_members.begin(), other_group->m_members.end(),
-        bind(&Group::remove_agent_helper, this, _1));
+    const Group_members_t& other_members = other_group->m_members;
+    const shared_ptr<Group>& this_ptr = shared_from_this();
 
-    cout << "Group " << m_name << ":  group " << other_group->m_name << " removed" << endl;
-}
+    Group_members_t remaining_members;
+    remaining_members.reserve(m_members.size());
+    auto other_iter = other_members.begin();
+    for (auto& member : m_members) {
+        while (other_iter != other_members.end() && other_iter->id < member.id) {
+            ++other_iter;
+        }
 
-void Group::clean_up_dead_agents() {
-    auto iter = m_members.begin();
-
-    // Remove each dead Agent from the members container
-    while (iter != m_members.end()) {
-        // If Agent is dead, remove it
-        if (!iter->get()->is_alive()) {
-            // Safely increment iterator
-            iter = m_members.erase(iter);
-            continue;
+        if (other_iter == other_members.end() || other_iter->id != member.id) {
+            remaining_members.push_back(std::move(member));
+        }
+        else if (member.agent->is_alive()) {
+            // Remove this Group from the removed agent's Groups
+            member.agent->remove_from_my_groups(this_ptr);
+        }
+        else {
+            --m_num_dead_members;
         }
+    }
+    m_members.swap(remaining_members);
+    invalidate_members_by_name();
+
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  group " << other_group->m_name << " removed" << endl;
+}
+
+void Group::member_died() {
+    ++m_num_dead_members;
+    invalidate_members_by_name();
+
+    // Don't let dead members pile up in a Group that is not being commanded
+    if (2 * m_num_dead_members >= static_cast<int>(m_members.size())) {
+        clean_up_dead_agents();
+    }
+}
 
-        iter++;
+void Group::clean_up_dead_agents() {
+    if (m_num_dead_members == 0) {
+        return;
     }
+
+    PROFILE_COUNT(DEAD_MEMBER_SWEEPS);
+
+    // Remove each dead Agent from the members container, keeping id order
+    m_members.erase(std::remove_if(m_members.begin(), m_members.end(),
+        [](const Member& member){ return !member.agent->is_alive(); }), m_members.end());
+    m_num_dead_members = 0;
 }
 
 void Group::disband() {
@@ -114,16 +184,121 @@ void Group::disband() {
     // Tell all members to remove this Group from their Groups containers
     const shared_ptr<Group>& this_ptr = shared_from_this();
     for_each(m_members.begin(), m_members.end(),
-        [&this_ptr](Group_members_t::value_type p){ p->remove_from_my_groups(this_ptr); });
+        [&this_ptr](Member& member){ member.agent->remove_from_my_groups(this_ptr); });
 
     m_members.clear();
+    invalidate_members_by_name();
+    m_members_by_name.clear();
+
+    // Unnest this Group from the Groups it is in, and its subgroups from it
+    while (!m_parents.empty()) {
+        m_parents.back()->unlink_subgroup(this_ptr);
+    }
+    while (!m_subgroups.empty()) {
+        unlink_subgroup(m_subgroups.back());
+    }
+}
+
+bool Group::contains_group(const Group* group) const {
+    return group == this || std::any_of(m_subgroups.begin(), m_subgroups.end(),
+        [group](const shared_ptr<Group>& subgroup){ return subgroup->contains_group(group); });
+}
+
+void Group::link_subgroup(shared_ptr<Group> subgroup) {
+    subgroup->m_parents.push_back(this);
+    m_subgroups.push_back(std::move(subgroup));
+    invalidate_members_by_name();
+}
+
+void Group::unlink_subgroup(const shared_ptr<Group>& subgroup) {
+    // keep subgroup alive until it has let go of this Group
+    shared_ptr<Group> subgroup_ptr = subgroup;
+    m_subgroups.erase(std::find(m_subgroups.begin(), m_subgroups.end(), subgroup_ptr));
+    auto& parents = subgroup_ptr->m_parents;
+    parents.erase(std::find(parents.begin(), parents.end(), this));
+    invalidate_members_by_name();
+}
+
+void Group::add_subgroup(shared_ptr<Group> subgroup) {
+    if (std::find(m_subgroups.begin(), m_subgroups.end(), subgroup) != m_subgroups.end()) {
+        throw Error("Group already a subgroup of that Group!");
+    }
+    if (subgroup->contains_group(this)) {
+        throw Error("Group cannot contain itself!");
+    }
+
+    link_subgroup(subgroup);
+
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  subgroup " << subgroup->m_name << " nested" << endl;
+}
+
+void Group::remove_subgroup(shared_ptr<Group> subgroup) {
+    if (std::find(m_subgroups.begin(), m_subgroups.end(), subgroup) == m_subgroups.end()) {
+        throw Error("Group not a subgroup of that Group!");
+    }
+
+    unlink_subgroup(subgroup);
+
+    LOG_EVENT(GROUP, INFO) << "Group " << m_name << ":  subgroup " << subgroup->m_name << " unnested" << endl;
+}
+
+void Group::collect_members(vector<shared_ptr<Agent>>& members,
+    std::unordered_set<const Group*>& visited_groups)
+{
+    if (!visited_groups.insert(this).second) {
+        return;
+    }
+
+    clean_up_dead_agents();
+    for (auto& member : m_members) {
+        members.push_back(member.agent);
+    }
+
+    for (auto& subgroup : m_subgroups) {
+        subgroup->collect_members(members, visited_groups);
+    }
 }
 
-// Returns approximate location of the group as a whole
+void Group::invalidate_members_by_name() {
+    m_members_by_name_valid = false;
+    for (Group* parent : m_parents) {
+        parent->invalidate_members_by_name();
+    }
+}
+
+// Returns the members, those of subgroups included, in name order, the order
+// in which they are commanded and listed. The list is only collected and sorted
+// again after a membership change, so a command walks it in O(members).
+const vector<shared_ptr<Agent>>& Group::get_members_by_name() {
+    if (m_members_by_name_valid) {
+        return m_members_by_name;
+    }
+
+    vector<shared_ptr<Agent>>& members = m_members_by_name;
+    members.clear();
+    members.reserve(m_members.size());
+    std::unordered_set<const Group*> visited_groups;
+    collect_members(members, visited_groups);
+
+    sort(members.begin(), members.end(), [](const shared_ptr<Agent>& lhs, const shared_ptr<Agent>& rhs){
+        return lhs->get_name() < rhs->get_name();
+    });
+
+    // An Agent in more than one of the Groups was collected once for each
+    if (!m_subgroups.empty()) {
+        members.erase(std::unique(members.begin(), members.end()), members.end());
+    }
+
+    m_members_by_name_valid = true;
+    return members;
+}
+
+// Returns approximate location of the group as a whole, members must be in
+// name order so that the sum is always accumulated in the same order
 // Assumes group member list contains only living Agents
-Point Group::calculate_location() const {
+Point Group::calculate_location(const vector<shared_ptr<Agent>>& members) const {
     // If group has no members then return a Point (0.0, 0.0)
-    if (m_members.empty()) {
+    if (members.empty()) {
         return Point(0.0, 0.0);
     }
 
@@ -132,14 +307,14 @@ Point Group::calculate_location() const {
     double new_py = 0.0;
 
     // Accumulate the values of the locations of all members of the group
-    for (auto p : m_members) {
+    for (auto& p : members) {
         const Point p_loc = p->get_location();
         new_px += p_loc.x;
         new_py += p_loc.y;
     }
 
     // Multiply accumulated values by weight to get average of all locations
-    const double weight = 1.0 / static_cast<double>(m_members.size());
+    const double weight = 1.0 / static_cast<double>(members.size());
     new_px *= weight;
     new_py *= weight;
 
@@ -148,24 +323,24 @@ Point Group::calculate_location() const {
 }
 
 void Group::move(const Point& destination) {
-    clean_up_dead_agents();
+    const vector<shared_ptr<Agent>>& members = get_members_by_name();
 
     // Do nothing if Group is empty
-    if (m_members.empty()) {
+    if (members.empty()) {
         return;
     }
 
-    Point group_location = calculate_location();
+    Point group_location = calculate_location(members);
 
     // Don't command the group to move if it is already there
     if (point_tolerance_compare_eq(group_location, destination)) {
-        cout << "Group " << m_name << " is already there!" << endl;
+        LOG_EVENT(GROUP, INFO) << "Group " << m_name << " is already there!" << endl;
         return;
     }
 
     // If Group only has one member then move that member to destination
-    if (m_members.size() == 1) {
-        m_members.begin()->get()->move_to(destination);
+    if (members.size() == 1) {
+        members.front()->move_to(destination);
         return;
     }
 
@@ -182,55 +357,142 @@ void Group::move(const Point& destination) {
     offset_heading.normalise();
 
     // Radians to rotate about destination per member
-    const double theta_per_member = (2.0 * get_pi()) / static_cast<double>(m_members.size());
+    const double theta_per_member = (2.0 * get_pi()) / static_cast<double>(members.size());
 
     // Rotation matrix for applying rotations
     const Rotation2D rotation_mat(theta_per_member);
 
-    for (auto p : m_members) {
-        p->move_to(destination + kGROUP_MOVE_OFFSET_MAGNITUDE * offset_heading);
+    // Each offset is the one before it rotated, so the offsets are found one by one,
+    // then all of them are added to destination at once
+    const size_t num_members = members.size();
+    vector<double> xs(num_members), ys(num_members);
+    for (size_t i = 0; i < num_members; ++i) {
+        const Cartesian_vector offset = kGROUP_MOVE_OFFSET_MAGNITUDE * offset_heading;
+        xs[i] = offset.delta_x;
+        ys[i] = offset.delta_y;
 
         // Apply the per member rotation to the offset heading
         offset_heading = rotation_mat * offset_heading;
     }
+    batch_translate(destination, xs.data(), ys.data(), num_members, xs.data(), ys.data());
+
+    for (size_t i = 0; i < num_members; ++i) {
+        members[i]->move_to(Point(xs[i], ys[i]));
+    }
 }
 
 void Group::stop() {
-    clean_up_dead_agents();
-
-    for (auto p : m_members) {
+    for (auto& p : get_members_by_name()) {
         p->stop();
     }
 }
 
 void Group::attack(std::shared_ptr<Agent> target) {
-    clean_up_dead_agents();
-
-    for (auto p : m_members) {
+    for (auto& p : get_members_by_name()) {
         p->start_attacking(target);
     }
 }
 
 void Group::work(std::shared_ptr<Structure> source, std::shared_ptr<Structure> destination) {
-    clean_up_dead_agents();
-
-    for (auto p : m_members) {
+    for (auto& p : get_members_by_name()) {
         p->start_working(source, destination);
     }
 }
 
 void Group::describe() {
-    clean_up_dead_agents();
+    const vector<shared_ptr<Agent>>& members = get_members_by_name();
 
     // Print the number of members this Group has along with their names
-    cout << "Group " << m_name << " has " << m_members.size() << " members:\n";
-    for_each(m_members.begin(), m_members.end(),
-        [](Group_members_t::value_type p){ cout << p->get_name() << endl; });
+    cout << "Group " << m_name << " has " << members.size() << " members:\n";
+    for (auto& p : members) {
+        cout << p->get_name() << endl;
+    }
+
+    if (!m_subgroups.empty()) {
+        cout << "Group " << m_name << " has " << m_subgroups.size() << " subgroups:";
+        for (auto& subgroup : m_subgroups) {
+            cout << ' ' << subgroup->m_name;
+        }
+        cout << endl;
+    }
 }
 
-bool Group::is_agent_member(std::shared_ptr<Agent> query) {
-    clean_up_dead_agents();
-    return m_members.find(query) != m_members.end();
+// Dead members are left for the next clean up, they can never match a live query
+bool Group::is_agent_member(std::shared_ptr<Agent> query) const {
+    const Object_id_t id = query->get_id();
+    auto iter = lower_bound(id);
+    if (iter != m_members.end() && iter->id == id) {
+        return true;
+    }
+
+    return std::any_of(m_subgroups.begin(), m_subgroups.end(),
+        [&query](const shared_ptr<Group>& subgroup){ return subgroup->is_agent_member(query); });
+}
+
+bool Group::is_agent_in_hierarchy(std::shared_ptr<Agent> query) const {
+    return is_agent_member(query) || std::any_of(m_parents.begin(), m_parents.end(),
+        [&query](const Group* parent){ return parent->is_agent_in_hierarchy(query); });
+}
+
+// Dead members have not necessarily been cleaned up yet, they are skipped
+void Group::save_state(Snapshot_writer& writer) const {
+    vector<const Agent*> living_members;
+    for (auto& member : m_members) {
+        if (member.agent->is_alive()) {
+            living_members.push_back(member.agent.get());
+        }
+    }
+
+    // ids depend on the order objects were created in, names do not
+    sort(living_members.begin(), living_members.end(), [](const Agent* lhs, const Agent* rhs){
+        return lhs->get_name() < rhs->get_name();
+    });
+
+    writer.write_i32(static_cast<int>(living_members.size()));
+    for (const Agent* agent_ptr : living_members) {
+        writer.write_object_ref(agent_ptr);
+    }
+}
+
+void Group::restore_state(Snapshot_reader& reader) {
+    assert(m_members.empty());
+
+    const int num_members = reader.read_count();
+    for (int i = 0; i < num_members; ++i) {
+        shared_ptr<Agent> agent_ptr = reader.read_object_ref<Agent>();
+        if (!agent_ptr || !add_agent_helper(agent_ptr)) {
+            throw Error("Snapshot file is corrupt!");
+        }
+    }
+}
+
+void Group::save_subgroups(Snapshot_writer& writer,
+    const std::unordered_map<const Group*, int>& index_of_group) const
+{
+    writer.write_i32(static_cast<int>(m_subgroups.size()));
+    for (auto& subgroup : m_subgroups) {
+        writer.write_i32(index_of_group.at(subgroup.get()));
+    }
+}
+
+void Group::restore_subgroups(Snapshot_reader& reader, const vector<shared_ptr<Group>>& groups) {
+    assert(m_subgroups.empty());
+
+    const int num_subgroups = reader.read_count();
+    for (int i = 0; i < num_subgroups; ++i) {
+        const int index = reader.read_i32();
+        if (index < 0 || index >= static_cast<int>(groups.size())) {
+            throw Error("Snapshot file is corrupt!");
+        }
+
+        const shared_ptr<Group>& subgroup = groups[index];
+        if (std::find(m_subgroups.begin(), m_subgroups.end(), subgroup) != m_subgroups.end() ||
+            subgroup->contains_group(this))
+        {
+            throw Error("Snapshot file is corrupt!");
+        }
+        link_subgroup(subgroup);
+    }
 }
 
 const string& Group::get_name() const {
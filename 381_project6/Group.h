@@ -2,18 +2,32 @@
 #include "Geometry.h"
 #include <string>
 #include <memory>
-#include <set>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 
+class Snapshot_writer;
+class Snapshot_reader;
+
+
+/*
+A Group commands its members as a whole. Besides Agents, a Group can contain other
+Groups as subgroups: every command given to a Group is given to the members of its
+subgroups as well, and anything later added to or removed from a subgroup is
+reflected in every Group it is nested in. An Agent is commanded at most once per
+command however many of the nested Groups it is in. Groups cannot contain themselves.
+*/
 
 class Group : public std::enable_shared_from_this<Group> {
 public:
     explicit Group(const std::string& name);
 
     // Alerts all members to remove this Group from their own Groups container
-    // then removes all members from Group
+    // then removes all members from Group, and unnests it from every Group
     void disband();
 
-    // Prints the Group's name, number of members, and lists the names of the members
+    // Prints the Group's name, number of members, and lists the names of the
+    // members, those of subgroups included, then names the subgroups if any
     void describe();
 
     // Interface for commanding all Group members
@@ -27,9 +41,29 @@ public:
     void remove_agent(std::shared_ptr<Agent> agent);
     void add_group(std::shared_ptr<Group> other_group);
     void remove_group(std::shared_ptr<Group> other_group);
-
-    // Returns true is query Agent is a member of this Group
-    bool is_agent_member(std::shared_ptr<Agent> query);
+    void add_subgroup(std::shared_ptr<Group> subgroup);
+    void remove_subgroup(std::shared_ptr<Group> subgroup);
+
+    // Called by a member Agent when it dies, the dead member is removed the
+    // next time the Group needs its members, or once half the Group is dead
+    void member_died();
+
+    // Returns true is query Agent is a member of this Group or of one of its
+    // subgroups. Does not modify the Group, so it is safe to call concurrently.
+    bool is_agent_member(std::shared_ptr<Agent> query) const;
+    // Returns true if query Agent is a member of this Group or of any Group this
+    // one is nested in. Safe to call concurrently.
+    bool is_agent_in_hierarchy(std::shared_ptr<Agent> query) const;
+
+    // Write the living members to a snapshot, and read them back into this
+    // Group, which must be empty, without any output
+    void save_state(Snapshot_writer& writer) const;
+    void restore_state(Snapshot_reader& reader);
+    // Write the subgroups as indexes into the snapshot's Groups, and read them
+    // back once every Group has been read
+    void save_subgroups(Snapshot_writer& writer,
+        const std::unordered_map<const Group*, int>& index_of_group) const;
+    void restore_subgroups(Snapshot_reader& reader, const std::vector<std::shared_ptr<Group>>& groups);
 
     // Returns name of the Groupo
     const std::string& get_name() const;
@@ -52,22 +86,52 @@ private:
     // is not present in Group and thus cannot be removed
     bool remove_agent_helper(std::shared_ptr<Agent> agent);
 
-    // Removes dead Agents from the Group
+    // Removes dead Agents from the Group if any have died since the last clean up
     void clean_up_dead_agents();
 
-    // Returns approximate location of the group as a whole
-    Point calculate_location() const;
+    // Returns true if group is this Group or is nested in it at any depth
+    bool contains_group(const Group* group) const;
+    // Nest subgroup in this Group, or take it out, without any checks or output
+    void link_subgroup(std::shared_ptr<Group> subgroup);
+    void unlink_subgroup(const std::shared_ptr<Group>& subgroup);
+
+    // Appends the members of this Group and its subgroups that have not been
+    // appended yet, visiting each Group once, after cleaning up the dead
+    void collect_members(std::vector<std::shared_ptr<Agent>>& members,
+        std::unordered_set<const Group*>& visited_groups);
 
-    // Comparator used to order members by name
-    struct Members_comp {
-        bool operator()(std::shared_ptr<Agent> lhs, std::shared_ptr<Agent> rhs) const {
-            return lhs->get_name() < rhs->get_name();
-        }
+    // Returns approximate location of the group as a whole
+    Point calculate_location(const std::vector<std::shared_ptr<Agent>>& members) const;
+
+    // Returns the members, those of subgroups included, in name order, the
+    // order in which they are commanded and listed. The list is kept until the
+    // membership of this Group or of one of its subgroups changes.
+    const std::vector<std::shared_ptr<Agent>>& get_members_by_name();
+    // Marks the name ordered members of this Group and every Group it is
+    // nested in as out of date
+    void invalidate_members_by_name();
+
+    // Members are kept in a vector sorted by object id, so membership tests
+    // are binary searches over integers and whole Groups can be merged in one pass
+    struct Member {
+        Object_id_t            id;
+        std::shared_ptr<Agent> agent;
     };
+    using Group_members_t = std::vector<Member>;
 
-    using Group_members_t = std::set<std::shared_ptr<Agent>, Members_comp>;
+    // Returns iterator to the first member whose id is not less than id
+    Group_members_t::const_iterator lower_bound(Object_id_t id) const;
 
     Group_members_t   m_members;
+    // number of members that have died and not yet been removed
+    int               m_num_dead_members;
+    // Groups nested directly in this one in the order they were nested, and
+    // the Groups this one is nested in directly, which keep it alive
+    std::vector<std::shared_ptr<Group>> m_subgroups;
+    std::vector<Group*>                 m_parents;
+    // members of this Group and its subgroups in name order, rebuilt when needed
+    std::vector<std::shared_ptr<Agent>> m_members_by_name;
+    bool              m_members_by_name_valid;
     const std::string m_name;
 };
 
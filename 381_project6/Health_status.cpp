@@ -2,16 +2,16 @@
 #include <iostream>
 
 using std::string;
-using std::cout; using std::endl;
+using std::ostream; using std::endl;
 
 Health_status::Health_status() : Status("health") 
 {
 }
 
-void Health_status::update_health(const string& name, double health) {
-    update_status(name, health);
+void Health_status::update_health(Object_id_t id, double health) {
+    update_status(id, health);
 }
 
-void Health_status::do_draw_header() {
-    cout << "Current Health:\n--------------" << endl;
+void Health_status::do_draw_header(ostream& os) {
+    os << "Current Health:\n--------------" << endl;
 }
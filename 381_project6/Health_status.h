@@ -12,9 +12,9 @@ class Health_status : public Status {
 public:
     explicit Health_status();
 
-    // Updates an objects health value, adds object name to container if the
+    // Updates an objects health value, adds object id to container if the
     // object is not already there.
-    void update_health(const std::string& name, double health) override;
+    void update_health(Object_id_t id, double health) override;
 
     Health_status(const Health_status&) = delete;
     Health_status& operator= (const Health_status&) = delete;
@@ -23,6 +23,6 @@ public:
 
 private:
     // Hook for drawing
-    void do_draw_header() override;
+    void do_draw_header(std::ostream& os) override;
 };
 #endif // HEALTH_STATUS_H
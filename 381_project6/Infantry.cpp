@@ -3,6 +3,8 @@
 #include "Structure.h"
 #include "Agent.h"
 #include "Model.h"
+#include "Snapshot.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 #include <memory>
@@ -14,7 +16,8 @@ using std::shared_ptr; using std::weak_ptr; using std::static_pointer_cast; usin
 
 
 Infantry::Infantry(const string& name, const Point& location, int start_health_)
-    : Agent(name, location, start_health_), m_infantry_state(Infantry_state::NOT_ATTACKING)
+    : Agent(name, location, start_health_), m_infantry_state(Infantry_state::NOT_ATTACKING),
+    m_plan_time(-1), m_plan_relocation_count(0)
 {
 }
 
@@ -25,8 +28,42 @@ void Infantry::stop_attacking() {
 // Have Infantry set a new target and attack it!
 void Infantry::engage_new_target(shared_ptr<Agent> new_target) {
     mp_target = weak_ptr<Agent>(new_target);
-    cout << get_name() << ": I'm attacking!" << endl;
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": I'm attacking!" << endl;
     m_infantry_state = Infantry_state::ATTACKING;
+    wake();
+}
+
+void Infantry::hit_target(int attack_strength) {
+    assert(is_target_alive());
+
+    Model* model_ptr = Model::get_instance();
+    if (model_ptr->get_combat_mode() == Model::Combat_mode::DEFERRED) {
+        model_ptr->queue_attack(get_id(), mp_target.lock()->get_id(), attack_strength);
+        return;
+    }
+
+    shared_ptr<Agent> this_ptr = static_pointer_cast<Agent>(shared_from_this());
+    mp_target.lock()->take_hit(attack_strength, this_ptr);
+    hit_landed();
+}
+
+void Infantry::hit_landed() {
+    if (!is_target_alive()) {
+        report_kill();
+        stop_attacking();
+    }
+}
+
+void Infantry::report_kill() const {
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": I triumph!" << endl;
+}
+
+bool Infantry::is_active() const {
+    return Agent::is_active() || m_infantry_state == Infantry_state::ATTACKING;
+}
+
+int Infantry::get_quiet_updates() const {
+    return m_infantry_state == Infantry_state::ATTACKING ? 0 : Agent::get_quiet_updates();
 }
 
 // output information about the current state
@@ -66,7 +103,7 @@ void Infantry::update() {
 
 // Overrides Agent's stop to print a message
 void Infantry::stop() {
-    cout << get_name() << ": Don't bother me" << endl;
+    LOG_EVENT(MOVEMENT, INFO) << get_name() << ": Don't bother me" << endl;
 }
 
 // Returns true if target is within attack range, prints message and stops
@@ -77,7 +114,7 @@ bool Infantry::target_range_handling() {
     if (cartesian_distance(get_location(), mp_target.lock()->get_location()) > get_range())
     {
         // if target is out of range, report it, stop attacking and forget target
-        cout << get_name() << ": Target is now out of range" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Target is now out of range" << endl;
         stop_attacking();
         return false;
     }
@@ -98,20 +135,20 @@ void Infantry::start_attacking(shared_ptr<Agent> target_ptr) {
 
     // Ensure infantry does not attack self
     if (target_ptr == shared_from_this()) {
-        cout << get_name() + ": I cannot attack myself!" << endl;
+        LOG_EVENT(COMBAT, WARNING) << get_name() + ": I cannot attack myself!" << endl;
         return;
     }
 
     // Check target is Alive, cannot attack target if not Alive
     if (!target_ptr->is_alive()) {
-        cout << get_name() + ": Target is not alive!" << endl;
+        LOG_EVENT(COMBAT, WARNING) << get_name() + ": Target is not alive!" << endl;
         return;
     }
 
     // Check if target is in range, cannot attack out of range target
     const double distance = cartesian_distance(get_location(), target_ptr->get_location());
     if (distance > get_range()) {
-        cout << get_name() + ": Target is out of range!" << endl;
+        LOG_EVENT(COMBAT, WARNING) << get_name() + ": Target is out of range!" << endl;
         return;
     }
 
@@ -119,6 +156,24 @@ void Infantry::start_attacking(shared_ptr<Agent> target_ptr) {
     engage_new_target(target_ptr);
 }
 
+// A target that has died is saved as none, either way it is not alive
+void Infantry::save_state(Snapshot_writer& writer) const {
+    Agent::save_state(writer);
+    writer.write_u8(static_cast<std::uint8_t>(m_infantry_state));
+    writer.write_object_ref(is_target_alive() ? mp_target.lock().get() : nullptr);
+}
+
+void Infantry::restore_state(Snapshot_reader& reader) {
+    Agent::restore_state(reader);
+
+    const int state = reader.read_u8();
+    if (state > static_cast<int>(Infantry_state::ATTACKING)) {
+        throw Error("Snapshot file is corrupt!");
+    }
+    m_infantry_state = static_cast<Infantry_state>(state);
+    mp_target = reader.read_object_ref<Agent>();
+}
+
 const weak_ptr<Agent>& Infantry::get_target() const noexcept {
     return mp_target;
 }
@@ -127,100 +182,50 @@ Infantry::Infantry_state Infantry::get_state() const noexcept {
     return m_infantry_state;
 }
 
-// Comparator for finding closest object to another object. The Comparator is 
-// initialized with the unique name of an object that we want to find the closest 
-// other object to. When used to search a container of objects, object that evaluates
-// as least is the object that is closest to the object used to init. In the event
-// of a tie the object with the lesser lexicographical name is least
-struct Closest_to_obj {
-    Closest_to_obj(shared_ptr<Sim_object> obj_ptr)
-        : m_location(obj_ptr->get_location()), m_name(obj_ptr->get_name())
-    {}
-
-    template <typename T>
-    bool operator()(T& lhs, T& rhs) const {
-        return closest_comp_helper(lhs.second, rhs.second);
-    }
-
-    // Compare distances and names of objects
-    // Note: this template only works with std::map iterators that point
-    // to Sim_objects or objects derived some Sim_object
-    bool closest_comp_helper(shared_ptr<Sim_object> lhs,
-        shared_ptr<Sim_object> rhs) const
-    {
-        // Check if either argument is the object used to init
-        // Object used to init always evaluates greater than any other
-        if (lhs->get_name() == m_name) {
-            return false;
-        }
-        if (rhs->get_name() == m_name) {
-            return true;
-        }
-
-        // get distances from args to init object
-        double dist_to_lhs = cartesian_distance(m_location, lhs->get_location());
-        double dist_to_rhs = cartesian_distance(m_location, rhs->get_location());
-
-        // resolves distance ties with name comparison
-        if (dist_to_lhs == dist_to_rhs) {
-            return lhs->get_name() < rhs->get_name();
-        }
-
-        // return true if lhs is closer than rhs
-        return dist_to_lhs < dist_to_rhs;
-    }
-
-    // name and location of object we want to find closest other to.
-    const Point m_location;
-    const string m_name;
-};
-
-// Comparator used to find closest Agent that is not grouped with passed
-// in agent
-struct Closest_hostile_to_agent : public Closest_to_obj {
-    Closest_hostile_to_agent(shared_ptr<Agent> agent)
-        : Closest_to_obj(agent), m_agent(agent)
-    {}
-
-    bool operator()(Model::Agents_t::value_type& lhs,
-                    Model::Agents_t::value_type& rhs) const
-    {
-        if (m_agent->agents_share_group(lhs.second)) {
-            return false;
-        }
-
-        return closest_comp_helper(lhs.second, rhs.second);
-    }
-
-    shared_ptr<Agent> m_agent;
-};
-
 // Returns pointer to closest Structure to this Infantry if one exists,
 // returns an empty pointer otherwise
 shared_ptr<Structure> Infantry::get_closest_structure() {
-    shared_ptr<Structure> structure = 
-        Model::get_instance()->find_min_structure(Closest_to_obj(shared_from_this()));
-
-    if (!structure || structure->get_name() == get_name()) {
-        return shared_ptr<Structure>();
-    }
+    return Model::get_instance()->find_nearest_structure(get_location());
+}
 
-    return structure;
+// Find the closest hostile ahead of update(), reading only the spatial index and
+// group memberships so it is safe to run concurrently with other plans
+void Infantry::plan_update() {
+    Model* model_ptr = Model::get_instance();
+    mp_planned_hostile = find_closest_hostile();
+    m_plan_time = model_ptr->get_time();
+    m_plan_relocation_count = model_ptr->get_relocation_count();
 }
 
 // Returns pointer to closest non-grouped Agent to this Infantry if one exists,
-// returns an empty pointer otherwise
+// returns an empty pointer otherwise.
+// The planned hostile is still the closest as long as it is alive and nobody has
+// changed location since it was found, deaths only ever remove other candidates.
 shared_ptr<Agent> Infantry::get_closest_hostile() {
-    shared_ptr<Agent> this_ptr = static_pointer_cast<Agent>(shared_from_this());
-    // Get an iterator to the closest hostile agent
-    shared_ptr<Agent> hostile_agent = 
-        Model::get_instance()->find_min_agent(Closest_hostile_to_agent(this_ptr));
-
-    // Check if a valid min element was found, return empty ptr if none found
-    if (!hostile_agent || agents_share_group(hostile_agent)) {
-        return shared_ptr<Agent>();
+    Model* model_ptr = Model::get_instance();
+    if (m_plan_time == model_ptr->get_time() &&
+        m_plan_relocation_count == model_ptr->get_relocation_count() &&
+        (!mp_planned_hostile || mp_planned_hostile->is_alive()))
+    {
+        m_plan_time = -1;
+        shared_ptr<Agent> planned_hostile;
+        planned_hostile.swap(mp_planned_hostile);
+        return planned_hostile;
     }
 
-    return hostile_agent;
+    m_plan_time = -1;
+    mp_planned_hostile.reset();
+    return find_closest_hostile();
 }
 
+// Searches the Model for the closest non-grouped Agent to this Infantry,
+// distance ties are resolved by name
+shared_ptr<Agent> Infantry::find_closest_hostile() {
+    shared_ptr<Agent> this_ptr = static_pointer_cast<Agent>(shared_from_this());
+
+    // Only the spatial index cells around this Infantry are searched
+    return Model::get_instance()->find_nearest_agent(get_location(),
+        [&this_ptr](const shared_ptr<Agent>& agent_ptr) {
+            return agent_ptr != this_ptr && !this_ptr->agents_share_group(agent_ptr);
+        });
+}
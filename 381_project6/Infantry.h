@@ -22,15 +22,30 @@ public:
     // Does Agent class update as well as do_update hook that base classes
     // can provide
     void update() override final;
+    // an Infantry has work to do while it is moving or attacking
+    bool is_active() const override;
+    // an attacking Infantry is never quiet
+    int get_quiet_updates() const override;
 
     // Overrides Agent's stop to print a message
     void stop() override;
 
+    // Find the closest hostile ahead of update() so the search can run concurrently
+    void plan_update() override;
+
     // Make this Infantry start attacking the target Agent.
     // Prints failure message if the target is the same as this Agent,
     // is out of range, or is not alive.
     void start_attacking(std::shared_ptr<Agent> target_ptr) override;
 
+    // write the attack state to a snapshot, and read it back
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
+    // Called once a hit this Infantry made has landed, reports the kill and stops
+    // attacking if the target has died
+    void hit_landed();
+
 protected:
     enum class Infantry_state { NOT_ATTACKING, ATTACKING };
 
@@ -41,7 +56,8 @@ protected:
     std::shared_ptr<Structure> get_closest_structure();
 
     // Returns pointer to closest non-grouped Agent to this Infantry if one exists,
-    // returns an empty pointer otherwise
+    // returns an empty pointer otherwise. Uses the result of plan_update() if it
+    // is still valid.
     std::shared_ptr<Agent> get_closest_hostile();
 
     // Accessors for derived classes to Infantry member variables
@@ -58,6 +74,10 @@ protected:
     // set new target and engage, outputs attacking message
     void engage_new_target(std::shared_ptr<Agent> new_target);
 
+    // Hit the target, which must be alive, with attack_strength. The hit lands at
+    // once, or at the end of the tick if the Model defers combat.
+    void hit_target(int attack_strength);
+
     // stop attacking and forget target
     void stop_attacking();
 
@@ -65,12 +85,23 @@ protected:
     // does nothing unless overridden
     virtual void do_update();
 
-    // Accessor hooks derived classes must provide
-    virtual const std::string& get_type_string() const = 0;
+    // Accessor hook derived classes must provide, along with get_type_string()
     virtual double get_range() const = 0;
 
+    // outputs the message for killing the target, "I triumph!" unless overridden
+    virtual void report_kill() const;
+
 private:
+    // Searches the Model for the closest non-grouped Agent
+    std::shared_ptr<Agent> find_closest_hostile();
+
     std::weak_ptr<Agent> mp_target;
     Infantry_state m_infantry_state;
+
+    // Closest hostile found by plan_update(), along with the time and Model
+    // relocation count when it was found
+    std::shared_ptr<Agent> mp_planned_hostile;
+    int m_plan_time;
+    int m_plan_relocation_count;
 };
 #endif // INFANTRY_H
@@ -0,0 +1,289 @@
+#include "Input_source.h"
+#include "Utility.h"
+#include <istream>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define INPUT_SOURCE_MMAP
+#endif
+
+using std::string;
+using std::size_t;
+using std::numeric_limits;
+
+bool Stream_input::read_word(string& word) {
+    m_is >> word;
+    return m_is.good();
+}
+
+bool Stream_input::read_int(int& value) {
+    m_is >> value;
+    return m_is.good();
+}
+
+bool Stream_input::read_double(double& value) {
+    m_is >> value;
+    return m_is.good();
+}
+
+int Stream_input::peek_past_blanks() {
+    while (m_is.peek() == ' ' || m_is.peek() == '\t') {
+        m_is.get();
+    }
+    return m_is.peek();
+}
+
+bool Stream_input::at_end() const {
+    return m_is.eof();
+}
+
+void Stream_input::skip_line() {
+    m_is.clear();
+    m_is.ignore(numeric_limits<std::streamsize>::max(), '\n');
+}
+
+// Longest number text read_double accepts
+const size_t kMAX_NUMBER_LENGTH = 64;
+
+static bool is_space(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+Text_input::Text_input() :
+    mp_end(nullptr), mp_next(nullptr), m_line(1), m_word_line(0)
+{
+}
+
+Text_input::Text_input(const char* begin, const char* end) :
+    mp_end(end), mp_next(begin), m_line(1), m_word_line(0)
+{
+}
+
+void Text_input::set_text(const char* begin, const char* end) {
+    mp_next = begin;
+    mp_end = end;
+    m_line = 1;
+    m_word_line = 0;
+}
+
+Script_file::Script_file(const string& filename) :
+    mp_mapping(nullptr), m_mapping_size(0)
+{
+#ifdef INPUT_SOURCE_MMAP
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw Error("Could not open file for reading!");
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+        void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mp_mapping = mapping;
+            m_mapping_size = file_stat.st_size;
+            madvise(mp_mapping, m_mapping_size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+#endif
+
+    // Files that cannot be mapped are read whole
+    if (mp_mapping) {
+        const char* begin = static_cast<const char*>(mp_mapping);
+        set_text(begin, begin + m_mapping_size);
+    }
+    else {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw Error("Could not open file for reading!");
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        m_contents = contents.str();
+        set_text(m_contents.data(), m_contents.data() + m_contents.size());
+    }
+}
+
+Script_file::~Script_file() {
+#ifdef INPUT_SOURCE_MMAP
+    if (mp_mapping) {
+        munmap(mp_mapping, m_mapping_size);
+    }
+#endif
+}
+
+void Text_input::skip_whitespace() {
+    while (mp_next != mp_end && is_space(*mp_next)) {
+        if (*mp_next == '\n') {
+            ++m_line;
+        }
+        ++mp_next;
+    }
+    m_word_line = m_line;
+}
+
+bool Text_input::next_word(const char*& word, size_t& length) {
+    skip_whitespace();
+    if (mp_next == mp_end) {
+        return false;
+    }
+
+    word = mp_next;
+    while (mp_next != mp_end && !is_space(*mp_next)) {
+        ++mp_next;
+    }
+    length = mp_next - word;
+    return true;
+}
+
+bool Text_input::read_word(string& word) {
+    const char* start;
+    size_t length;
+    if (!next_word(start, length)) {
+        return false;
+    }
+    word.assign(start, length);
+    return true;
+}
+
+// Reads an optional sign and at least one digit, the value must fit in an int
+bool Text_input::read_int(int& value) {
+    skip_whitespace();
+    const char* p = mp_next;
+    bool negative = false;
+    if (p != mp_end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == mp_end || !is_digit(*p)) {
+        return false;
+    }
+
+    // a negative number may go one further than a positive one
+    long long result = 0;
+    const long long limit = negative ? -static_cast<long long>(numeric_limits<int>::min())
+                                     : numeric_limits<int>::max();
+    for (; p != mp_end && is_digit(*p); ++p) {
+        result = result * 10 + (*p - '0');
+        if (result > limit) {
+            return false;
+        }
+    }
+
+    value = static_cast<int>(negative ? -result : result);
+    mp_next = p;
+    return true;
+}
+
+// Reads an optional sign, digits with an optional decimal point, and an optional
+// exponent, there must be at least one digit before the exponent
+bool Text_input::read_double(double& value) {
+    skip_whitespace();
+    const char* p = mp_next;
+    if (p != mp_end && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    int digits = 0;
+    for (; p != mp_end && is_digit(*p); ++p) {
+        ++digits;
+    }
+    if (p != mp_end && *p == '.') {
+        for (++p; p != mp_end && is_digit(*p); ++p) {
+            ++digits;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    // the exponent is only part of the number if digits follow it
+    if (p != mp_end && (*p == 'e' || *p == 'E')) {
+        const char* exponent = p + 1;
+        if (exponent != mp_end && (*exponent == '-' || *exponent == '+')) {
+            ++exponent;
+        }
+        if (exponent != mp_end && is_digit(*exponent)) {
+            for (p = exponent; p != mp_end && is_digit(*p); ++p) {}
+        }
+    }
+
+    // the buffer is not null terminated, so strtod works on a copy
+    const size_t length = p - mp_next;
+    if (length >= kMAX_NUMBER_LENGTH) {
+        return false;
+    }
+    char number[kMAX_NUMBER_LENGTH];
+    std::copy(mp_next, p, number);
+    number[length] = '\0';
+
+    errno = 0;
+    value = std::strtod(number, nullptr);
+    if (errno == ERANGE) {
+        return false;
+    }
+    mp_next = p;
+    return true;
+}
+
+int Text_input::peek_past_blanks() {
+    while (mp_next != mp_end && (*mp_next == ' ' || *mp_next == '\t')) {
+        ++mp_next;
+    }
+    return mp_next == mp_end ? EOF : static_cast<unsigned char>(*mp_next);
+}
+
+bool Text_input::at_end() const {
+    return mp_next == mp_end;
+}
+
+void Text_input::skip_line() {
+    while (mp_next != mp_end && *mp_next != '\n') {
+        ++mp_next;
+    }
+    if (mp_next != mp_end) {
+        ++mp_next;
+        ++m_line;
+    }
+}
+
+bool Recording_input::read_word(string& word) {
+    if (!m_input.read_word(word)) {
+        return false;
+    }
+    m_record += ' ';
+    m_record += word;
+    return true;
+}
+
+bool Recording_input::read_int(int& value) {
+    if (!m_input.read_int(value)) {
+        return false;
+    }
+    m_record += ' ';
+    m_record += std::to_string(value);
+    return true;
+}
+
+// Doubles are recorded with enough digits to read back exactly
+bool Recording_input::read_double(double& value) {
+    if (!m_input.read_double(value)) {
+        return false;
+    }
+    char number[kMAX_NUMBER_LENGTH];
+    std::snprintf(number, sizeof(number), " %.17g", value);
+    m_record += number;
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <string>
+#include <cstddef>
+#include <iosfwd>
+
+/*
+An Input_source supplies the words and numbers commands are read from, either an
+istream such as cin, or text in memory such as a Script_file, which is scanned in
+place. Words are separated by whitespace, commands may continue over several lines.
+*/
+
+class Input_source {
+public:
+    virtual ~Input_source() {}
+
+    // Reads the next word into word, returns false if there is none or reading failed
+    virtual bool read_word(std::string& word) = 0;
+    // Reads the number that follows, returns false if the input does not continue
+    // with one or reading failed
+    virtual bool read_int(int& value) = 0;
+    virtual bool read_double(double& value) = 0;
+
+    // Skips spaces and tabs and returns the next character without reading it,
+    // EOF at the end of the input
+    virtual int peek_past_blanks() = 0;
+
+    // Returns true once the input is exhausted
+    virtual bool at_end() const = 0;
+    // Discards the rest of the current line, clearing any failure
+    virtual void skip_line() = 0;
+
+    // Returns the line the last word was read from, 0 if lines are not counted
+    virtual int get_line_number() const { return 0; }
+};
+
+// Reads from an istream with its own extraction operators
+class Stream_input : public Input_source {
+public:
+    explicit Stream_input(std::istream& is_) : m_is(is_) {}
+
+    bool read_word(std::string& word) override;
+    bool read_int(int& value) override;
+    bool read_double(double& value) override;
+    int peek_past_blanks() override;
+    bool at_end() const override;
+    void skip_line() override;
+
+    // disallow copy/move construction or assignment
+    Stream_input(const Stream_input&) = delete;
+    Stream_input& operator= (const Stream_input&) = delete;
+    Stream_input(Stream_input&&) = delete;
+    Stream_input& operator= (Stream_input&&) = delete;
+
+private:
+    std::istream& m_is;
+};
+
+/*
+A Text_input scans words and numbers directly out of text in memory without
+allocating, keeping count of the lines. Numbers are read as far as they go, like the
+extraction operators do. The text is not copied and must outlive the scanning.
+*/
+class Text_input : public Input_source {
+public:
+    // scans nothing until set_text is called
+    Text_input();
+    Text_input(const char* begin, const char* end);
+
+    // starts scanning the text from begin to end at line 1
+    void set_text(const char* begin, const char* end);
+
+    // Reads the next word and returns its start and length, which stay valid as long
+    // as the text, returns false at the end of the text
+    bool next_word(const char*& word, std::size_t& length);
+
+    bool read_word(std::string& word) override;
+    bool read_int(int& value) override;
+    bool read_double(double& value) override;
+    int peek_past_blanks() override;
+    bool at_end() const override;
+    void skip_line() override;
+    int get_line_number() const override { return m_word_line; }
+
+    // disallow copy/move construction or assignment
+    Text_input(const Text_input&) = delete;
+    Text_input& operator= (const Text_input&) = delete;
+    Text_input(Text_input&&) = delete;
+    Text_input& operator= (Text_input&&) = delete;
+
+private:
+    // skip whitespace, counting the lines passed, and note the line reached
+    void skip_whitespace();
+
+    const char* mp_end;
+    const char* mp_next;
+    int         m_line;
+    int         m_word_line;
+};
+
+// A Script_file memory-maps the file, or reads it whole where it cannot be mapped,
+// and scans it in place
+class Script_file : public Text_input {
+public:
+    // Opens and maps filename, throws Error if it cannot be read
+    explicit Script_file(const std::string& filename);
+    ~Script_file();
+
+private:
+    // the mapping, nullptr if the file was read into m_contents instead
+    void*       mp_mapping;
+    std::size_t m_mapping_size;
+    std::string m_contents;
+};
+
+// Reads from another Input_source, adding the text of everything read to a record
+class Recording_input : public Input_source {
+public:
+    // record must outlive the Recording_input
+    Recording_input(Input_source& input_, std::string& record_) :
+        m_input(input_), m_record(record_) {}
+
+    bool read_word(std::string& word) override;
+    bool read_int(int& value) override;
+    bool read_double(double& value) override;
+    int peek_past_blanks() override { return m_input.peek_past_blanks(); }
+    bool at_end() const override { return m_input.at_end(); }
+    void skip_line() override { m_input.skip_line(); }
+    int get_line_number() const override { return m_input.get_line_number(); }
+
+    // disallow copy/move construction or assignment
+    Recording_input(const Recording_input&) = delete;
+    Recording_input& operator= (const Recording_input&) = delete;
+    Recording_input(Recording_input&&) = delete;
+    Recording_input& operator= (Recording_input&&) = delete;
+
+private:
+    Input_source& m_input;
+    std::string&  m_record;
+};
+
+#endif // INPUT_SOURCE_H
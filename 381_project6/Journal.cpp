@@ -0,0 +1,158 @@
+#include "Journal.h"
+#include "Utility.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+using std::string;
+using std::vector;
+using std::size_t;
+using std::uint8_t; using std::int32_t; using std::uint32_t; using std::uint64_t;
+
+// Identifies a journal file, followed by the format version
+static const char kJOURNAL_MAGIC[] = { 'P', '6', 'J', 'R', 'N', 'L' };
+constexpr uint32_t kJOURNAL_VERSION = 1;
+// Written in the writer's byte order, as in a snapshot
+constexpr uint32_t kJOURNAL_BYTE_ORDER_MARK = 0x01020304;
+// Tags of the entries
+constexpr uint8_t kCOMMAND_ENTRY = 1;
+constexpr uint8_t kSTATE_HASH_ENTRY = 2;
+
+static void throw_corrupt() {
+    throw Error("Journal file is corrupt!");
+}
+
+string get_build_info() {
+    string info = string("built ") + __DATE__ + " " + __TIME__;
+#ifdef __VERSION__
+    info += string(" with ") + __VERSION__;
+#endif
+    if (kPROFILING_ENABLED) {
+        info += ", profiling";
+    }
+    return info;
+}
+
+/* Journal_writer */
+
+Journal_writer::Journal_writer(const string& filename, const string& build_info,
+                               const string& start_snapshot) :
+    m_file(filename, std::ios::binary | std::ios::trunc)
+{
+    if (!m_file) {
+        throw Error("Could not open file for writing!");
+    }
+
+    m_file.write(kJOURNAL_MAGIC, sizeof(kJOURNAL_MAGIC));
+    write_u32(kJOURNAL_VERSION);
+    write_u32(kJOURNAL_BYTE_ORDER_MARK);
+    write_string(build_info);
+    write_string(start_snapshot);
+
+    if (!m_file.flush()) {
+        throw Error("Could not write journal file!");
+    }
+}
+
+void Journal_writer::write_u32(uint32_t value) {
+    m_file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// strings are written as their length followed by their characters
+void Journal_writer::write_string(const string& str) {
+    write_u32(static_cast<uint32_t>(str.size()));
+    m_file.write(str.data(), str.size());
+}
+
+void Journal_writer::write_command(int time, const string& command) {
+    m_file.put(static_cast<char>(kCOMMAND_ENTRY));
+    write_u32(static_cast<uint32_t>(time));
+    write_string(command);
+}
+
+void Journal_writer::write_state_hash(int time, uint64_t hash) {
+    m_file.put(static_cast<char>(kSTATE_HASH_ENTRY));
+    write_u32(static_cast<uint32_t>(time));
+    m_file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+}
+
+void Journal_writer::flush() {
+    if (!m_file.flush()) {
+        throw Error("Could not write journal file!");
+    }
+}
+
+/* Journal_reader */
+
+Journal_reader::Journal_reader(const string& filename) : m_pos(0)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw Error("Could not open file for reading!");
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    char magic[sizeof(kJOURNAL_MAGIC)];
+    if (m_data.size() < sizeof(magic) + 2 * sizeof(uint32_t)) {
+        throw Error("Not a journal file!");
+    }
+    read_bytes(magic, sizeof(magic));
+    const uint32_t version = read_u32();
+    const uint32_t byte_order_mark = read_u32();
+
+    if (!std::equal(std::begin(magic), std::end(magic), std::begin(kJOURNAL_MAGIC))) {
+        throw Error("Not a journal file!");
+    }
+    if (byte_order_mark != kJOURNAL_BYTE_ORDER_MARK) {
+        throw Error("Journal was recorded on a machine with a different byte order!");
+    }
+    if (version != kJOURNAL_VERSION) {
+        throw Error("Unsupported journal version!");
+    }
+
+    m_build_info = read_string();
+    const string start_snapshot = read_string();
+    m_start_snapshot.assign(start_snapshot.begin(), start_snapshot.end());
+
+    while (m_pos < m_data.size()) {
+        uint8_t tag;
+        read_bytes(&tag, sizeof(tag));
+        const int time = static_cast<int32_t>(read_u32());
+        if (tag == kCOMMAND_ENTRY) {
+            m_commands.push_back(Command{time, read_string()});
+        }
+        else if (tag == kSTATE_HASH_ENTRY) {
+            uint64_t hash;
+            read_bytes(&hash, sizeof(hash));
+            m_state_hashes.push_back(State_hash{time, hash});
+        }
+        else {
+            throw_corrupt();
+        }
+    }
+}
+
+void Journal_reader::read_bytes(void* data, size_t size) {
+    if (size > m_data.size() - m_pos) {
+        throw_corrupt();
+    }
+    std::memcpy(data, m_data.data() + m_pos, size);
+    m_pos += size;
+}
+
+uint32_t Journal_reader::read_u32() {
+    uint32_t value;
+    read_bytes(&value, sizeof(value));
+    return value;
+}
+
+string Journal_reader::read_string() {
+    const size_t length = read_u32();
+    if (length > m_data.size() - m_pos) {
+        throw_corrupt();
+    }
+    string str(m_data.data() + m_pos, length);
+    m_pos += length;
+    return str;
+}
@@ -0,0 +1,90 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+/*
+A journal records a session so that it can be replayed exactly. The file starts with
+a header: the magic bytes "P6JRNL", the format version, a byte order marker as in a
+snapshot, a description of the build that recorded it and a snapshot of the world
+when recording started. Entries follow, each a tag byte and the time it was made at:
+a command, as the text of the words and numbers it read, or the hash of the world
+after a tick (see Model::get_state_hash).
+
+Journal_writer writes entries as they are made, Journal_reader reads the whole file
+before anything is decoded. Both throw Error if the file cannot be written or read,
+the reader also throws if the file is not a journal or is cut short.
+*/
+
+class Journal_writer {
+public:
+    // Creates filename and writes the header with build_info and start_snapshot
+    Journal_writer(const std::string& filename, const std::string& build_info,
+                   const std::string& start_snapshot);
+
+    void write_command(int time, const std::string& command);
+    void write_state_hash(int time, std::uint64_t hash);
+    // write out everything written so far
+    void flush();
+
+    // disallow copy/move construction or assignment
+    Journal_writer(const Journal_writer&) = delete;
+    Journal_writer& operator= (const Journal_writer&) = delete;
+    Journal_writer(Journal_writer&&) = delete;
+    Journal_writer& operator= (Journal_writer&&) = delete;
+
+private:
+    void write_u32(std::uint32_t value);
+    void write_string(const std::string& str);
+
+    std::ofstream m_file;
+};
+
+class Journal_reader {
+public:
+    struct Command {
+        int         time;
+        std::string text;
+    };
+    struct State_hash {
+        int           time;
+        std::uint64_t hash;
+    };
+
+    // reads filename and decodes it whole
+    explicit Journal_reader(const std::string& filename);
+
+    const std::string& get_build_info() const { return m_build_info; }
+    const std::vector<char>& get_start_snapshot() const { return m_start_snapshot; }
+    // the commands and the hashes, each in the order they were recorded
+    const std::vector<Command>& get_commands() const { return m_commands; }
+    const std::vector<State_hash>& get_state_hashes() const { return m_state_hashes; }
+
+    // disallow copy/move construction or assignment
+    Journal_reader(const Journal_reader&) = delete;
+    Journal_reader& operator= (const Journal_reader&) = delete;
+    Journal_reader(Journal_reader&&) = delete;
+    Journal_reader& operator= (Journal_reader&&) = delete;
+
+private:
+    void read_bytes(void* data, std::size_t size);
+    std::uint32_t read_u32();
+    std::string read_string();
+
+    std::vector<char>       m_data;
+    std::size_t             m_pos;
+    std::string             m_build_info;
+    std::vector<char>       m_start_snapshot;
+    std::vector<Command>    m_commands;
+    std::vector<State_hash> m_state_hashes;
+};
+
+// Returns a description of this build: when and with what compiler it was built,
+// and whether profiling is compiled in
+std::string get_build_info();
+
+#endif // JOURNAL_H
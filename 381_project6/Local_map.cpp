@@ -7,36 +7,41 @@
 #include "Utility.h"
 
 using std::string;
-using std::cout; using std::endl;
+using std::ostream; using std::endl;
 
 
 // default Local_map settings
 constexpr double kDEFAULT_LOCALMAP_SCALE = 2.0;
 constexpr int kDEFAULT_LOCALMAP_SIZE = 9;
 
-Local_map::Local_map(const string& name) 
-    : Map(name, Point())
+Local_map::Local_map(const string& name, Object_id_t focus_id)
+    : Map(name, Point()), m_focus_id(focus_id)
 {
 }
 
-void Local_map::do_draw_header() {
-    cout << "Local view for: " << get_name() << endl;
+void Local_map::do_draw_header(ostream& os) {
+    os << "Local view for: " << get_name() << endl;
 }
 
-void Local_map::do_draw_body() {
-    Grid_info grid_info = generate_grid_info();
+void Local_map::do_draw_body(ostream& os) {
+    update_frame();
 
     // Print the objects that are on the grid
-    print_grid_helper(grid_info.m_grid);
+    print_grid_helper(os);
 }
 
-void Local_map::update_location(const string& name, const Point& location) {
-    Map::update_location(name, location);
+void Local_map::update_location(Object_id_t id, const Point& location) {
+    Map::update_location(id, location);
 
-    // if the name of the updated object is the same as the focus of this
-    // map then update this map's origin to the focus's new location plus
-    // the displacement from the origin to the center of the map
-    if (get_name() == name) {
+    // the focus is looked up by name after the map has been cleared
+    if (m_focus_id == kNO_OBJECT_ID && get_object_name(id) == get_name()) {
+        m_focus_id = id;
+    }
+
+    // if the updated object is the focus of this map then update this
+    // map's origin to the focus's new location plus the displacement
+    // from the origin to the center of the map
+    if (id == m_focus_id) {
         constexpr double displacement_amount = -(kDEFAULT_LOCALMAP_SIZE / 2.0) *
                                                  kDEFAULT_LOCALMAP_SCALE;
         const Cartesian_vector displacement(displacement_amount, displacement_amount);
@@ -44,6 +49,11 @@ void Local_map::update_location(const string& name, const Point& location) {
     }
 }
 
+void Local_map::clear() {
+    Map::clear();
+    m_focus_id = kNO_OBJECT_ID;
+}
+
 double Local_map::get_scale() const {
     return kDEFAULT_LOCALMAP_SCALE;
 }
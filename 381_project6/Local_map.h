@@ -14,9 +14,14 @@ struct Point;
 */
 class Local_map : public Map {
 public:
-    Local_map(const std::string& name);
+    // name is the name of the focus object, whose id is focus_id
+    Local_map(const std::string& name, Object_id_t focus_id);
 
-    void update_location(const std::string& name, const Point& location) override;
+    void update_location(Object_id_t id, const Point& location) override;
+
+    // Forgets the focus object's id too, it is found again by name when
+    // objects are next reported
+    void clear() override;
 
     Local_map() = delete;
     Local_map(const Local_map&) = delete;
@@ -26,11 +31,13 @@ public:
 
 private:
     // Hooks for drawing
-    void do_draw_header() override;
-    void do_draw_body() override;
+    void do_draw_header(std::ostream& os) override;
+    void do_draw_body(std::ostream& os) override;
 
     double get_scale() const override;
     int get_size() const override;
+
+    Object_id_t m_focus_id;
 };
 
 #endif // LOCAL_MAP_H
@@ -0,0 +1,301 @@
+#include "Logistics.h"
+#include "Model.h"
+#include "Structure.h"
+#include "Agent.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+using std::shared_ptr;
+using std::vector;
+
+// Number of Structures nearest to a Peasant considered when rebalancing
+constexpr int kREBALANCE_CANDIDATES = 8;
+
+Logistics::Logistics() : m_mode(Mode::OFF), m_next_ticket(1)
+{
+}
+
+// Peasants left waiting would never be woken once nothing queues them
+void Logistics::set_mode(Mode mode_) {
+    if (mode_ == Mode::OFF) {
+        for (const auto& claim_pair : m_claims) {
+            if (claim_pair.second.ticket != 0) {
+                Model::get_instance()->wake(claim_pair.first);
+            }
+        }
+        clear();
+    }
+    m_mode = mode_;
+}
+
+void Logistics::wait_for_food(Object_id_t peasant_id, const Structure& source, double request) {
+    const unsigned ticket = m_next_ticket++;
+    add_claim(peasant_id, source.get_id(), request, ticket);
+    m_sites[source.get_id()].waiters.push_back(Waiter{peasant_id, ticket});
+}
+
+void Logistics::head_for(Object_id_t peasant_id, const Structure& source, double request) {
+    add_claim(peasant_id, source.get_id(), request, 0);
+}
+
+// The Peasant's entry in a queue goes stale and is dropped when it reaches the head
+void Logistics::release(Object_id_t peasant_id) {
+    if (m_claims.empty()) {
+        return;
+    }
+
+    auto claim_it = m_claims.find(peasant_id);
+    if (claim_it == m_claims.end()) {
+        return;
+    }
+
+    auto site_it = m_sites.find(claim_it->second.structure_id);
+    assert(site_it != m_sites.end());
+    site_it->second.claimed -= claim_it->second.request;
+    m_claims.erase(claim_it);
+}
+
+// Peasants are woken in the order they started waiting, each is counted as taking
+// its whole request so that no more are woken than the food on hand can serve
+void Logistics::food_added(const Structure& structure) {
+    if (m_claims.empty()) {
+        return;
+    }
+    auto site_it = m_sites.find(structure.get_id());
+    if (site_it == m_sites.end()) {
+        return;
+    }
+
+    Site& site = site_it->second;
+    double available = structure.get_available_amount();
+    const bool produces = structure.get_production_rate() > 0.0;
+    while (!site.waiters.empty()) {
+        const Waiter waiter = site.waiters.front();
+        auto claim_it = m_claims.find(waiter.peasant_id);
+        if (claim_it == m_claims.end() || claim_it->second.ticket != waiter.ticket) {
+            site.waiters.pop_front();
+            continue;
+        }
+
+        const double request = claim_it->second.request;
+        if (available <= 0.0 || (produces && available < request)) {
+            break;
+        }
+
+        available -= request;
+        site.waiters.pop_front();
+        release(waiter.peasant_id);
+        Model::get_instance()->wake(waiter.peasant_id);
+    }
+}
+
+// The nearest Structures are the only ones worth walking to. Every candidate is
+// rated by when it could serve the Peasant: when it arrives, or when the food it
+// needs has been produced if that is later.
+shared_ptr<Structure> Logistics::find_better_source(const Point& location, double speed,
+    const shared_ptr<Structure>& source, const shared_ptr<Structure>& destination,
+    double request) const
+{
+    if (m_mode != Mode::REBALANCE || speed <= 0.0) {
+        return nullptr;
+    }
+
+    double best_updates = updates_until_served(*source, request);
+    shared_ptr<Structure> best_source;
+    for (const shared_ptr<Structure>& candidate :
+         Model::get_instance()->find_k_nearest_structures(location, kREBALANCE_CANDIDATES))
+    {
+        if (candidate == source || candidate == destination) {
+            continue;
+        }
+
+        const double updates = std::max(cartesian_distance(location, candidate->get_location()) / speed,
+                                         updates_until_served(*candidate, request));
+        if (updates < best_updates) {
+            best_updates = updates;
+            best_source = candidate;
+        }
+    }
+
+    return best_source;
+}
+
+// The head is woken by the production that brings the food on hand up to its
+// request, one production is kept back for rounding
+int Logistics::get_updates_before_wake(const Structure& structure) const {
+    auto site_it = m_sites.find(structure.get_id());
+    const double rate = structure.get_production_rate();
+    if (site_it == m_sites.end() || rate <= 0.0) {
+        return std::numeric_limits<int>::max();
+    }
+
+    const Claim* head_claim_ptr = find_head_claim(site_it->second);
+    if (!head_claim_ptr) {
+        return std::numeric_limits<int>::max();
+    }
+
+    const double updates = (head_claim_ptr->request - structure.get_available_amount()) / rate - 1.0;
+    if (updates <= 0.0) {
+        return 0;
+    }
+    return updates >= std::numeric_limits<int>::max() ? std::numeric_limits<int>::max()
+                                                      : static_cast<int>(updates);
+}
+
+bool Logistics::is_queued(Object_id_t peasant_id) const {
+    auto claim_it = m_claims.find(peasant_id);
+    return claim_it != m_claims.end() && claim_it->second.ticket != 0;
+}
+
+void Logistics::clear() {
+    m_sites.clear();
+    m_claims.clear();
+}
+
+// Sites and claims are written in snapshot order, which does not depend on the order
+// they were added in. Stale queue entries and sites with nothing to remember are
+// left out, they make no difference to what happens next.
+void Logistics::save_state(Snapshot_writer& writer) const {
+    writer.write_u8(static_cast<std::uint8_t>(m_mode));
+    writer.write_i32(static_cast<std::int32_t>(m_next_ticket));
+
+    auto snapshot_order = [&writer](Object_id_t lhs, Object_id_t rhs){
+        return writer.get_index(lhs) < writer.get_index(rhs);
+    };
+
+    vector<Object_id_t> site_ids;
+    for (const auto& site_pair : m_sites) {
+        if (site_pair.second.claimed != 0.0 || find_head_claim(site_pair.second)) {
+            site_ids.push_back(site_pair.first);
+        }
+    }
+    std::sort(site_ids.begin(), site_ids.end(), snapshot_order);
+
+    writer.write_i32(static_cast<int>(site_ids.size()));
+    for (Object_id_t structure_id : site_ids) {
+        const Site& site = m_sites.at(structure_id);
+        writer.write_id_ref(structure_id);
+        writer.write_double(site.claimed);
+
+        vector<Waiter> current_waiters;
+        std::copy_if(site.waiters.begin(), site.waiters.end(), std::back_inserter(current_waiters),
+            [this](const Waiter& waiter){ return is_current(waiter); });
+        writer.write_i32(static_cast<int>(current_waiters.size()));
+        for (const Waiter& waiter : current_waiters) {
+            writer.write_id_ref(waiter.peasant_id);
+            writer.write_i32(static_cast<std::int32_t>(waiter.ticket));
+        }
+    }
+
+    vector<Object_id_t> peasant_ids;
+    for (const auto& claim_pair : m_claims) {
+        peasant_ids.push_back(claim_pair.first);
+    }
+    std::sort(peasant_ids.begin(), peasant_ids.end(), snapshot_order);
+
+    writer.write_i32(static_cast<int>(peasant_ids.size()));
+    for (Object_id_t peasant_id : peasant_ids) {
+        const Claim& claim = m_claims.at(peasant_id);
+        writer.write_id_ref(peasant_id);
+        writer.write_id_ref(claim.structure_id);
+        writer.write_double(claim.request);
+        writer.write_i32(static_cast<std::int32_t>(claim.ticket));
+    }
+}
+
+void Logistics::restore_state(Snapshot_reader& reader) {
+    assert(m_sites.empty() && m_claims.empty());
+
+    const int mode = reader.read_u8();
+    if (mode > static_cast<int>(Mode::REBALANCE)) {
+        throw Error("Snapshot file is corrupt!");
+    }
+    m_mode = static_cast<Mode>(mode);
+    m_next_ticket = static_cast<unsigned>(reader.read_i32());
+
+    const int num_sites = reader.read_count();
+    for (int i = 0; i < num_sites; ++i) {
+        shared_ptr<Structure> structure_ptr = reader.read_object_ref<Structure>();
+        if (!structure_ptr || m_sites.count(structure_ptr->get_id())) {
+            throw Error("Snapshot file is corrupt!");
+        }
+
+        Site& site = m_sites[structure_ptr->get_id()];
+        site.claimed = reader.read_double();
+        const int num_waiters = reader.read_count();
+        for (int j = 0; j < num_waiters; ++j) {
+            shared_ptr<Agent> agent_ptr = reader.read_object_ref<Agent>();
+            const unsigned ticket = static_cast<unsigned>(reader.read_i32());
+            if (!agent_ptr) {
+                throw Error("Snapshot file is corrupt!");
+            }
+            site.waiters.push_back(Waiter{agent_ptr->get_id(), ticket});
+        }
+    }
+
+    const int num_claims = reader.read_count();
+    for (int i = 0; i < num_claims; ++i) {
+        shared_ptr<Agent> agent_ptr = reader.read_object_ref<Agent>();
+        shared_ptr<Structure> structure_ptr = reader.read_object_ref<Structure>();
+        const double request = reader.read_double();
+        const unsigned ticket = static_cast<unsigned>(reader.read_i32());
+        if (!agent_ptr || !structure_ptr || !m_sites.count(structure_ptr->get_id()) ||
+            !m_claims.emplace(agent_ptr->get_id(), Claim{structure_ptr->get_id(), request, ticket}).second)
+        {
+            throw Error("Snapshot file is corrupt!");
+        }
+    }
+
+    // Nothing waits or claims while logistics is off, and only current entries were saved
+    for (const auto& site_pair : m_sites) {
+        for (const Waiter& waiter : site_pair.second.waiters) {
+            if (m_mode == Mode::OFF || !is_current(waiter)) {
+                throw Error("Snapshot file is corrupt!");
+            }
+        }
+    }
+    if (m_mode == Mode::OFF && !m_claims.empty()) {
+        throw Error("Snapshot file is corrupt!");
+    }
+}
+
+void Logistics::add_claim(Object_id_t peasant_id, Object_id_t structure_id, double request,
+                          unsigned ticket)
+{
+    release(peasant_id);
+    m_claims[peasant_id] = Claim{structure_id, request, ticket};
+    m_sites[structure_id].claimed += request;
+}
+
+bool Logistics::is_current(const Waiter& waiter) const {
+    auto claim_it = m_claims.find(waiter.peasant_id);
+    return claim_it != m_claims.end() && claim_it->second.ticket == waiter.ticket;
+}
+
+const Logistics::Claim* Logistics::find_head_claim(const Site& site) const {
+    for (const Waiter& waiter : site.waiters) {
+        auto claim_it = m_claims.find(waiter.peasant_id);
+        if (claim_it != m_claims.end() && claim_it->second.ticket == waiter.ticket) {
+            return &claim_it->second;
+        }
+    }
+    return nullptr;
+}
+
+// A Structure that produces nothing can only serve what it has on hand
+double Logistics::updates_until_served(const Structure& structure, double request) const {
+    auto site_it = m_sites.find(structure.get_id());
+    const double claimed = site_it == m_sites.end() ? 0.0 : site_it->second.claimed;
+    const double shortfall = claimed + request - structure.get_available_amount();
+    if (shortfall <= 0.0) {
+        return 0.0;
+    }
+
+    const double rate = structure.get_production_rate();
+    return rate > 0.0 ? shortfall / rate : std::numeric_limits<double>::infinity();
+}
@@ -0,0 +1,116 @@
+#ifndef LOGISTICS_H
+#define LOGISTICS_H
+
+#include "Geometry.h"
+#include "Utility.h"
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+class Structure;
+class Snapshot_writer;
+class Snapshot_reader;
+
+/*
+Logistics coordinates Peasants collecting food. It is off unless a mode is selected,
+then a working Peasant that finds its source empty no longer asks again on every
+update: it waits in the source's queue, asleep, and is woken in turn once there is
+food for it. A Structure that produces food wakes the Peasant at the head of its
+queue once a full load has built up, one that does not wakes Peasants as far as
+the food on hand goes whenever food is deposited.
+
+When rebalancing, a Peasant that would have to wait first looks for a nearby
+Structure that can serve it sooner, counting the time to walk there, the food on
+hand, the expected production, and the food already claimed by other Peasants
+waiting there or on their way there after switching.
+
+Each Peasant holds at most one claim, at the Structure it waits at or is on its way
+to, and must release it once it collects, stops working or dies.
+*/
+
+class Logistics {
+public:
+    // OFF: Peasants ask their source again on every update until it has food.
+    // QUEUE: Peasants wait in their source's queue until woken.
+    // REBALANCE: as QUEUE, but Peasants switch to a source that can serve them sooner.
+    enum class Mode { OFF, QUEUE, REBALANCE };
+
+    Logistics();
+
+    // select the mode, turning logistics off wakes every waiting Peasant
+    void set_mode(Mode mode_);
+    Mode get_mode() const { return m_mode; }
+
+    // queue the Peasant peasant_id at source until it can collect request
+    void wait_for_food(Object_id_t peasant_id, const Structure& source, double request);
+    // claim request at source for a Peasant on its way there
+    void head_for(Object_id_t peasant_id, const Structure& source, double request);
+    // release the Peasant's claim, if it has one
+    void release(Object_id_t peasant_id);
+
+    // wake the Peasants waiting at structure that can now be served
+    void food_added(const Structure& structure);
+
+    // Returns a Structure other than source and destination that is expected to
+    // serve a Peasant at location moving at speed with request sooner than source,
+    // an empty pointer if there is none or not rebalancing
+    std::shared_ptr<Structure> find_better_source(const Point& location, double speed,
+        const std::shared_ptr<Structure>& source, const std::shared_ptr<Structure>& destination,
+        double request) const;
+
+    // Returns how many more updates the producing structure can produce before
+    // the Peasant at the head of its queue is woken
+    int get_updates_before_wake(const Structure& structure) const;
+
+    // Returns true if the Peasant peasant_id is waiting in a queue
+    bool is_queued(Object_id_t peasant_id) const;
+
+    // forget every queue and claim, the mode is kept
+    void clear();
+
+    // Write the mode, the queues in order, the claims and the ticket counter to a
+    // snapshot, and read them back into this Logistics, which must be empty
+    void save_state(Snapshot_writer& writer) const;
+    void restore_state(Snapshot_reader& reader);
+
+    // disallow copy/move construction or assignment
+    Logistics(const Logistics&) = delete;
+    Logistics& operator= (const Logistics&) = delete;
+    Logistics(Logistics&&) = delete;
+    Logistics& operator= (Logistics&&) = delete;
+
+private:
+    // A Peasant's claim on the food of a Structure. Queued claims have a ticket
+    // that matches its entry in the Structure's queue, others have ticket 0.
+    struct Claim {
+        Object_id_t structure_id;
+        double      request;
+        unsigned    ticket;
+    };
+    // An entry in a queue, stale once the Peasant's claim no longer has its ticket
+    struct Waiter {
+        Object_id_t peasant_id;
+        unsigned    ticket;
+    };
+    struct Site {
+        std::deque<Waiter> waiters;
+        double             claimed = 0.0;
+    };
+
+    // add a claim for the Peasant, releasing any it already has
+    void add_claim(Object_id_t peasant_id, Object_id_t structure_id, double request,
+                   unsigned ticket);
+    // returns true if waiter's entry still matches its Peasant's claim
+    bool is_current(const Waiter& waiter) const;
+    // returns the claim of the first waiter in site that is not stale, nullptr if none
+    const Claim* find_head_claim(const Site& site) const;
+    // expected updates until structure could serve request on top of its claims
+    double updates_until_served(const Structure& structure, double request) const;
+
+    Mode                                     m_mode;
+    std::unordered_map<Object_id_t, Site>    m_sites;
+    std::unordered_map<Object_id_t, Claim>   m_claims;
+    unsigned                                 m_next_ticket;
+};
+
+#endif // LOGISTICS_H
@@ -4,11 +4,16 @@
 #include "Geometry.h"
 #include "Model.h"
 #include "Utility.h"
+#include "Snapshot.h"
+#include "Profiler.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 #include <memory>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <limits>
 
 using std::string;
 using std::cout; using std::endl;
@@ -39,8 +44,9 @@ void Mage::teleport(Cartesian_vector dir) {
     // Mage must have a charge to teleport
     assert(m_charges > 0);
 
-    // Expend a charge for teleportation
+    // Expend a charge for teleportation, the Mage recharges on its updates
     --m_charges;
+    wake();
 
     // Calculate teleport target Point
     const Point& current_pos = get_location();
@@ -48,7 +54,7 @@ void Mage::teleport(Cartesian_vector dir) {
                  current_pos.y + kMAGE_INITIAL_RANGE * dir.delta_y);
 
     Agent::jump_to_location(target);
-    cout << get_name() << ": Poof! I'm over here!" << endl;
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": Poof! I'm over here!" << endl;
 }
 
 // Mages aren't stupid, they will listen when told to stop
@@ -56,7 +62,7 @@ void Mage::teleport(Cartesian_vector dir) {
 void Mage::stop() {
     Agent::stop();
     if (get_state() == Infantry_state::ATTACKING) {
-        cout << get_name() << ": Stopping my attack" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Stopping my attack" << endl;
         stop_attacking();
     }
 }
@@ -66,9 +72,11 @@ void Mage::stop() {
 // directly away from the attacker. If the attacker is at the same Point as the
 // Mage then the Mage will teleport/flee toward the nearest Structure
 void Mage::take_hit(int attack_strength, shared_ptr<Agent> attacker_ptr) {
+    PROFILE_COUNT(HITS_TAKEN);
+
     // If the Mage has no charges it cannot teleport away and will take damage
     if (m_charges == 0) {
-        cout << get_name() << ": Out of charges, can't evade hit!" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Out of charges, can't evade hit!" << endl;
         lose_health(attack_strength);
         return;
     }
@@ -109,6 +117,32 @@ void Mage::describe() const {
     cout << "   Charges " << m_charges << endl;
 }
 
+bool Mage::is_active() const {
+    return Infantry::is_active() || m_charges != kMAGE_MAX_CHARGES;
+}
+
+int Mage::get_quiet_updates() const {
+    if (get_state() == Infantry_state::NOT_ATTACKING && !is_moving()) {
+        return std::numeric_limits<int>::max();
+    }
+    return Infantry::get_quiet_updates();
+}
+
+// Counts the cooldown down a whole recharge at a time rather than by single updates
+void Mage::fast_forward(int ticks_) {
+    Infantry::fast_forward(ticks_);
+
+    while (ticks_ > 0 && m_charges != kMAGE_MAX_CHARGES) {
+        const int elapsed = std::min(ticks_, m_recharge_cooldown_timer);
+        ticks_ -= elapsed;
+        m_recharge_cooldown_timer -= elapsed;
+        if (m_recharge_cooldown_timer == 0) {
+            ++m_charges;
+            m_recharge_cooldown_timer = kMAGE_RECHARGE_TIME;
+        }
+    }
+}
+
 // do update tasks for Mage
 void Mage::do_update() {
     // Ensure member variables stay within expected range, should catch logic
@@ -134,7 +168,7 @@ void Mage::do_update() {
     // Mage is attacking
     // if target is dead, report it, stop attacking and forget target
     if (!is_target_alive()) {
-        cout << get_name() << ": Target is dead" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Target is dead" << endl;
         stop_attacking();
         return;
     }
@@ -148,24 +182,21 @@ void Mage::do_update() {
 
     // Check if Mage has charges to use for attack
     if (m_charges == 0) {
-        cout << get_name() << ": Must recharge before I attack..." << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Must recharge before I attack..." << endl;
     }
     else {
         // target is in range, aim to maim!
         // Use of attack spell expends a charge.
         --m_charges;
-        cout << get_name() << ": FWOOoosh!" << endl;
-        shared_ptr<Agent> this_ptr = static_pointer_cast<Agent>(shared_from_this());
-        get_target().lock()->take_hit(kMAGE_INITIAL_STRENGTH, this_ptr);
-
-        // If Mage killed the target, report it, stop attacking and forget target
-        if (!is_target_alive()) {
-            cout << get_name() << ": Play with fire, you get burned!" << endl;
-            stop_attacking();
-        }
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": FWOOoosh!" << endl;
+        hit_target(kMAGE_INITIAL_STRENGTH);
     }
 }
 
+void Mage::report_kill() const {
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": Play with fire, you get burned!" << endl;
+}
+
 // returns Mage's attack range
 double Mage::get_range() const {
     return kMAGE_INITIAL_RANGE;
@@ -176,3 +207,20 @@ const string& Mage::get_type_string() const {
     static const string my_type = "Mage";
     return my_type;
 }
+
+void Mage::save_state(Snapshot_writer& writer) const {
+    Infantry::save_state(writer);
+    writer.write_i32(m_charges);
+    writer.write_i32(m_recharge_cooldown_timer);
+}
+
+void Mage::restore_state(Snapshot_reader& reader) {
+    Infantry::restore_state(reader);
+    m_charges = reader.read_i32();
+    m_recharge_cooldown_timer = reader.read_i32();
+    if (m_charges < 0 || m_charges > kMAGE_MAX_CHARGES ||
+        m_recharge_cooldown_timer < 0 || m_recharge_cooldown_timer > kMAGE_RECHARGE_TIME)
+    {
+        throw Error("Snapshot file is corrupt!");
+    }
+}
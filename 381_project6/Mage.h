@@ -18,6 +18,10 @@ public:
 
     void describe() const override;
 
+    // write the charges to a snapshot, and read them back
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // disallow copy/move construction or assignment and default ctor
     Mage() = delete;
     Mage(const Mage&) = delete;
@@ -28,8 +32,16 @@ public:
 private:
     // do update tasks for Mage
     void do_update() override;
+    // a Mage also has work to do while it is recharging
+    bool is_active() const override;
+    // recharging is quiet, a Mage that only recharges is quiet indefinitely
+    int get_quiet_updates() const override;
+    // also regain the charges those updates would have given back
+    void fast_forward(int ticks_) override;
     // returns Mage's attack range
     double get_range() const override;
+    // a Mage has its own words for a kill
+    void report_kill() const override;
     // return string "Mage"
     const std::string& get_type_string() const override;
 
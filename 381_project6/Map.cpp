@@ -4,117 +4,352 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 #include <cmath>
+#include <cassert>
 
 
 using std::vector;
 using std::string;
-using std::cout; using std::endl;
+using std::size_t;
+using std::ostream;
+using std::ostringstream; using std::ios;
 using std::setw;
+using std::fill;
+
+// Names of the directions objects outside the grid are in, indexed as the off-grid
+// cells, and the order they are printed in
+static const char* const kOFFGRID_DIRECTION_NAMES[] = {
+    "southwest", "south", "southeast", "west", "", "east", "northwest", "north", "northeast"
+};
+static const int kOFFGRID_DIRECTION_ORDER[] = { 7, 8, 5, 2, 1, 0, 3, 6 };
 
 
 Map::Map(const string& name, const Point& origin)
-    : View(name), m_origin(origin)
+    : View(name), m_origin(origin), m_num_offgrid(0), m_detail(Detail::NAMES),
+      m_layout_is_stale(true), m_offgrid_is_stale(false)
 {
+    fill(m_offgrid_counts, m_offgrid_counts + kNUM_OFFGRID_DIRECTIONS, 0);
 }
 
-void Map::update_location(const string& name, const Point& location) {
-    m_grid_objects[name] = location;
-}
+void Map::update_location(Object_id_t id, const Point& location) {
+    if (id >= static_cast<Object_id_t>(m_grid_objects.size())) {
+        m_grid_objects.resize(id + 1, Map_object{ Point(), kNO_CELL, 0, false });
+    }
+
+    Map_object& obj = m_grid_objects[id];
+    obj.location = location;
+
+    // A new object starts out in no cell, and may be outside the grid
+    if (!obj.is_present) {
+        obj.is_present = true;
+        obj.cell = kNO_CELL;
+        m_offgrid_is_stale = true;
+    }
 
-void Map::update_remove(const string& name) {
-    auto iter = m_grid_objects.find(name);
+    // cells are only tracked while the layout is current
+    if (!m_layout_is_stale) {
+        move_to_cell(id, get_cell(location));
+    }
+}
 
-    // Do nothing if name not found
-    if (iter == m_grid_objects.end()) {
+void Map::update_remove(Object_id_t id) {
+    // Do nothing if id not found
+    if (id >= static_cast<Object_id_t>(m_grid_objects.size()) ||
+        !m_grid_objects[id].is_present) {
         return;
     }
 
-    // Remove found object
-    m_grid_objects.erase(iter);
+    // Take the object out of its cell, then remove it
+    if (!m_layout_is_stale) {
+        move_to_cell(id, kNO_CELL);
+    }
+    m_grid_objects[id].is_present = false;
+    m_offgrid_is_stale = true;
+}
+
+// returns the cell containing location, one of the off-grid cells if outside the grid
+int Map::get_cell(const Point& location) {
+    int col, row;
+    if (!get_subscripts(col, row, location)) {
+        // off-grid subscripts are clamped to one step outside the grid
+        const int size = get_size();
+        const int dx = (col < 0) ? -1 : (col >= size) ? 1 : 0;
+        const int dy = (row < 0) ? -1 : (row >= size) ? 1 : 0;
+        return kOFFGRID_CELLS - (3 * (dy + 1) + (dx + 1));
+    }
+
+    return row * get_size() + col;
 }
 
-Map::Grid_info Map::generate_grid_info() {
-    // Holds any objects found to be off the grid
-    Grid_info grid_info{ Grid_t(get_size(), vector<vector<char>>(get_size(), vector<char> {'.', ' '})),
-                         Offgrid_objs_t() };
+// move object id from its current cell to new_cell, marking both cells dirty
+void Map::move_to_cell(Object_id_t id, int new_cell) {
+    Map_object& obj = m_grid_objects[id];
+    const int old_cell = obj.cell;
+    if (old_cell == new_cell) {
+        return;
+    }
 
-    // Add objects to the grid to be drawn
-    for (auto& pair : m_grid_objects) {
-        // row and column of the cell
-        int row, col;
-        bool is_on_grid = get_subscripts(col, row, pair.second);
+    // which objects are outside the grid only changes when one leaves or enters it
+    if (is_offgrid(old_cell) != is_offgrid(new_cell)) {
+        m_offgrid_is_stale = true;
+    }
 
-        // If offgrid, add to offgrid container then continue to next object
-        if (!is_on_grid) {
-            grid_info.m_offgrid_objs.push_back(&pair.first);
-            continue;
+    if (is_offgrid(old_cell)) {
+        --m_offgrid_counts[kOFFGRID_CELLS - old_cell];
+        --m_num_offgrid;
+    }
+    else if (old_cell != kNO_CELL) {
+        // the last occupant takes the place of the one leaving
+        vector<Object_id_t>& occupants = m_cell_occupants[old_cell];
+        const Object_id_t last_id = occupants.back();
+        occupants[obj.occupant_index] = last_id;
+        m_grid_objects[last_id].occupant_index = obj.occupant_index;
+        occupants.pop_back();
+        if (!m_is_cell_dirty[old_cell]) {
+            m_is_cell_dirty[old_cell] = true;
+            m_dirty_cells.push_back(old_cell);
         }
+    }
 
-        // check if cell is empty, empty cell indicated by '.' in first position
-        if (grid_info.m_grid[row][col][0] == '.') {
-            // cell is empty, add the object
-            grid_info.m_grid[row][col][0] = pair.first[0];
-            grid_info.m_grid[row][col][1] = pair.first[1];
+    if (is_offgrid(new_cell)) {
+        ++m_offgrid_counts[kOFFGRID_CELLS - new_cell];
+        ++m_num_offgrid;
+    }
+    else if (new_cell != kNO_CELL) {
+        vector<Object_id_t>& occupants = m_cell_occupants[new_cell];
+        obj.occupant_index = static_cast<int>(occupants.size());
+        occupants.push_back(id);
+        if (!m_is_cell_dirty[new_cell]) {
+            m_is_cell_dirty[new_cell] = true;
+            m_dirty_cells.push_back(new_cell);
+        }
+    }
+
+    obj.cell = new_cell;
+}
+
+// write the two characters that show cell's occupants into the frame
+void Map::write_cell(int cell) {
+    const int size = get_size();
+    const size_t pos = m_row_offsets[cell / size] + 2 * (cell % size);
+    const vector<Object_id_t>& occupants = m_cell_occupants[cell];
+
+    if (occupants.empty()) {
+        // empty cell
+        m_frame[pos] = '.';
+        m_frame[pos + 1] = ' ';
+    }
+    else if (m_detail == Detail::COUNTS) {
+        // up to 99 objects are counted, more are shown as "++"
+        const size_t count = occupants.size();
+        if (count < 10) {
+            m_frame[pos] = static_cast<char>('0' + count);
+            m_frame[pos + 1] = ' ';
+        }
+        else if (count < 100) {
+            m_frame[pos] = static_cast<char>('0' + count / 10);
+            m_frame[pos + 1] = static_cast<char>('0' + count % 10);
         }
         else {
-            // cell is already occupied, indicate multiple objects in cell
-            grid_info.m_grid[row][col][0] = '*';
-            grid_info.m_grid[row][col][1] = ' ';
+            m_frame[pos] = '+';
+            m_frame[pos + 1] = '+';
         }
     }
-
-    return grid_info;
+    else if (m_detail == Detail::DENSITY) {
+        // one glyph for 1, 2 to 3, 4 to 9, 10 to 99, 100 to 999 and 1000 or more objects
+        static const char kDENSITY_GLYPHS[] = { '-', '+', 'o', 'O', '#', '@' };
+        const size_t count = occupants.size();
+        const int glyph = (count == 1) ? 0 : (count < 4) ? 1 : (count < 10) ? 2 :
+                          (count < 100) ? 3 : (count < 1000) ? 4 : 5;
+        m_frame[pos] = kDENSITY_GLYPHS[glyph];
+        m_frame[pos + 1] = ' ';
+    }
+    else if (occupants.size() == 1) {
+        // a single object is shown by the first two letters of its name
+        const string& name = get_object_name(occupants.front());
+        m_frame[pos] = name[0];
+        m_frame[pos + 1] = name[1];
+    }
+    else {
+        // multiple objects in cell
+        m_frame[pos] = '*';
+        m_frame[pos + 1] = ' ';
+    }
 }
 
-void Map::print_grid_helper(const Grid_t &grid) {
-    // Print doubles with no decimal points
-    cout.precision(0);
+// project every object and rebuild the frame, including the axis labels
+void Map::rebuild_frame() {
+    const int size = get_size();
+    const double scale = get_scale();
+    const size_t num_cells = static_cast<size_t>(size) * size;
+
+    // Reuse the cell containers, they keep their capacity
+    m_cell_occupants.resize(num_cells);
+    for (auto& occupants : m_cell_occupants) {
+        occupants.clear();
+    }
+    m_is_cell_dirty.assign(num_cells, false);
+    m_dirty_cells.clear();
+    fill(m_offgrid_counts, m_offgrid_counts + kNUM_OFFGRID_DIRECTIONS, 0);
+    m_num_offgrid = 0;
+
+    for (Object_id_t id = 0; id < static_cast<Object_id_t>(m_grid_objects.size()); ++id) {
+        Map_object& obj = m_grid_objects[id];
+        obj.cell = obj.is_present ? get_cell(obj.location) : kNO_CELL;
+        if (is_offgrid(obj.cell)) {
+            ++m_offgrid_counts[kOFFGRID_CELLS - obj.cell];
+            ++m_num_offgrid;
+        }
+        else if (obj.cell != kNO_CELL) {
+            vector<Object_id_t>& occupants = m_cell_occupants[obj.cell];
+            obj.occupant_index = static_cast<int>(occupants.size());
+            occupants.push_back(id);
+        }
+    }
+    m_offgrid_is_stale = true;
+
+    // Labels are printed as doubles with no decimal points
+    ostringstream label;
+    label.setf(ios::fixed, ios::floatfield);
+    label.precision(0);
 
-    // Print Grid
-    for (int i = get_size() - 1; i >= 0; i--) {
+    m_frame.clear();
+    m_row_offsets.assign(size, 0);
+
+    // Grid rows from the top down
+    for (int i = size - 1; i >= 0; i--) {
         // Y-axis labels every 3 lines
         if (i % 3 != 0) {
-            cout << "    "; // leading spaces when no axis label
+            m_frame += "    "; // leading spaces when no axis label
         }
         else {
-            cout << setw(4) << m_origin.y + get_scale() * static_cast<double>(i);
+            label.str("");
+            label << setw(4) << m_origin.y + scale * static_cast<double>(i);
+            m_frame += label.str();
         }
 
-        cout << ' '; // One space between label and grid items
-
-        // Print current grid row
-        for (int j = 0; j < get_size(); j++) {
-            cout << grid[i][j][0] << grid[i][j][1];
-        }
+        m_frame += ' '; // One space between label and grid items
 
-        cout << '\n';
+        // cells are filled in below
+        m_row_offsets[i] = m_frame.size();
+        m_frame.append(2 * size, ' ');
+        m_frame += '\n';
     }
 
     // X-axis labels
-    for (int i = 0; i < get_size(); i = i + 3) {
-        cout << "  " << setw(4) << m_origin.x + get_scale() * static_cast<double>(i);
+    for (int i = 0; i < size; i = i + 3) {
+        label.str("");
+        label << setw(4) << m_origin.x + scale * static_cast<double>(i);
+        m_frame += "  ";
+        m_frame += label.str();
+    }
+    m_frame += '\n';
+
+    for (int cell = 0; cell < static_cast<int>(num_cells); ++cell) {
+        write_cell(cell);
+    }
+
+    m_layout_is_stale = false;
+}
+
+void Map::update_frame() {
+    if (m_layout_is_stale) {
+        rebuild_frame();
+        return;
+    }
+
+    // Only the cells whose occupants changed need rewriting
+    for (int cell : m_dirty_cells) {
+        write_cell(cell);
+        m_is_cell_dirty[cell] = false;
+    }
+    m_dirty_cells.clear();
+}
+
+// The frame is written all at once
+void Map::print_grid_helper(ostream& os) {
+    os.write(m_frame.data(), m_frame.size());
+    os.flush();
+}
+
+// Returns the objects that are not visible on the grid, in name order
+const Map::Offgrid_objs_t& Map::get_offgrid_objs() {
+    assert(!m_layout_is_stale);
+
+    if (m_offgrid_is_stale) {
+        m_offgrid_objs.clear();
+        for (Object_id_t id = 0; id < static_cast<Object_id_t>(m_grid_objects.size()); ++id) {
+            const Map_object& obj = m_grid_objects[id];
+            if (obj.is_present && is_offgrid(obj.cell)) {
+                m_offgrid_objs.push_back(id);
+            }
+        }
+
+        sort_by_object_name(m_offgrid_objs);
+        m_offgrid_is_stale = false;
     }
-    cout << endl;
+
+    return m_offgrid_objs;
 }
 
-void Map::print_offgrid_helper(const vector<const string*> &offgrid_objects) {
+void Map::print_offgrid_helper(ostream& os, const Offgrid_objs_t &offgrid_objects) {
     auto iter = offgrid_objects.begin();
 
     // First offgrid object (no comma in front)
-    cout << **iter;
+    os << get_object_name(*iter);
     iter++;
 
     // All subsequent offgrid objects (preceded by commas)
     while (iter != offgrid_objects.end()) {
-        cout << ", " << *(*iter++);
+        os << ", " << get_object_name(*iter++);
+    }
+
+    os << " outside the map\n";
+}
+
+// e.g. "3 objects outside the map: 2 north, 1 southwest"
+void Map::print_offgrid_summary(ostream& os) {
+    assert(!m_layout_is_stale);
+
+    if (m_num_offgrid == 0) {
+        return;
     }
 
-    cout << " outside the map\n";
+    os << m_num_offgrid << (m_num_offgrid == 1 ? " object" : " objects") << " outside the map";
+    const char* separator = ": ";
+    for (int direction : kOFFGRID_DIRECTION_ORDER) {
+        if (m_offgrid_counts[direction] > 0) {
+            os << separator << m_offgrid_counts[direction] << ' '
+               << kOFFGRID_DIRECTION_NAMES[direction];
+            separator = ", ";
+        }
+    }
+    os << '\n';
+}
+
+// Only the characters of the cells change, the frame is kept
+void Map::set_detail(Detail detail) {
+    if (detail == m_detail) {
+        return;
+    }
+
+    m_detail = detail;
+    if (!m_layout_is_stale) {
+        for (int cell = 0; cell < static_cast<int>(m_cell_occupants.size()); ++cell) {
+            write_cell(cell);
+        }
+    }
 }
 
 void Map::clear() {
     m_grid_objects.clear();
+    m_offgrid_objs.clear();
+    fill(m_offgrid_counts, m_offgrid_counts + kNUM_OFFGRID_DIRECTIONS, 0);
+    m_num_offgrid = 0;
+    m_offgrid_is_stale = false;
+    invalidate_layout();
 }
 
 const Point& Map::get_origin() const {
@@ -123,6 +358,11 @@ const Point& Map::get_origin() const {
 
 void Map::set_origin(const Point& origin) {
     m_origin = origin;
+    invalidate_layout();
+}
+
+void Map::invalidate_layout() {
+    m_layout_is_stale = true;
 }
 
 // Calculate the cell subscripts corresponding to the supplied location parameter, 
@@ -138,8 +378,13 @@ bool Map::get_subscripts(int &ix, int &iy, Point location)
     // truncate coordinates to integer after taking the floor
     // floor function will return the largest integer smaller than the supplied value
     // even for negative values, so -0.05 => -1., which will be outside the array.
-    ix = int(floor(subscripts.delta_x));
-    iy = int(floor(subscripts.delta_y));
+    // Subscripts outside the grid are clamped to -1 or size before they are
+    // converted, a distant location would overflow an int.
+    const double size = get_size();
+    const double x = std::max(-1.0, std::min(floor(subscripts.delta_x), size));
+    const double y = std::max(-1.0, std::min(floor(subscripts.delta_y), size));
+    ix = int(x);
+    iy = int(y);
     // if out of range, return false
     if ((ix < 0) || (ix >= get_size()) || (iy < 0) || (iy >= get_size())) {
         return false;
@@ -4,43 +4,57 @@
 #include "View.h"
 #include "Geometry.h"
 #include <string>
-#include <map>
 #include <vector>
+#include <cstddef>
+#include <iosfwd>
 
-// Map is an abstract base class for Views that draw a visual representation 
-// of some area of the world
+// Map is an abstract base class for Views that draw a visual representation
+// of some area of the world.
+// The drawn grid is kept in a persistent text frame along with the objects
+// occupying each cell. Moving an object only rewrites the cells it left and
+// entered, the whole frame is only rebuilt when the origin, scale or size change.
+// The number of objects in each cell and outside the grid in each direction is kept
+// up to date as they move, so a Map can also show how many objects are where, in the
+// same time and space however many objects there are.
 class Map : public View {
 public:
-    // Save the supplied name and location for future use in a draw() call
-    // If the name is already present,the new location replaces the previous one.
-    void update_location(const std::string& name, const Point& location) override;
+    // How a cell with objects in it is shown: by the first two letters of the name of
+    // its only object or '*', by the number of objects in it, or by a glyph for about
+    // how many objects are in it
+    enum class Detail { NAMES, COUNTS, DENSITY };
 
-    // Remove the name and its location; no error if the name is not present.
-    void update_remove(const std::string& name) override;
+    // Save the supplied id and location for future use in a draw() call
+    // If the id is already present,the new location replaces the previous one.
+    void update_location(Object_id_t id, const Point& location) override;
+
+    // Remove the id and its location; no error if the id is not present.
+    void update_remove(Object_id_t id) override;
 
     // Discard the saved information - drawing will show only a empty pattern
     void clear() override;
 
 protected:
-    using Grid_t = std::vector<std::vector<std::vector<char>>>;
-    using Offgrid_objs_t = std::vector<const std::string*>;
-
-    struct Grid_info {
-        Grid_t         m_grid;
-        Offgrid_objs_t m_offgrid_objs;
-    };
+    using Offgrid_objs_t = std::vector<Object_id_t>;
 
     // Constructor sets the name and default size, scale, and origin
     Map(const std::string& name, const Point& origin);
 
-    // Populates a grid that represents an area of the world with representations
-    // of objects and stores a list of objects that lie outside grid
-    Grid_info generate_grid_info();
-    // Prints the grid along with axis label info
-    void print_grid_helper(const Grid_t &grid);
-    // Prints objects that are not visible on the grid, offgrid objects must be in
-    // passed in container before function is called
-    void print_offgrid_helper(const Offgrid_objs_t &objs);
+    // Brings the frame and the list of objects outside the grid up to date,
+    // must be called before either is printed
+    void update_frame();
+    // Prints the grid along with axis label info to os
+    void print_grid_helper(std::ostream& os);
+    // Returns the objects that are not visible on the grid, in name order
+    const Offgrid_objs_t& get_offgrid_objs();
+    // Prints objects that are not visible on the grid to os, there must be at least one
+    void print_offgrid_helper(std::ostream& os, const Offgrid_objs_t &objs);
+    // Prints how many objects are not visible on the grid, and in which directions, to os
+    // if there are any
+    void print_offgrid_summary(std::ostream& os);
+
+    Detail get_detail() const { return m_detail; }
+    // Cells are shown in detail from the next update_frame on
+    void set_detail(Detail detail);
 
     // returns reference to Map's origin Point
     const Point& get_origin() const;
@@ -48,17 +62,64 @@ protected:
     // any values are legal for the origin
     virtual void set_origin(const Point& origin);
 
+    // Derived classes call this whenever their size or scale changes
+    void invalidate_layout();
+
     // Hooks used to get the size and scale of a Map derived class
     virtual double get_scale() const = 0;
     virtual int get_size() const = 0;
 
 private:
-    using Map_objects_t = std::map<std::string, Point>;
+    // cell of objects that are in no cell, as they were removed or are not yet placed
+    static constexpr int kNO_CELL = -1;
+    // Objects outside the grid are in one of these cells, one for each direction the
+    // grid is left in: kOFFGRID_CELLS - (3 * (dy + 1) + (dx + 1)), where dx and dy are
+    // -1, 0 or 1 and not both 0
+    static constexpr int kOFFGRID_CELLS = -2;
+    static constexpr int kNUM_OFFGRID_DIRECTIONS = 9;
+
+    // Location of an object, the cell it occupies and where it is in the cell's
+    // occupants, indexed by the object's id
+    struct Map_object {
+        Point location;
+        int   cell;
+        int   occupant_index;
+        bool  is_present;
+    };
+    using Map_objects_t = std::vector<Map_object>;
 
     bool get_subscripts(int &ix, int &iy, Point location);
+    // returns the cell containing location, one of the off-grid cells if outside the grid
+    int get_cell(const Point& location);
+    static bool is_offgrid(int cell) { return cell <= kOFFGRID_CELLS; }
+
+    // move object id from its current cell to new_cell
+    void move_to_cell(Object_id_t id, int new_cell);
+    // project every object and rebuild the frame, including the axis labels
+    void rebuild_frame();
+    // write the two characters that show cell's occupants into the frame
+    void write_cell(int cell);
+
+    Point                                 m_origin;
+    Map_objects_t                         m_grid_objects;
+
+    // The rendered grid with its labels, and where each row's cells start in it
+    std::string                           m_frame;
+    std::vector<std::size_t>              m_row_offsets;
+    // Objects in each cell, cells are numbered row * size + column
+    std::vector<std::vector<Object_id_t>> m_cell_occupants;
+    // Objects outside the grid in each direction, indexed by kOFFGRID_CELLS - cell
+    int                                   m_offgrid_counts[kNUM_OFFGRID_DIRECTIONS];
+    int                                   m_num_offgrid;
+    Detail                                m_detail;
+    // Cells whose occupants changed since the frame was last updated
+    std::vector<int>                      m_dirty_cells;
+    std::vector<char>                     m_is_cell_dirty;
+    // origin, scale or size changed, every object's cell must be recomputed
+    bool                                  m_layout_is_stale;
 
-    Point         m_origin;
-    Map_objects_t m_grid_objects;
+    Offgrid_objs_t                        m_offgrid_objs;
+    bool                                  m_offgrid_is_stale;
 };
 
 #endif // MAP_H
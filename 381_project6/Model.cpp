@@ -5,17 +5,35 @@
 #include "Sim_object.h"
 #include "Structure.h"
 #include "Agent.h"
+#include "Infantry.h"
 #include "Group.h"
 #include "Utility.h"
 #include "View.h"
+#include "Spatial_grid.h"
+#include "Movement_system.h"
+#include "Worker_pool.h"
+#include "Logistics.h"
+#include "Snapshot.h"
+#include "Profiler.h"
+#include "Event_log.h"
 #include <algorithm>
 #include <map>
+#include <unordered_set>
+#include <cstddef>
+#include <limits>
 #include <cassert>
 
 using std::string;
 using std::shared_ptr;
-using std::min_element; using std::find; using std::for_each;
-using std::map;
+using std::vector;
+using std::size_t;
+using std::find; using std::for_each; using std::lower_bound; using std::remove_if;
+
+// Side length of the cells of the spatial indexes, on the order of the attack
+// ranges of Agents so range searches touch only a handful of cells
+constexpr double kSPATIAL_GRID_CELL_SIZE = 8.0;
+// Relative and absolute slack added to watch ranges when looking for watchers to wake
+constexpr double kWATCH_RANGE_MARGIN = 1e-9;
 
 // class used to deallocate Model
 class Model_destroyer {
@@ -38,7 +56,16 @@ Model* Model::get_instance() {
     return mp_instance;
 }
 
-Model::Model() : m_time(0) 
+Model::Model()
+    : mp_movement_system(new Movement_system()), m_num_every_tick_views(0),
+    mp_agent_grid(new Spatial_grid<Agent>(kSPATIAL_GRID_CELL_SIZE)),
+    mp_structure_grid(new Spatial_grid<Structure>(kSPATIAL_GRID_CELL_SIZE)),
+    mp_logistics(new Logistics()),
+    m_is_order_stale(false), m_update_position(-1), m_is_updating(false),
+    mp_watcher_grid(new Spatial_grid<Agent>(kSPATIAL_GRID_CELL_SIZE)), m_max_watch_range(0.0),
+    m_is_resolving_attacks(false),
+    m_time(0), m_tick_mode(Tick_mode::SEQUENTIAL),
+    m_combat_mode(Combat_mode::IMMEDIATE), m_relocation_count(0), m_agent_update_count(0)
 {
 }
 
@@ -70,147 +97,836 @@ bool Model::is_name_in_use(const string& name) const {
            is_group_present(name);
 }
 
-shared_ptr<Sim_object> Model::get_obj_ptr(const string& name) const {
-    auto iter = m_sim_objs.find(name);
+// returns the id of the live object named name, kNO_OBJECT_ID if there is none
+Object_id_t Model::find_id(const string& name) const {
+    auto iter = m_ids_by_name.find(name);
 
-    // if not found return an empty ptr
-    if (iter == m_sim_objs.end()) {
-        return shared_ptr<Sim_object>();
+    // if not found return an invalid id
+    if (iter == m_ids_by_name.end()) {
+        return kNO_OBJECT_ID;
     }
 
     return iter->second;
 }
 
-bool Model::is_structure_present(const string& name) const {
-    auto iter = m_structures.find(name);
+// look up the pointer stored for name's id, empty pointer if there is none
+template <typename T>
+static shared_ptr<T> find_helper(const vector<shared_ptr<T>>& objs_by_id, Object_id_t id) {
+    if (id == kNO_OBJECT_ID) {
+        return shared_ptr<T>();
+    }
 
+    return objs_by_id[id];
+}
+
+shared_ptr<Sim_object> Model::get_obj_ptr(const string& name) const {
+    return find_helper(m_objs_by_id, find_id(name));
+}
+
+// intern obj_ptr's name as a new id and store it under that id, the id is
+// also placed in name order among the other objects' ids
+void Model::add_object(const shared_ptr<Sim_object>& obj_ptr) {
+    const Object_id_t id = static_cast<Object_id_t>(m_names.size());
+    const string& name = obj_ptr->get_name();
+    obj_ptr->set_id(id);
+
+    m_names.push_back(name);
+    m_objs_by_id.push_back(obj_ptr);
+    m_agents_by_id.emplace_back();
+    m_structures_by_id.emplace_back();
+    m_ids_by_name[name] = id;
+    m_schedule_state_by_id.push_back(ASLEEP);
+    m_order_of_id.push_back(static_cast<int>(m_object_order.size()));
+
+    // Objects often arrive in name order, as when a world is restored
+    if (m_object_order.empty() || m_names[m_object_order.back()] < name) {
+        m_object_order.push_back(id);
+    }
+    else {
+        auto order_iter = lower_bound(m_object_order.begin(), m_object_order.end(), name,
+            [this](Object_id_t lhs, const string& rhs){ return m_names[lhs] < rhs; });
+        m_object_order.insert(order_iter, id);
+        m_is_order_stale = true;
+    }
+
+    // every new object is updated at least once
+    wake(id);
+}
+
+// drop the ids of removed objects from m_object_order
+void Model::compact_object_order() {
+    auto new_end = remove_if(m_object_order.begin(), m_object_order.end(),
+        [this](Object_id_t id){ return !m_objs_by_id[id]; });
+    m_object_order.erase(new_end, m_object_order.end());
+    renumber_object_order();
+}
+
+void Model::renumber_object_order() {
+    for (size_t i = 0; i < m_object_order.size(); ++i) {
+        m_order_of_id[m_object_order[i]] = static_cast<int>(i);
+    }
+    m_is_order_stale = false;
+}
+
+bool Model::is_structure_present(const string& name) const {
     // return false if structure with name not found, return true otherwise
-    return iter != m_structures.end();
+    return find_structure(name) != nullptr;
 }
 
 // add a new structure; assumes none with the same name
 void Model::add_structure(shared_ptr<Structure> new_structure_ptr) {
-    // Add Structure to Sim_objects container as a Sim_object*
-    m_sim_objs[new_structure_ptr->get_name()] = new_structure_ptr;
+    add_object(new_structure_ptr);
+    m_structures_by_id[new_structure_ptr->get_id()] = new_structure_ptr;
 
-    // Add Structure to Structures container as a shared_ptr<Structure>
-    m_structures[new_structure_ptr->get_name()] = new_structure_ptr;
+    mp_structure_grid->insert(new_structure_ptr, new_structure_ptr->get_location());
     new_structure_ptr->broadcast_current_state();
 }
 
-template <typename C>
-static typename C::mapped_type find_helper(C& container, const string& name) {
-    auto iter = container.find(name);
+// returns pointer to Structure with name if it exists, empty pointer otherwise
+shared_ptr<Structure> Model::find_structure(const string& name) const {
+    return find_helper(m_structures_by_id, find_id(name));
+}
 
-    // return empty pointer if Structure not found
-    if (iter == container.end()) {
-        return typename C::mapped_type();
-    }
+// returns pointer to the Structure nearest to location, ties are resolved
+// by name, returns empty pointer if there are no Structures
+shared_ptr<Structure> Model::find_nearest_structure(const Point& location) const {
+    PROFILE_COUNT(STRUCTURE_SEARCHES);
+    return mp_structure_grid->find_nearest(location,
+        [](const shared_ptr<Structure>&){ return true; });
+}
 
-    return iter->second;
+vector<shared_ptr<Structure>> Model::find_structures_in_radius(const Point& center,
+                                                               double radius) const
+{
+    PROFILE_COUNT(STRUCTURE_SEARCHES);
+    vector<shared_ptr<Structure>> result;
+    mp_structure_grid->query_radius(center, radius, result);
+    return result;
 }
 
-// returns pointer to Structure with name if it exists, empty pointer otherwise
-shared_ptr<Structure> Model::find_structure(const string& name) const {
-    return find_helper(m_structures, name);
+vector<shared_ptr<Structure>> Model::find_k_nearest_structures(const Point& center,
+                                                               int k) const
+{
+    PROFILE_COUNT(STRUCTURE_SEARCHES);
+    vector<shared_ptr<Structure>> result;
+    if (k > 0) {
+        mp_structure_grid->query_k_nearest(center, k,
+            [](const shared_ptr<Structure>&){ return true; }, result);
+    }
+    return result;
 }
 
 bool Model::is_agent_present(const string& name) const {
-    auto iter = m_agents.find(name);
-
     // return false if agent with name not found, return true otherwise
-    return iter != m_agents.end();
+    return find_agent(name) != nullptr;
 }
 
 // add a new agent; assumes none with the same name
 void Model::add_agent(shared_ptr<Agent> new_agent_ptr) {
-    // Add Agent to Sim_objects container as a shared_ptr<Sim_object>
-    m_sim_objs[new_agent_ptr->get_name()] = new_agent_ptr;
-    // Add Agent to Agents container as an shared_ptr<Agent>
-    m_agents[new_agent_ptr->get_name()] = new_agent_ptr;
+    add_object(new_agent_ptr);
+    m_agents_by_id[new_agent_ptr->get_id()] = new_agent_ptr;
 
+    mp_agent_grid->insert(new_agent_ptr, new_agent_ptr->get_location());
     new_agent_ptr->broadcast_current_state();
+    wake_watchers_near(new_agent_ptr.get());
 }
 
-// Remove Agent from Sim_objects container and Agents container
-// Agent should be present in both containers when remove_agent
-// is called
+// Remove Agent from all containers, Agent should be present when remove_agent
+// is called. Its id stays in the update order, skipped, until the next compaction
+// so that an update in progress is not disturbed.
 void Model::remove_agent(shared_ptr<Agent> agent_ptr) {
     assert(agent_ptr); // assert obj_ptr not nullptr
 
-    auto agent_iter = m_agents.find(agent_ptr->get_name());
-    assert(agent_iter != m_agents.end());
-    m_agents.erase(agent_iter);
+    // a deferred removal is counted when it is carried out
+    if (m_is_resolving_attacks) {
+        m_killed_agents.push_back(std::move(agent_ptr));
+        return;
+    }
+
+    PROFILE_COUNT(AGENT_DEATHS);
+
+    const Object_id_t id = agent_ptr->get_id();
+    assert(m_agents_by_id[id] == agent_ptr);
+    m_agents_by_id[id].reset();
 
-    auto obj_iter = m_sim_objs.find(agent_ptr->get_name());
-    assert(obj_iter != m_sim_objs.end());
-    m_sim_objs.erase(obj_iter);
+    m_removed_objs.push_back(std::move(m_objs_by_id[id]));
+    m_ids_by_name.erase(agent_ptr->get_name());
+
+    mp_agent_grid->remove(agent_ptr.get());
+    if (m_schedule_state_by_id[id] == WATCHING) {
+        mp_watcher_grid->remove(agent_ptr.get());
+    }
+    m_schedule_state_by_id[id] = ASLEEP;
 }
 
 // returns pointer to Agent with name if it exists, empty pointer otherwise
 shared_ptr<Agent> Model::find_agent(const std::string& name) const {
-    return find_helper(m_agents, name);
+    return find_helper(m_agents_by_id, find_id(name));
+}
+
+// returns pointer to the Agent nearest to location for which pred returns true,
+// ties are resolved by name, returns empty pointer if no such Agent found
+shared_ptr<Agent> Model::find_nearest_agent(const Point& location, Agent_pred_t pred) const {
+    PROFILE_COUNT(AGENT_SEARCHES);
+    return mp_agent_grid->find_nearest(location, pred);
 }
 
-static bool operator==(shared_ptr<Group> ptr, const string& name) {
-    return *ptr == name;
+vector<shared_ptr<Agent>> Model::find_agents_in_radius(const Point& center, double radius) const {
+    PROFILE_COUNT(AGENT_SEARCHES);
+    vector<shared_ptr<Agent>> result;
+    mp_agent_grid->query_radius(center, radius, result);
+    return result;
+}
+
+vector<shared_ptr<Agent>> Model::find_k_nearest_agents(const Point& center, int k) const {
+    PROFILE_COUNT(AGENT_SEARCHES);
+    vector<shared_ptr<Agent>> result;
+    if (k > 0) {
+        mp_agent_grid->query_k_nearest(center, k,
+            [](const shared_ptr<Agent>&){ return true; }, result);
+    }
+    return result;
+}
+
+// keep the spatial index current, Agents call this whenever their location changes
+// and whenever one does, watching Agents nearby may have a new hostile in range
+void Model::update_agent_location(const Agent* agent_ptr) {
+    if (mp_agent_grid->move(agent_ptr, agent_ptr->get_location())) {
+        ++m_relocation_count;
+    }
+
+    wake_watchers_near(agent_ptr);
 }
 
 // is there a group with this name?
 bool Model::is_group_present(const std::string& name) const {
-    auto iter = find(m_groups.begin(), m_groups.end(), name);
-
-    // if group is return true, return false otherwise
-    return iter != m_groups.end();
+    return m_groups_by_name.find(name) != m_groups_by_name.end();
 }
 
 // Add new group, assumes none with same name already exists
 void Model::add_group(std::shared_ptr<Group> group_ptr) {
-    m_groups.push_back(group_ptr);
+    auto iter = m_groups.insert(m_groups.end(), group_ptr);
+    m_groups_by_name.emplace(group_ptr->get_name(), iter);
 }
 
 // Remove a Group with matching name, throws and Error if no Group with
 // that name exists
 void Model::remove_group(const string& name) {
     // Try to locate the Group with name in container
-    auto iter = find(m_groups.begin(), m_groups.end(), name);
+    auto iter = m_groups_by_name.find(name);
 
     // If group not found throw and Error
-    if (iter == m_groups.end()) {
+    if (iter == m_groups_by_name.end()) {
         throw Error("Group not found!");
     }
 
-    // Group was found, remove it from the container
-    m_groups.erase(iter);
+    // Group was found, remove it from the containers
+    m_groups.erase(iter->second);
+    m_groups_by_name.erase(iter);
 }
 
 // returns pointer to Group with name if it exists, empty pointer otherwise
 shared_ptr<Group> Model::find_group(const std::string& name) const {
-    auto iter = find(m_groups.begin(), m_groups.end(), name);
+    auto iter = m_groups_by_name.find(name);
 
     // If group not found return empty pointer
-    if (iter == m_groups.end()) {
+    if (iter == m_groups_by_name.end()) {
         return shared_ptr<Group>();
     }
 
-    return *iter;
+    return *iter->second;
 }
 
 // tell all objects to describe themselves to the console
 void Model::describe() const {
-    for_each(m_sim_objs.begin(), m_sim_objs.end(),
-        [](const Sim_objs_t::value_type& p){ p.second->describe(); });
+    for (Object_id_t id : m_object_order) {
+        if (m_objs_by_id[id]) {
+            m_objs_by_id[id]->describe();
+        }
+    }
 
     for_each(m_groups.begin(), m_groups.end(),
         [](const shared_ptr<Group>& p){ p->describe(); });
 }
 
-// increment the time, and tell all objects to update themselves
+// Objects are saved in name order so that restoring them adds each one after
+// the last. The object table comes first, every object's state follows, so that
+// references to objects can be resolved when the state is read.
+void Model::save(const string& filename) const {
+    write_snapshot()->write_to_file(filename);
+}
+
+void Model::save(std::ostream& os) const {
+    write_snapshot()->write(os);
+}
+
+std::uint64_t Model::get_state_hash() const {
+    return write_snapshot()->hash();
+}
+
+// Returns a writer holding the whole world, ready to be written out
+std::unique_ptr<Snapshot_writer> Model::write_snapshot() const {
+    vector<int> index_of_id(m_names.size(), -1);
+    vector<const Sim_object*> objs;
+    objs.reserve(m_object_order.size());
+    for (Object_id_t id : m_object_order) {
+        if (m_objs_by_id[id]) {
+            index_of_id[id] = static_cast<int>(objs.size());
+            objs.push_back(m_objs_by_id[id].get());
+        }
+    }
+
+    std::unique_ptr<Snapshot_writer> writer_ptr(new Snapshot_writer(std::move(index_of_id)));
+    Snapshot_writer& writer = *writer_ptr;
+    writer.write_i32(m_time);
+
+    writer.write_i32(static_cast<int>(objs.size()));
+    for (const Sim_object* obj_ptr : objs) {
+        const Point location = obj_ptr->get_location();
+        writer.write_u8(m_agents_by_id[obj_ptr->get_id()] ? 1 : 0);
+        writer.write_type(obj_ptr->get_type_string());
+        writer.write_string(obj_ptr->get_name());
+        writer.write_double(location.x);
+        writer.write_double(location.y);
+    }
+
+    for (const Sim_object* obj_ptr : objs) {
+        obj_ptr->save_state(writer);
+    }
+
+    writer.write_i32(static_cast<int>(m_groups.size()));
+    for (const shared_ptr<Group>& group_ptr : m_groups) {
+        writer.write_string(group_ptr->get_name());
+        group_ptr->save_state(writer);
+    }
+
+    // Subgroups are written once every Group is known, by index in the list above
+    std::unordered_map<const Group*, int> index_of_group;
+    for (const shared_ptr<Group>& group_ptr : m_groups) {
+        index_of_group.emplace(group_ptr.get(), static_cast<int>(index_of_group.size()));
+    }
+    for (const shared_ptr<Group>& group_ptr : m_groups) {
+        group_ptr->save_subgroups(writer, index_of_group);
+    }
+
+    mp_logistics->save_state(writer);
+
+    return writer_ptr;
+}
+
+// read the object table written by save, creating each object
+static vector<shared_ptr<Sim_object>> read_snapshot_objects(Snapshot_reader& reader) {
+    const int num_objs = reader.read_count();
+    vector<shared_ptr<Sim_object>> objs;
+
+    for (int i = 0; i < num_objs; ++i) {
+        const int is_agent = reader.read_u8();
+        const string& type = reader.read_type();
+        const string name = reader.read_string();
+        const double x = reader.read_double();
+        const double y = reader.read_double();
+
+        // Names were saved in order, which also rules out duplicates
+        if (is_agent > 1 || (!objs.empty() && !(objs.back()->get_name() < name))) {
+            throw Error("Snapshot file is corrupt!");
+        }
+
+        if (is_agent) {
+            objs.push_back(create_agent(name, type, Point(x, y)));
+        }
+        else {
+            objs.push_back(create_structure(name, type, Point(x, y)));
+        }
+
+        // The id the object will be given when it is added to the emptied Model,
+        // Groups key their members by it
+        objs.back()->set_id(i);
+    }
+
+    return objs;
+}
+
+// The objects of the new world are only added once everything has been read
+void Model::restore(const string& filename) {
+    Snapshot_reader reader(filename);
+    restore(reader);
+}
+
+void Model::restore(vector<char> snapshot) {
+    Snapshot_reader reader(std::move(snapshot));
+    restore(reader);
+}
+
+void Model::restore(Snapshot_reader& reader) {
+    const int time = reader.read_i32();
+
+    reader.set_objects(read_snapshot_objects(reader));
+    const vector<shared_ptr<Sim_object>>& objs = reader.get_objects();
+    for (const shared_ptr<Sim_object>& obj_ptr : objs) {
+        obj_ptr->restore_state(reader);
+    }
+
+    // A failed read leaves the Groups and their members referring to each other
+    vector<shared_ptr<Group>> groups;
+    std::unique_ptr<Logistics> logistics_ptr(new Logistics());
+    try {
+        const int num_groups = reader.read_count();
+        std::unordered_set<string> group_names;
+        for (int i = 0; i < num_groups; ++i) {
+            const string name = reader.read_string();
+            auto obj_iter = lower_bound(objs.begin(), objs.end(), name,
+                [](const shared_ptr<Sim_object>& lhs, const string& rhs){ return lhs->get_name() < rhs; });
+            const bool is_object_name = obj_iter != objs.end() && (*obj_iter)->get_name() == name;
+            if (name.empty() || is_object_name || !group_names.insert(name).second) {
+                throw Error("Snapshot file is corrupt!");
+            }
+
+            groups.push_back(std::make_shared<Group>(name));
+            groups.back()->restore_state(reader);
+        }
+        for (const shared_ptr<Group>& group_ptr : groups) {
+            group_ptr->restore_subgroups(reader, groups);
+        }
+        logistics_ptr->restore_state(reader);
+        reader.expect_end();
+    }
+    catch (...) {
+        for_each(groups.begin(), groups.end(), [](shared_ptr<Group>& p){ p->disband(); });
+        throw;
+    }
+
+    clear_world();
+    m_time = time;
+
+    m_names.reserve(objs.size());
+    m_objs_by_id.reserve(objs.size());
+    m_agents_by_id.reserve(objs.size());
+    m_structures_by_id.reserve(objs.size());
+    m_object_order.reserve(objs.size());
+    m_ids_by_name.reserve(objs.size());
+    for (const shared_ptr<Sim_object>& obj_ptr : objs) {
+        shared_ptr<Agent> agent_ptr = std::dynamic_pointer_cast<Agent>(obj_ptr);
+        if (agent_ptr) {
+            add_agent(agent_ptr);
+        }
+        else {
+            add_structure(std::static_pointer_cast<Structure>(obj_ptr));
+        }
+    }
+
+    for (const shared_ptr<Group>& group_ptr : groups) {
+        add_group(group_ptr);
+    }
+
+    // Peasants waiting in a queue sleep until Logistics wakes them, rather than
+    // being updated once like every other new object
+    mp_logistics.swap(logistics_ptr);
+    auto put_to_sleep = [this](Object_id_t id){
+        if (!mp_logistics->is_queued(id)) {
+            return false;
+        }
+        m_schedule_state_by_id[id] = ASLEEP;
+        return true;
+    };
+    m_woken_ids.erase(remove_if(m_woken_ids.begin(), m_woken_ids.end(), put_to_sleep), m_woken_ids.end());
+}
+
+// discard every object and Group, forget every interned name and clear the Views
+void Model::clear_world() {
+    // Groups and their members refer to each other
+    for_each(m_groups.begin(), m_groups.end(), [](shared_ptr<Group>& p){ p->disband(); });
+    m_groups.clear();
+    m_groups_by_name.clear();
+
+    // Buffered changes are about objects that no longer exist
+    for (const View_change& change : m_view_changes) {
+        m_view_change_index_of_id[change.id] = -1;
+    }
+    m_view_changes.clear();
+    m_tick_fields.clear();
+    m_tick_change_indexes.clear();
+    for_each(m_views.begin(), m_views.end(), [](shared_ptr<View>& v){ v->clear(); });
+
+    mp_agent_grid->clear();
+    mp_structure_grid->clear();
+    m_object_order.clear();
+    m_ids_by_name.clear();
+    m_removed_objs.clear();
+    m_agents_by_id.clear();
+    m_structures_by_id.clear();
+    m_objs_by_id.clear();
+    m_names.clear();
+
+    m_schedule_state_by_id.clear();
+    m_order_of_id.clear();
+    m_is_order_stale = false;
+    m_kept_ids.clear();
+    m_woken_ids.clear();
+    mp_watcher_grid->clear();
+    m_max_watch_range = 0.0;
+    mp_logistics->clear();
+}
+
+int Model::get_num_threads() const {
+    return mp_worker_pool ? mp_worker_pool->get_num_threads() : 1;
+}
+
+// select how update() advances the simulation
+void Model::set_tick_mode(Tick_mode mode, int num_threads) {
+    assert(num_threads >= 1);
+
+    // Only a PARALLEL tick needs threads, keep the pool if it is already the right size.
+    // The pool is made first so the mode is left alone if it cannot be.
+    if (mode != Tick_mode::PARALLEL) {
+        mp_worker_pool.reset();
+    }
+    else if (!mp_worker_pool || mp_worker_pool->get_num_threads() != num_threads) {
+        mp_worker_pool.reset(new Worker_pool(num_threads));
+    }
+
+    m_tick_mode = mode;
+    mp_movement_system->set_batched(mode != Tick_mode::SEQUENTIAL);
+}
+
+// increment the time, and tell all objects that have work to do to update
+// themselves, in name order
 void Model::update() {
     m_time++;
+    PROFILE_BEGIN_TICK(m_time);
 
-    for_each(m_sim_objs.begin(), m_sim_objs.end(),
-        [](Sim_objs_t::value_type& p){ p.second->update(); });
+    // From here on objects woken before their turn are updated in this update
+    const vector<Object_id_t> scheduled_ids = take_schedule();
+    m_update_position = -1;
+    m_is_updating = true;
+
+    switch (m_tick_mode) {
+    case Tick_mode::SEQUENTIAL:
+        break;
+    case Tick_mode::BATCHED:
+        batched_movement_phase();
+        break;
+    case Tick_mode::PARALLEL:
+        parallel_movement_phase();
+        parallel_plan_phase(scheduled_ids);
+        break;
+    default:
+        throw Error("Unrecognized tick mode in Model::update");
+    }
+
+    // The scheduled objects are merged with those woken during the update, objects
+    // removed during the update are skipped if their turn has not come yet
+    {
+        PROFILE_PHASE(UPDATE);
+        auto later = [this](Object_id_t lhs, Object_id_t rhs){ return m_order_of_id[lhs] > m_order_of_id[rhs]; };
+        size_t next = 0;
+        while (next < scheduled_ids.size() || !m_late_ids.empty()) {
+            Object_id_t id;
+            if (m_late_ids.empty() ||
+                (next < scheduled_ids.size() && later(m_late_ids.front(), scheduled_ids[next])))
+            {
+                id = scheduled_ids[next++];
+            }
+            else {
+                std::pop_heap(m_late_ids.begin(), m_late_ids.end(), later);
+                id = m_late_ids.back();
+                m_late_ids.pop_back();
+            }
+
+            Sim_object* obj_ptr = m_objs_by_id[id].get();
+            if (obj_ptr) {
+                m_update_position = m_order_of_id[id];
+                m_schedule_state_by_id[id] = ASLEEP;
+                if (m_agents_by_id[id]) {
+                    ++m_agent_update_count;
+                }
+                {
+                    PROFILE_UPDATE(obj_ptr->get_type_string());
+                    obj_ptr->update();
+                }
+                reschedule(id);
+            }
+        }
+    }
+    m_is_updating = false;
+
+    if (!m_attacks.empty()) {
+        PROFILE_PHASE(COMBAT);
+        resolve_attacks();
+    }
+
+    if (!m_removed_objs.empty()) {
+        PROFILE_PHASE(CLEANUP);
+        compact_object_order();
+        m_removed_objs.clear();
+    }
+
+    flush_tick_view_changes();
+    // what was said during the tick goes out in one go
+    Event_log::get_instance()->flush();
+    PROFILE_END_TICK();
+}
+
+void Model::wake(Object_id_t id) {
+    if (id < 0 || id >= static_cast<Object_id_t>(m_objs_by_id.size()) || !m_objs_by_id[id] ||
+        m_schedule_state_by_id[id] == SCHEDULED)
+    {
+        return;
+    }
+
+    if (m_schedule_state_by_id[id] == WATCHING) {
+        mp_watcher_grid->remove(m_agents_by_id[id].get());
+    }
+    m_schedule_state_by_id[id] = SCHEDULED;
+
+    if (m_is_updating && m_order_of_id[id] > m_update_position) {
+        m_late_ids.push_back(id);
+        std::push_heap(m_late_ids.begin(), m_late_ids.end(),
+            [this](Object_id_t lhs, Object_id_t rhs){ return m_order_of_id[lhs] > m_order_of_id[rhs]; });
+    }
+    else {
+        m_woken_ids.push_back(id);
+    }
+}
+
+void Model::queue_attack(Object_id_t attacker_id, Object_id_t target_id, int strength) {
+    assert(m_agents_by_id[attacker_id] && m_agents_by_id[target_id]);
+    m_attacks.push_back(Attack{attacker_id, target_id, strength});
+}
+
+// Agents killed stay in every container until the end, so ids stay valid throughout.
+// A hit on an Agent killed earlier in the pass is lost, one made by an Agent killed
+// earlier still lands, it was made while the attacker was alive. Woken Agents,
+// such as Soldiers striking back, act on the next update.
+void Model::resolve_attacks() {
+    m_is_resolving_attacks = true;
+    for (const Attack& attack : m_attacks) {
+        Agent* target_ptr = m_agents_by_id[attack.target_id].get();
+        if (!target_ptr->is_alive()) {
+            continue;
+        }
+
+        const shared_ptr<Agent>& attacker_ptr = m_agents_by_id[attack.attacker_id];
+        target_ptr->take_hit(attack.strength, attacker_ptr);
+        if (attacker_ptr->is_alive()) {
+            static_cast<Infantry*>(attacker_ptr.get())->hit_landed();
+        }
+    }
+    m_attacks.clear();
+    m_is_resolving_attacks = false;
+
+    for (shared_ptr<Agent>& agent_ptr : m_killed_agents) {
+        remove_agent(std::move(agent_ptr));
+    }
+    m_killed_agents.clear();
+}
+
+// Every scheduled object is fast forwarded, those no longer active afterwards, such
+// as a Mage done recharging, go to sleep or watch as they would after update()
+int Model::fast_forward(int max_ticks) {
+    const int ticks = count_quiet_ticks(max_ticks);
+    if (ticks == 0) {
+        return 0;
+    }
+
+    m_time += ticks;
+
+    for (Object_id_t id : take_schedule()) {
+        if (m_agents_by_id[id]) {
+            m_agent_update_count += ticks;
+        }
+        m_schedule_state_by_id[id] = ASLEEP;
+        m_objs_by_id[id]->fast_forward(ticks);
+        reschedule(id);
+    }
+    flush_tick_view_changes();
+
+    return ticks;
+}
+
+// Returns how many steps of speed are certainly short of covering gap, keeping one
+// step back for rounding
+static int ticks_to_cover(double gap, double speed) {
+    if (speed <= 0.0) {
+        return std::numeric_limits<int>::max();
+    }
+
+    const double ticks = gap / speed - 1.0;
+    if (ticks <= 0.0) {
+        return 0;
+    }
+    return ticks >= std::numeric_limits<int>::max() ? std::numeric_limits<int>::max()
+                                                    : static_cast<int>(ticks);
+}
+
+// Each scheduled object limits the jump to its own quiet updates. Then no moving
+// Agent may get near enough to a watcher to wake it, watchers stand still, and no
+// moving Agent that looks for hostiles may get within its range of one, both of
+// them possibly moving at the top speed of any mover.
+int Model::count_quiet_ticks(int max_ticks) const {
+    int ticks = std::max(max_ticks, 0);
+    double max_speed = 0.0;
+    vector<const Agent*> movers;
+
+    for (const vector<Object_id_t>* ids_ptr : {&m_kept_ids, &m_woken_ids}) {
+        for (Object_id_t id : *ids_ptr) {
+            const Sim_object* obj_ptr = m_objs_by_id[id].get();
+            if (!obj_ptr || ticks == 0) {
+                continue;
+            }
+
+            ticks = std::min(ticks, obj_ptr->get_quiet_updates());
+            const Agent* agent_ptr = m_agents_by_id[id].get();
+            if (agent_ptr && agent_ptr->is_moving()) {
+                movers.push_back(agent_ptr);
+                max_speed = std::max(max_speed, agent_ptr->get_speed());
+            }
+        }
+    }
+
+    const double watch_radius = m_max_watch_range * (1.0 + kWATCH_RANGE_MARGIN) + kWATCH_RANGE_MARGIN;
+    for (auto it = movers.begin(); it != movers.end() && ticks > 0; ++it) {
+        const Agent* agent_ptr = *it;
+        const Point location = agent_ptr->get_location();
+
+        if (mp_watcher_grid->size() > 0) {
+            shared_ptr<Agent> watcher_ptr = mp_watcher_grid->find_nearest(location,
+                [](const shared_ptr<Agent>&){ return true; });
+            const double gap = cartesian_distance(location, watcher_ptr->get_location()) - watch_radius;
+            ticks = std::min(ticks, ticks_to_cover(gap, agent_ptr->get_speed()));
+        }
+
+        const double watch_range = agent_ptr->get_watch_range();
+        if (watch_range > 0.0) {
+            shared_ptr<Agent> hostile_ptr = find_nearest_agent(location,
+                [agent_ptr](const shared_ptr<Agent>& other_ptr) {
+                    return other_ptr.get() != agent_ptr && !agent_ptr->agents_share_group(other_ptr);
+                });
+            if (hostile_ptr) {
+                const double gap = cartesian_distance(location, hostile_ptr->get_location()) - watch_range;
+                ticks = std::min(ticks, ticks_to_cover(gap, agent_ptr->get_speed() + max_speed));
+            }
+        }
+    }
+
+    return ticks;
+}
+
+// Rare enough that a scan of every object is cheaper than keeping a list
+void Model::wake_watchers() {
+    for (Object_id_t id = 0; id < static_cast<Object_id_t>(m_schedule_state_by_id.size()); ++id) {
+        if (m_schedule_state_by_id[id] == WATCHING) {
+            wake(id);
+        }
+    }
+}
+
+// The kept ids are already in order, so only those woken need sorting. Ids of
+// objects removed since they were scheduled are dropped, their positions are stale.
+vector<Object_id_t> Model::take_schedule() {
+    if (m_is_order_stale) {
+        renumber_object_order();
+    }
+
+    auto is_removed = [this](Object_id_t id){ return !m_objs_by_id[id]; };
+    auto earlier = [this](Object_id_t lhs, Object_id_t rhs){ return m_order_of_id[lhs] < m_order_of_id[rhs]; };
+
+    m_kept_ids.erase(remove_if(m_kept_ids.begin(), m_kept_ids.end(), is_removed), m_kept_ids.end());
+    m_woken_ids.erase(remove_if(m_woken_ids.begin(), m_woken_ids.end(), is_removed), m_woken_ids.end());
+    sort(m_woken_ids.begin(), m_woken_ids.end(), earlier);
+
+    vector<Object_id_t> ids;
+    ids.reserve(m_kept_ids.size() + m_woken_ids.size());
+    std::merge(m_kept_ids.begin(), m_kept_ids.end(), m_woken_ids.begin(), m_woken_ids.end(),
+        std::back_inserter(ids), earlier);
+    m_kept_ids.clear();
+    m_woken_ids.clear();
+
+    return ids;
+}
+
+// Called right after the object's update, which is in update order, so m_kept_ids
+// stays in order
+void Model::reschedule(Object_id_t id) {
+    const Sim_object* obj_ptr = m_objs_by_id[id].get();
+
+    // Nothing to do if the object was removed or woken again during its update
+    if (!obj_ptr || m_schedule_state_by_id[id] != ASLEEP) {
+        return;
+    }
+
+    if (obj_ptr->is_active()) {
+        m_schedule_state_by_id[id] = SCHEDULED;
+        m_kept_ids.push_back(id);
+        return;
+    }
+
+    const shared_ptr<Agent>& agent_ptr = m_agents_by_id[id];
+    const double watch_range = agent_ptr ? agent_ptr->get_watch_range() : 0.0;
+    if (watch_range > 0.0) {
+        m_schedule_state_by_id[id] = WATCHING;
+        mp_watcher_grid->insert(agent_ptr, agent_ptr->get_location());
+        m_max_watch_range = std::max(m_max_watch_range, watch_range);
+    }
+}
+
+// Watchers are found a little beyond the longest watch range so that rounding can
+// never leave one asleep, waking one too many only costs it an update
+void Model::wake_watchers_near(const Agent* agent_ptr) {
+    if (mp_watcher_grid->size() == 0) {
+        return;
+    }
+
+    mp_watcher_grid->query_radius(agent_ptr->get_location(),
+        m_max_watch_range * (1.0 + kWATCH_RANGE_MARGIN) + kWATCH_RANGE_MARGIN, m_nearby_watchers);
+    for (const shared_ptr<Agent>& watcher_ptr : m_nearby_watchers) {
+        if (watcher_ptr.get() != agent_ptr) {
+            wake(watcher_ptr->get_id());
+        }
+    }
+    m_nearby_watchers.clear();
+}
+
+// All movers step at once, then the spatial index catches up before anyone acts
+void Model::batched_movement_phase() {
+    PROFILE_PHASE(MOVEMENT);
+    mp_movement_system->advance_all();
+    for (const Agent* agent_ptr : mp_movement_system->get_moved_owners()) {
+        update_agent_location(agent_ptr);
+    }
+}
+
+// Same as batched_movement_phase with the movement storage split between threads
+void Model::parallel_movement_phase() {
+    PROFILE_PHASE(MOVEMENT);
+    Movement_system& movement_system = *mp_movement_system;
+    mp_worker_pool->parallel_for(static_cast<size_t>(movement_system.size()),
+        [&movement_system](size_t begin, size_t end) {
+            movement_system.advance_range(static_cast<int>(begin), static_cast<int>(end));
+        });
+
+    movement_system.collect_moved_owners();
+    for (const Agent* agent_ptr : movement_system.get_moved_owners()) {
+        update_agent_location(agent_ptr);
+    }
+}
+
+// Every scheduled object plans its update concurrently against the state left by
+// movement, objects woken later in the update do without a plan
+void Model::parallel_plan_phase(const vector<Object_id_t>& ids) {
+    PROFILE_PHASE(PLAN);
+    vector<Sim_object*> objs;
+    objs.reserve(ids.size());
+    for (Object_id_t id : ids) {
+        if (m_objs_by_id[id]) {
+            objs.push_back(m_objs_by_id[id].get());
+        }
+    }
+
+    mp_worker_pool->parallel_for(objs.size(), [&objs](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            objs[i]->plan_update();
+        }
+    });
 }
 
 /* View services */
@@ -219,9 +935,15 @@ void Model::update() {
 // with all current objects'location (or other state information.
 void Model::attach(shared_ptr<View> view_ptr) {
     m_views.push_back(view_ptr);
+    if (view_ptr->wants_every_tick()) {
+        ++m_num_every_tick_views;
+    }
 
-    for_each(m_sim_objs.begin(), m_sim_objs.end(),
-        [](Sim_objs_t::value_type& p){ p.second->broadcast_current_state(); });
+    for (Object_id_t id : m_object_order) {
+        if (m_objs_by_id[id]) {
+            m_objs_by_id[id]->broadcast_current_state();
+        }
+    }
 }
 
 // Detach the View by discarding the supplied pointer from the container of Views
@@ -230,28 +952,129 @@ void Model::detach(shared_ptr<View> view_ptr) {
     auto iter = find(m_views.begin(), m_views.end(), view_ptr);
     assert(iter != m_views.end());
     m_views.erase(iter);
+
+    // Nobody is left to send the changes of each tick to
+    if (view_ptr->wants_every_tick() && --m_num_every_tick_views == 0) {
+        for (int index : m_tick_change_indexes) {
+            m_tick_fields[index] = 0u;
+        }
+        m_tick_change_indexes.clear();
+    }
+
+    // Nobody is left to deliver buffered changes to
+    if (m_views.empty()) {
+        flush_view_changes();
+    }
 }
 
-// notify the views about an object's location
-void Model::notify_location(const string& name, const Point& location) {
-    for_each(m_views.begin(), m_views.end(),
-        [&name, &location](shared_ptr<View>& v){ v->update_location(name, location); });
+// returns the buffered change for id with field marked as changed, adding an empty
+// one if there is none
+View_change& Model::get_view_change(Object_id_t id, unsigned field) {
+    if (id >= static_cast<Object_id_t>(m_view_change_index_of_id.size())) {
+        m_view_change_index_of_id.resize(id + 1, -1);
+    }
+
+    int& index = m_view_change_index_of_id[id];
+    if (index < 0) {
+        index = static_cast<int>(m_view_changes.size());
+        m_view_changes.push_back(View_change{ id, 0u, 0.0, 0.0, 0.0, 0.0 });
+        m_tick_fields.push_back(0u);
+    }
+
+    if (m_num_every_tick_views > 0) {
+        if (m_tick_fields[index] == 0u) {
+            m_tick_change_indexes.push_back(index);
+        }
+        m_tick_fields[index] |= field;
+    }
+
+    View_change& change = m_view_changes[index];
+    change.fields |= field;
+    return change;
+}
+
+// notify the views about an object's location, only buffered while there are views
+void Model::notify_location(Object_id_t id, const Point& location) {
+    if (m_views.empty()) {
+        return;
+    }
+
+    PROFILE_COUNT(VIEW_NOTIFICATIONS);
+
+    View_change& change = get_view_change(id, View_change::LOCATION);
+    change.x = location.x;
+    change.y = location.y;
 }
 
 // notify the views that an object is now gone
-void Model::notify_gone(const string& name) {
-    for_each(m_views.begin(), m_views.end(),
-        [&name](shared_ptr<View>& v){ v->update_remove(name); });
+void Model::notify_gone(Object_id_t id) {
+    if (m_views.empty()) {
+        return;
+    }
+
+    PROFILE_COUNT(VIEW_NOTIFICATIONS);
+
+    get_view_change(id, View_change::GONE);
 }
 
 // notify the views of an objects's health
-void Model::notify_health(const string& name, double health) {
-    for_each(m_views.begin(), m_views.end(),
-        [&name, health](shared_ptr<View>& v){ v->update_health(name, health); });
+void Model::notify_health(Object_id_t id, double health) {
+    if (m_views.empty()) {
+        return;
+    }
+
+    PROFILE_COUNT(VIEW_NOTIFICATIONS);
+
+    View_change& change = get_view_change(id, View_change::HEALTH);
+    change.health = health;
 }
 
 // notify the views of an object's food amount
-void Model::notify_amount(const string& name, double amount) {
-    for_each(m_views.begin(), m_views.end(),
-        [&name, amount](shared_ptr<View>& v){ v->update_amount(name, amount); });
+void Model::notify_amount(Object_id_t id, double amount) {
+    if (m_views.empty()) {
+        return;
+    }
+
+    PROFILE_COUNT(VIEW_NOTIFICATIONS);
+
+    View_change& change = get_view_change(id, View_change::AMOUNT);
+    change.amount = amount;
+}
+
+// The other Views are sent the changes coalesced since they were last drawn, so
+// what they show is the same whether or not a View wants the changes every tick
+void Model::flush_tick_view_changes() {
+    if (m_tick_change_indexes.empty()) {
+        return;
+    }
+
+    m_tick_changes.clear();
+    for (int index : m_tick_change_indexes) {
+        m_tick_changes.push_back(m_view_changes[index]);
+        m_tick_changes.back().fields = m_tick_fields[index];
+        m_tick_fields[index] = 0u;
+    }
+    m_tick_change_indexes.clear();
+
+    for (shared_ptr<View>& view_ptr : m_views) {
+        if (view_ptr->wants_every_tick()) {
+            view_ptr->apply_changes(m_tick_changes);
+        }
+    }
+}
+
+// deliver the changes buffered since the last flush to every View
+void Model::flush_view_changes() {
+    flush_tick_view_changes();
+    for (shared_ptr<View>& view_ptr : m_views) {
+        if (!view_ptr->wants_every_tick()) {
+            view_ptr->apply_changes(m_view_changes);
+        }
+    }
+
+    for (const View_change& change : m_view_changes) {
+        m_view_change_index_of_id[change.id] = -1;
+    }
+    m_view_changes.clear();
+    m_tick_fields.clear();
 }
@@ -2,10 +2,13 @@
 #define MODEL_H
 
 #include <string>
-#include <map>
+#include <unordered_map>
 #include <vector>
+#include <list>
 #include <memory>
-#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <iosfwd>
 
 // Forward declarations
 class Model;
@@ -14,7 +17,29 @@ class Sim_object;
 class Structure;
 class Agent;
 class Group;
+class Movement_system;
+class Worker_pool;
+class Logistics;
+class Snapshot_writer;
+class Snapshot_reader;
 struct Point;
+template <typename T> class Spatial_grid;
+
+// handle of an interned object name, declared with kNO_OBJECT_ID in Utility.h
+using Object_id_t = int;
+
+// The changes to one object's state that the Views have not been told about yet.
+// fields holds the Field bits of the values that changed, each holding the last
+// value reported. Once GONE is set the other values no longer matter.
+struct View_change {
+    enum Field : unsigned { LOCATION = 1u, HEALTH = 2u, AMOUNT = 4u, GONE = 8u };
+
+    Object_id_t id;
+    unsigned    fields;
+    double      x, y;   // location
+    double      health;
+    double      amount;
+};
 
 /*
 Model is part of a simplified Model-View-Controller pattern.
@@ -28,7 +53,15 @@ Finally, it keeps the system's time.
 
 Controller tells Model what to do; Model in turn tells the objects what do, and
 when asked to do so by an object, tells all the Views whenever anything changes that might be relevant.
-Model also provides facilities for looking up objects given their name.
+Changes are buffered, keeping only the last value of each object's state, and
+delivered to the Views in one batch when they are about to be drawn.
+Model also provides facilities for looking up objects given their name, and
+for finding the objects nearest to a location through spatial indexes that Agents
+keep up to date as they move.
+
+Each object's name is interned once, when the object is added, into a dense
+integer id (see Sim_object::get_id). Model stores objects by id and Views are
+notified by id, names are only looked up for the Controller and for output.
 
 Notice how only the Standard Library headers need to be included - reduced coupling!
 
@@ -39,7 +72,26 @@ Implemented as a Singleton
 class Model {
 
 public:
-    using Agents_t = std::map<const std::string, std::shared_ptr<Agent>>;
+    using Agent_pred_t = std::function<bool(const std::shared_ptr<Agent>&)>;
+
+    // How update() advances the simulation by one tick.
+    // SEQUENTIAL: each object in name order moves then acts before the next one does.
+    // BATCHED: every moving Agent is stepped in a single pass over the movement
+    //   storage first, then each object acts in name order.
+    // PARALLEL: a BATCHED tick split into phases. Movement and each object's
+    //   read-only plan_update() run across all worker threads against the state
+    //   left by movement, then the objects act serially in name order, applying
+    //   damage, food transfers and moves. Plans are only used while they still hold,
+    //   so the result is identical to BATCHED for any number of threads.
+    enum class Tick_mode { SEQUENTIAL, BATCHED, PARALLEL };
+
+    // When the hits Infantry make take effect.
+    // IMMEDIATE: each hit lands as it is made, the target may react or die before
+    //   the next object updates.
+    // DEFERRED: hits are queued during the update and land in one pass at the end
+    //   of it, in the order they were made, so every attacker acts on the state at
+    //   the start of the tick. Agents killed in that pass are removed together after it.
+    enum class Combat_mode { IMMEDIATE, DEFERRED };
 
     // disallow copy/move construction or assignment
     Model(const Model&) = delete;
@@ -53,11 +105,42 @@ public:
     // return the current time
     int get_time() {return m_time;}
 
+    // select how update() advances the simulation, SEQUENTIAL by default,
+    // num_threads is the number of threads a PARALLEL tick is spread over,
+    // throws Error if that is more than Worker_pool::get_max_threads()
+    void set_tick_mode(Tick_mode mode, int num_threads = 1);
+    Tick_mode get_tick_mode() const {return m_tick_mode;}
+    // the number of threads a PARALLEL tick is spread over
+    int get_num_threads() const;
+
+    // select when hits take effect, IMMEDIATE by default
+    void set_combat_mode(Combat_mode mode) {m_combat_mode = mode;}
+    Combat_mode get_combat_mode() const {return m_combat_mode;}
+    // queue a hit of strength by the Infantry attacker_id on target_id, for
+    // DEFERRED combat, both must be live Agents
+    void queue_attack(Object_id_t attacker_id, Object_id_t target_id, int strength);
+
+    // number of times an Agent has been found at a new location by
+    // update_agent_location, used to tell whether location based plans still hold
+    int get_relocation_count() const {return m_relocation_count;}
+
+    // total number of Agent updates made by update() and fast_forward() so far,
+    // sleeping Agents are skipped and not counted
+    long long get_agent_update_count() const {return m_agent_update_count;}
+
+    // storage for the movement state of all Agents
+    Movement_system& get_movement_system() {return *mp_movement_system;}
+
+    // coordination of Peasants collecting food
+    Logistics& get_logistics() {return *mp_logistics;}
+
     // is name already in use for either agent or structure?
     // return true if the name matches the name of an existing agent or structure
     bool is_name_in_use(const std::string& name) const;
 
     std::shared_ptr<Sim_object> get_obj_ptr(const std::string& name) const;
+    // returns the name interned as id, names of removed objects are kept
+    const std::string& get_name_of(Object_id_t id) const {return m_names[id];}
 
     // is there a structure with this name?
     bool is_structure_present(const std::string& name) const;
@@ -65,22 +148,35 @@ public:
     void add_structure(std::shared_ptr<Structure>);
     // returns pointer to Structure with name if it exists, empty pointer otherwise
     std::shared_ptr<Structure> find_structure(const std::string& name) const;
-    // returns pointer to Structure that evaluates least using passed in comparator
-    // returns empty pointer if no such Structure found
-    template <typename C>
-    std::shared_ptr<Structure> find_min_structure(C comp);
+    // returns pointer to the Structure nearest to location, ties are resolved
+    // by name, returns empty pointer if there are no Structures
+    std::shared_ptr<Structure> find_nearest_structure(const Point& location) const;
+    // returns the Structures within radius of center, nearest first
+    std::vector<std::shared_ptr<Structure>> find_structures_in_radius(const Point& center,
+                                                                      double radius) const;
+    // returns the k Structures nearest to center (fewer if there are not k), nearest first
+    std::vector<std::shared_ptr<Structure>> find_k_nearest_structures(const Point& center,
+                                                                      int k) const;
 
     // is there an agent with this name?
     bool is_agent_present(const std::string& name) const;
     // add a new agent; assumes none with the same name
     void add_agent(std::shared_ptr<Agent> agent_ptr);
-    // remove Agent from all containers, agent_ptr must not be nullptr
+    // remove Agent from all containers, agent_ptr must not be nullptr. While
+    // queued hits land the removal waits until they all have.
     void remove_agent(std::shared_ptr<Agent> agent_ptr);
     // returns pointer to Agent with name if it exists, empty pointer otherwise
     std::shared_ptr<Agent> find_agent(const std::string& name) const;
-    // returns pointer to Agent that evaluates least using passed in comparator
-    template <typename C>
-    std::shared_ptr<Agent> find_min_agent(C comp);
+    // returns pointer to the Agent nearest to location for which pred returns true,
+    // ties are resolved by name, returns empty pointer if no such Agent found
+    std::shared_ptr<Agent> find_nearest_agent(const Point& location, Agent_pred_t pred) const;
+    // returns the Agents within radius of center, nearest first
+    std::vector<std::shared_ptr<Agent>> find_agents_in_radius(const Point& center,
+                                                              double radius) const;
+    // returns the k Agents nearest to center (fewer if there are not k), nearest first
+    std::vector<std::shared_ptr<Agent>> find_k_nearest_agents(const Point& center, int k) const;
+    // keep the spatial index current, Agents call this whenever their location changes
+    void update_agent_location(const Agent* agent_ptr);
 
     // is there a group with this name?
     bool is_group_present(const std::string& name) const;
@@ -89,10 +185,42 @@ public:
     // returns pointer to Group with name if it exists, empty pointer otherwise
     std::shared_ptr<Group> find_group(const std::string& name) const;
 
+    // Write every object, every Group and the time to a snapshot file, see Snapshot.h
+    void save(const std::string& filename) const;
+    // write the same snapshot to os
+    void save(std::ostream& os) const;
+    // Returns a hash of the snapshot save would write, equal for equal worlds.
+    // The whole snapshot is built to hash it, which takes time in proportion to
+    // the size of the world.
+    std::uint64_t get_state_hash() const;
+    // Replace the whole world with the one saved in filename. The new world is built
+    // completely before the current one is discarded, so if reading fails with an
+    // Error nothing has changed. Views stay open and are sent the new world.
+    void restore(const std::string& filename);
+    // restore the world from a snapshot already read into memory
+    void restore(std::vector<char> snapshot);
+
     // tell all objects to describe themselves to the console
     void describe() const;
-    // increment the time, and tell all objects to update themselves
+    // increment the time, and tell all objects that have work to do to update
+    // themselves, in name order
     void update();
+    // Do as many of the next max_ticks updates as possible in a single jump and
+    // return how many, 0 if the next one has to be done by update(). Only updates
+    // that are quiet for every scheduled object (see Sim_object::get_quiet_updates)
+    // and in which no Agent can come within range of one looking for hostiles are
+    // jumped over. Objects end up exactly as after that many update() calls, but
+    // nothing is printed and Views are only told of the final state.
+    int fast_forward(int max_ticks);
+
+    // Schedule the object with id to be updated from now on, ids of objects that
+    // are not in the Model are ignored. Every object is updated until it is no
+    // longer active (see Sim_object::is_active), then only once it is woken again,
+    // so objects must be woken whenever they are given work. An object woken during
+    // an update whose turn in it has not come yet is updated in that update.
+    void wake(Object_id_t id);
+    // wake every Agent watching for hostiles, for when Agents stop sharing a Group
+    void wake_watchers();
 
     /* View services */
     // Attaching a View adds it to the container and causes it to be updated
@@ -102,20 +230,22 @@ public:
     // - no updates sent to it thereafter.
     void detach(std::shared_ptr<View>);
     // notify the views about an object's location
-    void notify_location(const std::string& name, const Point& location);
+    void notify_location(Object_id_t id, const Point& location);
     // notify the views that an object is now gone
-    void notify_gone(const std::string& name);
+    void notify_gone(Object_id_t id);
     // notify the views of an Agent's health
-    void notify_health(const std::string& name, double health);
+    void notify_health(Object_id_t id, double health);
     // notify the views of a Structure's food amount
-    void notify_amount(const std::string& name, double amount);
+    void notify_amount(Object_id_t id, double amount);
+    // deliver the changes buffered since the last flush to every View,
+    // must be called before Views are drawn. Views that want the changes every
+    // tick are also sent those of each tick and jump when it is done.
+    void flush_view_changes();
 
     // class used to deallocate Model
     friend class Model_destroyer;
 
 private:
-    using Sim_objs_t = std::map<const std::string, std::shared_ptr<Sim_object>>;
-
     // create the initial objects
     Model();
     // destroy all objects
@@ -123,45 +253,120 @@ private:
     // Initialize the Model, not called in ctor to prevent recursive initialization
     void init();
 
-    template <typename C, typename Comp>
-    typename C::mapped_type find_min_helper(C& container, Comp comp);
+    // intern obj_ptr's name as a new id and store it under that id
+    void add_object(const std::shared_ptr<Sim_object>& obj_ptr);
+    // returns the id of the live object named name, kNO_OBJECT_ID if there is none
+    Object_id_t find_id(const std::string& name) const;
+    // drop the ids of removed objects from m_object_order
+    void compact_object_order();
+    // Returns a snapshot writer holding the whole world
+    std::unique_ptr<Snapshot_writer> write_snapshot() const;
+    // replace the whole world with the one reader holds
+    void restore(Snapshot_reader& reader);
+    // record the position in m_object_order of every id
+    void renumber_object_order();
+    // take the ids scheduled for the next update, in update order
+    std::vector<Object_id_t> take_schedule();
+    // after an object's update keep it scheduled if it is still active,
+    // otherwise let it sleep, or watch if it is an Agent that watches
+    void reschedule(Object_id_t id);
+    // wake the watching Agents within their watch range of agent_ptr
+    void wake_watchers_near(const Agent* agent_ptr);
+    // returns how many of the next max_ticks updates fast_forward can jump over
+    int count_quiet_ticks(int max_ticks) const;
+    // discard every object and Group, forget every interned name and clear the
+    // Views, the next object added gets id 0
+    void clear_world();
+    // deliver the changes since they were last delivered to the Views that want
+    // them every tick
+    void flush_tick_view_changes();
+    // returns the buffered change for id with field marked as changed, adding an
+    // empty one if there is none
+    View_change& get_view_change(Object_id_t id, unsigned field);
+
+    // steps of an update() in the BATCHED and PARALLEL tick modes
+    void batched_movement_phase();
+    void parallel_movement_phase();
+    void parallel_plan_phase(const std::vector<Object_id_t>& ids);
+    // land the queued hits, then remove the Agents they killed
+    void resolve_attacks();
 
     static Model* mp_instance; // pointer to single instance of Model
 
-    Sim_objs_t                                               m_sim_objs;
-    Agents_t                                                 m_agents;
-    std::map<const std::string, std::shared_ptr<Structure>>  m_structures;
-    std::vector<std::shared_ptr<Group>>                      m_groups;
+    // declared first so it outlives every Agent's Moving_object
+    std::unique_ptr<Movement_system>                         mp_movement_system;
+    // every name ever interned, indexed by id
+    std::vector<std::string>                                 m_names;
+    // objects indexed by id, empty once removed or if not of that kind
+    std::vector<std::shared_ptr<Sim_object>>                 m_objs_by_id;
+    std::vector<std::shared_ptr<Agent>>                      m_agents_by_id;
+    std::vector<std::shared_ptr<Structure>>                  m_structures_by_id;
+    // ids of the live objects, only used to find objects by name
+    std::unordered_map<std::string, Object_id_t>             m_ids_by_name;
+    // ids sorted by name, the order objects update and describe themselves in,
+    // may still hold the ids of objects removed since the last compaction
+    std::vector<Object_id_t>                                 m_object_order;
+    // removed objects are kept alive until the end of the current update
+    std::vector<std::shared_ptr<Sim_object>>                 m_removed_objs;
+    // Groups in the order they were formed, the order they describe themselves
+    // and are saved in, and where each is in that list by name
+    using Groups_t = std::list<std::shared_ptr<Group>>;
+    Groups_t                                                 m_groups;
+    std::unordered_map<std::string, Groups_t::iterator>      m_groups_by_name;
     std::vector<std::shared_ptr<View>>                       m_views;
+    // changes not yet delivered to the Views, one per object, and the index
+    // of each object's change, -1 if it has none
+    std::vector<View_change>                                 m_view_changes;
+    std::vector<int>                                         m_view_change_index_of_id;
+    // The Views that want the changes every tick are sent only what changed since
+    // they were last sent anything: the fields of each buffered change that did, the
+    // indexes of those changes, and the changes as sent
+    int                                                      m_num_every_tick_views;
+    std::vector<unsigned>                                    m_tick_fields;
+    std::vector<int>                                         m_tick_change_indexes;
+    std::vector<View_change>                                 m_tick_changes;
+    std::unique_ptr<Spatial_grid<Agent>>                     mp_agent_grid;
+    std::unique_ptr<Spatial_grid<Structure>>                 mp_structure_grid;
+    std::unique_ptr<Worker_pool>                             mp_worker_pool;
+    std::unique_ptr<Logistics>                               mp_logistics;
+
+    // The update schedule. Each object is ASLEEP, SCHEDULED for its next turn, or
+    // WATCHING, asleep in mp_watcher_grid until an Agent comes within its watch range
+    enum Schedule_state : char { ASLEEP, SCHEDULED, WATCHING };
+    std::vector<Schedule_state>                              m_schedule_state_by_id;
+    // position of each live object's id in m_object_order, the order of updates,
+    // stale once an object has been inserted before others until the next update
+    std::vector<int>                                         m_order_of_id;
+    bool                                                     m_is_order_stale;
+    // ids scheduled for the next update: those kept on by their last update, in
+    // update order, and those woken since in any order
+    std::vector<Object_id_t>                                 m_kept_ids;
+    std::vector<Object_id_t>                                 m_woken_ids;
+    // ids woken during an update whose turn has not come yet, a heap with the
+    // earliest on top, and the position of the object being updated
+    std::vector<Object_id_t>                                 m_late_ids;
+    int                                                      m_update_position;
+    bool                                                     m_is_updating;
+    std::unique_ptr<Spatial_grid<Agent>>                     mp_watcher_grid;
+    double                                                   m_max_watch_range;
+    std::vector<std::shared_ptr<Agent>>                      m_nearby_watchers;
+
+    // hits queued by DEFERRED combat this tick, in the order they were made, and
+    // the Agents killed while they land, removed once all have landed
+    struct Attack {
+        Object_id_t attacker_id;
+        Object_id_t target_id;
+        int         strength;
+    };
+    std::vector<Attack>                                      m_attacks;
+    std::vector<std::shared_ptr<Agent>>                      m_killed_agents;
+    bool                                                     m_is_resolving_attacks;
 
     int m_time;
+    Tick_mode m_tick_mode;
+    Combat_mode m_combat_mode;
+    int m_relocation_count;
+    long long m_agent_update_count;
 };
 
-template <typename C, typename Comp>
-typename C::mapped_type Model::find_min_helper(C& container, Comp comp) {
-    auto iter = std::min_element(container.begin(), container.end(), comp);
-
-    if (iter == container.end()) {
-        return typename C::mapped_type();
-    }
-
-    return iter->second;
-}
-
-
-// returns pointer to Agent that evaluates least using passed in comparator
-// returns empty pointer if no such Agent found
-template <typename Comp>
-std::shared_ptr<Agent> Model::find_min_agent(Comp comp) {
-    return find_min_helper(m_agents, comp);
-}
-
-// returns pointer to Structure that evaluates least using passed in comparator
-// returns empty pointer if no such Structure found
-template <typename Comp>
-std::shared_ptr<Structure> Model::find_min_structure(Comp comp) {
-    return find_min_helper(m_structures, comp);
-}
-
-
 #endif // MODEL_H
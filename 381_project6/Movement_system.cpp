@@ -0,0 +1,132 @@
+#include "Movement_system.h"
+#include <cmath>
+#include <cassert>
+
+using std::fabs;
+
+
+Movement_system::Movement_system() : m_batched(false)
+{
+}
+
+// allocate storage for a new object owned by owner_, not moving
+Movement_system::Handle_t Movement_system::allocate(const Agent* owner_, const Point& location_,
+                                                    double speed_)
+{
+    // Reuse a released handle if there is one
+    Handle_t handle;
+    if (m_free_handles.empty()) {
+        handle = static_cast<Handle_t>(m_index_of_handle.size());
+        m_index_of_handle.push_back(0);
+    }
+    else {
+        handle = m_free_handles.back();
+        m_free_handles.pop_back();
+    }
+
+    // New objects always go at the end of the dense storage
+    m_index_of_handle[handle] = size();
+    m_x.push_back(location_.x);
+    m_y.push_back(location_.y);
+    m_dest_x.push_back(0.0);
+    m_dest_y.push_back(0.0);
+    m_delta_x.push_back(0.0);
+    m_delta_y.push_back(0.0);
+    m_speed.push_back(speed_);
+    m_moving.push_back(false);
+    m_step_state.push_back(NOT_STEPPED);
+    m_owners.push_back(owner_);
+    m_handle_of_index.push_back(handle);
+
+    return handle;
+}
+
+// release the storage of handle_, the last slot is moved into its place
+void Movement_system::release(Handle_t handle_) {
+    const int index = index_of(handle_);
+    const int last = size() - 1;
+    assert(index >= 0 && index <= last);
+
+    if (index != last) {
+        m_x[index] = m_x[last];
+        m_y[index] = m_y[last];
+        m_dest_x[index] = m_dest_x[last];
+        m_dest_y[index] = m_dest_y[last];
+        m_delta_x[index] = m_delta_x[last];
+        m_delta_y[index] = m_delta_y[last];
+        m_speed[index] = m_speed[last];
+        m_moving[index] = m_moving[last];
+        m_step_state[index] = m_step_state[last];
+        m_owners[index] = m_owners[last];
+        m_handle_of_index[index] = m_handle_of_index[last];
+        m_index_of_handle[m_handle_of_index[index]] = index;
+    }
+
+    m_x.pop_back();
+    m_y.pop_back();
+    m_dest_x.pop_back();
+    m_dest_y.pop_back();
+    m_delta_x.pop_back();
+    m_delta_y.pop_back();
+    m_speed.pop_back();
+    m_moving.pop_back();
+    m_step_state.pop_back();
+    m_owners.pop_back();
+    m_handle_of_index.pop_back();
+
+    m_free_handles.push_back(handle_);
+}
+
+// Step every moving object once
+void Movement_system::advance_all() {
+    advance_range(0, size());
+    collect_moved_owners();
+}
+
+// Step the slots in [begin, end). This performs the same computation as
+// Moving_object::update_location for every slot, written without branches so that
+// the loop can be vectorized. Stopped objects keep their location, objects that
+// arrive are placed on their destination and stopped.
+void Movement_system::advance_range(int begin, int end) {
+    assert(begin >= 0 && end <= size());
+
+    double* const x = m_x.data();
+    double* const y = m_y.data();
+    double* const dest_x = m_dest_x.data();
+    double* const dest_y = m_dest_y.data();
+    double* const delta_x = m_delta_x.data();
+    double* const delta_y = m_delta_y.data();
+    char* const moving = m_moving.data();
+    char* const step_state = m_step_state.data();
+
+    for (int i = begin; i < end; ++i) {
+        const bool is_moving = moving[i] != 0;
+        const bool arrives = (fabs(dest_x[i] - x[i]) <= fabs(delta_x[i])) &&
+                             (fabs(dest_y[i] - y[i]) <= fabs(delta_y[i]));
+        const bool stops = is_moving && arrives;
+
+        x[i] = !is_moving ? x[i] : (arrives ? dest_x[i] : x[i] + delta_x[i]);
+        y[i] = !is_moving ? y[i] : (arrives ? dest_y[i] : y[i] + delta_y[i]);
+
+        // arriving objects stop, see Moving_object::stop_moving
+        delta_x[i] = stops ? 0.0 : delta_x[i];
+        delta_y[i] = stops ? 0.0 : delta_y[i];
+        dest_x[i] = stops ? 0.0 : dest_x[i];
+        dest_y[i] = stops ? 0.0 : dest_y[i];
+        moving[i] = is_moving && !arrives;
+        step_state[i] = !is_moving ? NOT_STEPPED : (arrives ? ARRIVED : STEPPED);
+    }
+}
+
+// Remember who moved so that their owners' locations can be reindexed
+void Movement_system::collect_moved_owners() {
+    const int n = size();
+    const char* const step_state = m_step_state.data();
+
+    m_moved_owners.clear();
+    for (int i = 0; i < n; ++i) {
+        if (step_state[i] != NOT_STEPPED) {
+            m_moved_owners.push_back(m_owners[i]);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef MOVEMENT_SYSTEM_H
+#define MOVEMENT_SYSTEM_H
+
+#include "Geometry.h"
+#include <vector>
+
+class Agent;
+
+/*
+Movement_system stores the movement state of every Moving_object in contiguous
+structure-of-arrays storage: locations, destinations, per-step deltas, speeds and
+moving flags each live in their own array. A Moving_object only holds a handle
+into this storage.
+
+Storage is kept dense, releasing a slot moves the last slot into the hole, so a
+batched pass over all movers walks each array front to back. advance_all() steps
+every moving object in one such pass, which the compiler can vectorize. When
+batched movement is on, Moving_objects report the result of that pass instead of
+stepping themselves.
+*/
+
+class Movement_system {
+public:
+    using Handle_t = int;
+
+    Movement_system();
+
+    // allocate storage for a new object owned by owner_, not moving
+    Handle_t allocate(const Agent* owner_, const Point& location_, double speed_);
+    // release the storage of handle_, handle_ must not be used afterwards
+    void release(Handle_t handle_);
+
+    // Step every moving object once. Objects within one step of their destination
+    // arrive there and stop. Each object's result is kept until it reads it with
+    // Moving_object::advance().
+    void advance_all();
+    // advance_all() in two parts, so that disjoint slot ranges can be stepped
+    // concurrently: step the slots in [begin, end), then once every slot has been
+    // stepped record who moved.
+    void advance_range(int begin, int end);
+    void collect_moved_owners();
+
+    // Returns the owners of the objects that moved in the last advance_all() call
+    const std::vector<const Agent*>& get_moved_owners() const { return m_moved_owners; }
+
+    // When batched, objects are stepped by advance_all() rather than by themselves
+    void set_batched(bool batched_) { m_batched = batched_; }
+    bool is_batched() const { return m_batched; }
+
+    // returns the number of objects in storage
+    int size() const { return static_cast<int>(m_x.size()); }
+
+    // disallow copy/move construction or assignment
+    Movement_system(const Movement_system&) = delete;
+    Movement_system& operator= (const Movement_system&) = delete;
+    Movement_system(Movement_system&&) = delete;
+    Movement_system& operator= (Movement_system&&) = delete;
+
+private:
+    // Moving_object reads and writes its own slot directly
+    friend class Moving_object;
+
+    // Result of the last advance_all() for a slot
+    enum Step_state : char { NOT_STEPPED, STEPPED, ARRIVED };
+
+    int index_of(Handle_t handle_) const { return m_index_of_handle[handle_]; }
+
+    // per-object arrays, all indexed by the same dense slot index
+    std::vector<double>       m_x;
+    std::vector<double>       m_y;
+    std::vector<double>       m_dest_x;
+    std::vector<double>       m_dest_y;
+    std::vector<double>       m_delta_x;
+    std::vector<double>       m_delta_y;
+    std::vector<double>       m_speed;
+    std::vector<char>         m_moving;
+    std::vector<char>         m_step_state;
+    std::vector<const Agent*> m_owners;
+    std::vector<Handle_t>     m_handle_of_index;
+
+    // handles are stable, they map to slot indices that change as slots are released
+    std::vector<int>          m_index_of_handle;
+    std::vector<Handle_t>     m_free_handles;
+
+    std::vector<const Agent*> m_moved_owners;
+    bool                      m_batched;
+};
+
+#endif // MOVEMENT_SYSTEM_H
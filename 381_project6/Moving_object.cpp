@@ -1,8 +1,15 @@
 #include "Moving_object.h"
+#include "Snapshot.h"
 #include <cmath>
+#include <limits>
+#include <cassert>
 
 using std::fabs;
 
+// Steps kept back from the closed form arrival estimate, the stepwise sums round
+// differently from it so the actual arrival may come slightly sooner
+constexpr int kARRIVAL_STEP_MARGIN = 2;
+
 
 // Tell this object to start moving to location in_destination
 // If it is already at the destination and moving, it stops;
@@ -10,24 +17,26 @@ using std::fabs;
 // Otherwise, it starts moving, advancing by delta on each update call.
 void Moving_object::start_moving(Point destination_)
 {
-    if(location == destination_) {
-        if(moving) {
+    if(get_current_location() == destination_) {
+        if(is_currently_moving()) {
             stop_moving();
             }
         return;
         }
     // time to start moving
-    moving = true;
-    destination = destination_;
+    const int i = index();
+    system.m_moving[i] = true;
+    system.m_dest_x[i] = destination_.x;
+    system.m_dest_y[i] = destination_.y;
     compute_delta();
 }
 
 // change the speed by recomputing the delta if we are moving
 void Moving_object::set_speed(double speed_)
 {
-    speed = speed_;
+    system.m_speed[index()] = speed_;
     // recompute the delta to get to the same destination
-    if(moving)
+    if(is_currently_moving())
         compute_delta();
 }
 
@@ -35,9 +44,12 @@ void Moving_object::set_speed(double speed_)
 // reset the delta and the destination to make it more obvious that we aren't moving
 void Moving_object::stop_moving()
 {
-    moving = false;
-    delta = Cartesian_vector();
-    destination = Point();
+    const int i = index();
+    system.m_moving[i] = false;
+    system.m_delta_x[i] = 0.0;
+    system.m_delta_y[i] = 0.0;
+    system.m_dest_x[i] = 0.0;
+    system.m_dest_y[i] = 0.0;
 }
 
 // If the destination is within one delta step away, the object has arrived.
@@ -45,29 +57,131 @@ void Moving_object::stop_moving()
 // Otherwise, add the delta to the location, and return false.
 bool Moving_object::update_location()
 {
-    Cartesian_vector diff = destination - location;
-    if ((fabs(diff.delta_x) <= fabs(delta.delta_x)) && (fabs(diff.delta_y) <= fabs(delta.delta_y))) {
-        location = destination;
+    const int i = index();
+    Cartesian_vector diff = get_current_destination() - get_current_location();
+    if ((fabs(diff.delta_x) <= fabs(system.m_delta_x[i])) &&
+        (fabs(diff.delta_y) <= fabs(system.m_delta_y[i]))) {
+        system.m_x[i] = system.m_dest_x[i];
+        system.m_y[i] = system.m_dest_y[i];
         stop_moving();
         return true;
         }
-    location = location + delta;
+    system.m_x[i] = system.m_x[i] + system.m_delta_x[i];
+    system.m_y[i] = system.m_y[i] + system.m_delta_y[i];
     return false;
 }
 
+// Report the step taken by the batched pass, or take one now
+bool Moving_object::advance(bool& has_arrived)
+{
+    if (system.is_batched()) {
+        const int i = index();
+        const char step_state = system.m_step_state[i];
+        system.m_step_state[i] = Movement_system::NOT_STEPPED;
+        has_arrived = step_state == Movement_system::ARRIVED;
+        return step_state != Movement_system::NOT_STEPPED;
+    }
+
+    if (!is_currently_moving()) {
+        return false;
+    }
+
+    has_arrived = update_location();
+    return true;
+}
+
+// Each step covers speed of the distance left, less the margin for rounding
+int Moving_object::get_steps_before_arrival() const
+{
+    const double speed = get_current_speed();
+    if (!is_currently_moving() || speed <= 0.0) {
+        return 0;
+    }
+
+    const double steps = cartesian_distance(get_current_location(), get_current_destination()) / speed
+                         - kARRIVAL_STEP_MARGIN;
+    if (steps <= 0.0) {
+        return 0;
+    }
+    return steps >= std::numeric_limits<int>::max() ? std::numeric_limits<int>::max()
+                                                    : static_cast<int>(steps);
+}
+
+// Repeats the same additions update_location makes, closer steps would round
+// differently. The distance left only shrinks, so if the last step is short of
+// the destination every step was.
+void Moving_object::skip_steps(int steps)
+{
+    if (steps <= 0) {
+        return;
+    }
+
+    const int i = index();
+    const double delta_x = system.m_delta_x[i];
+    const double delta_y = system.m_delta_y[i];
+    double x = system.m_x[i];
+    double y = system.m_y[i];
+    for (int step = 1; step < steps; ++step) {
+        x = x + delta_x;
+        y = y + delta_y;
+    }
+
+    assert(!((fabs(system.m_dest_x[i] - x) <= fabs(delta_x)) &&
+             (fabs(system.m_dest_y[i] - y) <= fabs(delta_y))));
+    system.m_x[i] = x + delta_x;
+    system.m_y[i] = y + delta_y;
+}
+
 // Jump to passed in target location then recompute the delta to destination
 void Moving_object::jump_to_location(Point target_) {
     // Do nothing if already at target_
-    if (location == target_) {
+    if (get_current_location() == target_) {
         return;
     }
 
-    location = target_;
+    const int i = index();
+    system.m_x[i] = target_.x;
+    system.m_y[i] = target_.y;
     compute_delta();
 }
 
 // use the Geometry operators to compute the delta change in x and y per update
 void Moving_object::compute_delta()
 {
-    delta = (destination - location) * (speed / cartesian_distance(destination, location));
+    const Point location = get_current_location();
+    const Point destination = get_current_destination();
+    const Cartesian_vector delta =
+        (destination - location) * (get_current_speed() / cartesian_distance(destination, location));
+
+    const int i = index();
+    system.m_delta_x[i] = delta.delta_x;
+    system.m_delta_y[i] = delta.delta_y;
+}
+
+// The destination and delta only matter while moving. The delta is saved rather
+// than recomputed, it was computed from where the object was when it set off.
+void Moving_object::save_state(Snapshot_writer& writer_) const
+{
+    const int i = index();
+    writer_.write_double(system.m_speed[i]);
+    writer_.write_u8(system.m_moving[i] != 0);
+    if (system.m_moving[i]) {
+        writer_.write_double(system.m_dest_x[i]);
+        writer_.write_double(system.m_dest_y[i]);
+        writer_.write_double(system.m_delta_x[i]);
+        writer_.write_double(system.m_delta_y[i]);
+    }
+}
+
+void Moving_object::restore_state(Snapshot_reader& reader_)
+{
+    const int i = index();
+    system.m_speed[i] = reader_.read_double();
+    system.m_moving[i] = reader_.read_u8() != 0;
+    if (system.m_moving[i]) {
+        system.m_dest_x[i] = reader_.read_double();
+        system.m_dest_y[i] = reader_.read_double();
+        system.m_delta_x[i] = reader_.read_double();
+        system.m_delta_y[i] = reader_.read_double();
+    }
 }
@@ -2,27 +2,34 @@
 #define MOVING_OBJECT
 
 #include "Geometry.h"
+#include "Movement_system.h"
 
 /* Moving_object encapsulates the calculations needed to make an object move 
 from one point to another, moving a specified distance on each update_location call.
+The movement state itself is kept in a Movement_system's contiguous storage, a
+Moving_object is a handle to its slot there.
 */
 
+class Agent;
+class Snapshot_writer;
+class Snapshot_reader;
+
 class Moving_object {
 public:
-    Moving_object() :
-        moving(false) {}
-    Moving_object(Point location_, double speed_) :
-        moving(false), location(location_), speed(speed_) {}
+    Moving_object(Movement_system& system_, const Agent* owner_, Point location_, double speed_) :
+        system(system_), handle(system_.allocate(owner_, location_, speed_)) {}
+    ~Moving_object()
+        {system.release(handle);}
 
     // readers
     bool is_currently_moving() const
-        {return moving;}
+        {return system.m_moving[index()] != 0;}
     Point get_current_location() const
-        {return location;}
+        {return Point(system.m_x[index()], system.m_y[index()]);}
     double get_current_speed() const
-        {return speed;}
+        {return system.m_speed[index()];}
     Point get_current_destination() const
-        {return destination;}
+        {return Point(system.m_dest_x[index()], system.m_dest_y[index()]);}
     
     // Tell this object to start moving to location destination.
     // If it is already at the destination and moving, it stops;
@@ -36,16 +43,38 @@ public:
     // update this object's location using current location, speed, and destination
     // returns true if arrived at destination, false if not
     bool update_location();
+    // Move this object for the current update. If the Movement_system is batched the
+    // step was already taken by its advance_all() and that step is reported,
+    // otherwise the object takes a step if it is moving.
+    // Returns true if the object moved, has_arrived is set if it arrived.
+    bool advance(bool& has_arrived);
+    // Returns how many steps this object can certainly take before the step that
+    // arrives, computed from the distance left, 0 if it is not moving
+    int get_steps_before_arrival() const;
+    // Take steps steps at once, which must all be short of the destination. The
+    // location ends up exactly where that many update_location calls leave it.
+    void skip_steps(int steps);
     // Allow object to be jump to a location
     void jump_to_location(Point target_);
 
+    // write the speed and movement to a snapshot, and read them back, the
+    // location is restored by constructing the object there
+    void save_state(Snapshot_writer& writer_) const;
+    void restore_state(Snapshot_reader& reader_);
+
+    // disallow copy/move construction or assignment, the handle is owned
+    Moving_object(const Moving_object&) = delete;
+    Moving_object& operator= (const Moving_object&) = delete;
+    Moving_object(Moving_object&&) = delete;
+    Moving_object& operator= (Moving_object&&) = delete;
+
 private:
-    bool moving;            // true if this object is moving
-    Point location;            // current location
-    double speed;            // distance moved per update
-    Point destination;        // destination to move to
-    Cartesian_vector delta;    // x, y increments per update
-    
+    Movement_system& system;            // storage for the movement state
+    Movement_system::Handle_t handle;   // this object's slot in system
+
+    int index() const
+        {return system.index_of(handle);}
+
     // helpers
     void compute_delta();
 };
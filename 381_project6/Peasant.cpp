@@ -2,6 +2,9 @@
 #include "Utility.h"
 #include "Structure.h"
 #include "Model.h"
+#include "Snapshot.h"
+#include "Logistics.h"
+#include "Event_log.h"
 #include <string>
 #include <iostream>
 #include <memory>
@@ -18,17 +21,23 @@ constexpr double kPEASANT_MAX_AMOUNT = 35.0;
 Peasant::Peasant(const string& name_, const Point& location_)
     : Agent(name_, location_, kPEASANT_INITIAL_HEALTH), m_source(nullptr),
     m_destination(nullptr), m_amount(kPEASANT_INITIAL_AMOUNT),
-    m_peasant_state(Peasant_State::NOT_WORKING)
+    m_peasant_state(Peasant_State::NOT_WORKING), m_is_waiting(false)
 {
 }
 
-bool Peasant::is_working() {
+bool Peasant::is_working() const {
     return m_peasant_state != Peasant_State::NOT_WORKING;
 }
 
+bool Peasant::is_active() const {
+    return Agent::is_active() || (is_working() && !m_is_waiting);
+}
+
 // implement Peasant behavior
 void Peasant::update() {
     Agent::update();
+    // only updated while waiting once woken
+    m_is_waiting = false;
 
     // Do nothing further if dead or not working
     if (!is_alive() || !is_working()) {
@@ -47,21 +56,22 @@ void Peasant::update() {
         }
         break;
     case Peasant_State::COLLECTING:
-        // request as much as we can carry
+        // request as much as we can carry, any food claimed for us is here now
         request_amount = kPEASANT_MAX_AMOUNT - m_amount;
+        Model::get_instance()->get_logistics().release(get_id());
         recieved_amount = m_source->withdraw(request_amount);
 
         // If we collected some food, report it and then move to deposit
         if (recieved_amount > 0.0) {
-            cout << get_name() << ": Collected " << recieved_amount << endl;
+            LOG_EVENT(WORK, INFO) << get_name() << ": Collected " << recieved_amount << endl;
             m_amount += recieved_amount;
-            Model::get_instance()->notify_amount(get_name(), m_amount);
+            Model::get_instance()->notify_amount(get_id(), m_amount);
             m_peasant_state = Peasant_State::OUTBOUND;
             Agent::move_to(m_destination->get_location());
         }
         // Wait for some food otherwise
         else {
-            cout << get_name() << ": Waiting " << endl;
+            wait_for_food(request_amount);
         }
         break;
     case Peasant_State::OUTBOUND:
@@ -73,9 +83,9 @@ void Peasant::update() {
     case Peasant_State::DEPOSITING:
         // Deposit what we have at destination and report it
         m_destination->deposit(m_amount);
-        cout << get_name() << ": Deposited " << m_amount << endl;
+        LOG_EVENT(WORK, INFO) << get_name() << ": Deposited " << m_amount << endl;
         m_amount = 0.0;
-        Model::get_instance()->notify_amount(get_name(), m_amount);
+        Model::get_instance()->notify_amount(get_id(), m_amount);
 
         // Move to the source
         m_peasant_state = Peasant_State::INBOUND;
@@ -86,7 +96,38 @@ void Peasant::update() {
     }
 }
 
+int Peasant::get_quiet_updates() const {
+    if (is_working() && !is_moving()) {
+        return 0;
+    }
+    return Agent::get_quiet_updates();
+}
+
+void Peasant::wait_for_food(double request_amount) {
+    Logistics& logistics = Model::get_instance()->get_logistics();
+    if (logistics.get_mode() != Logistics::Mode::OFF) {
+        shared_ptr<Structure> new_source =
+            logistics.find_better_source(get_location(), get_speed(), m_source, m_destination,
+                                         request_amount);
+        if (new_source) {
+            LOG_EVENT(WORK, INFO) << get_name() << ": Collecting from " << new_source->get_name() << " instead" << endl;
+            m_source = new_source;
+            logistics.head_for(get_id(), *m_source, request_amount);
+            m_peasant_state = Peasant_State::INBOUND;
+            Agent::move_to(m_source->get_location());
+            return;
+        }
+
+        m_is_waiting = true;
+        logistics.wait_for_food(get_id(), *m_source, request_amount);
+    }
+
+    LOG_EVENT(WORK, DEBUG) << get_name() << ": Waiting " << endl;
+}
+
 void Peasant::forget_work() {
+    Model::get_instance()->get_logistics().release(get_id());
+    m_is_waiting = false;
     m_peasant_state = Peasant_State::NOT_WORKING;
     m_source = nullptr;
     m_destination = nullptr;
@@ -94,7 +135,7 @@ void Peasant::forget_work() {
 
 void Peasant::stop_working() {
     if (is_working()) {
-        cout << get_name() << ": I'm stopping work" << endl;
+        LOG_EVENT(WORK, INFO) << get_name() << ": I'm stopping work" << endl;
         forget_work();
     }
 }
@@ -105,6 +146,13 @@ void Peasant::move_to(const Point& dest) {
     Agent::move_to(dest);
 }
 
+void Peasant::take_hit(int attack_strength, shared_ptr<Agent> attacker_ptr) {
+    Agent::take_hit(attack_strength, attacker_ptr);
+    if (!is_alive()) {
+        Model::get_instance()->get_logistics().release(get_id());
+    }
+}
+
 // stop moving and working
 void Peasant::stop() {
     Agent::stop();
@@ -118,12 +166,13 @@ void Peasant::start_working(shared_ptr<Structure> source_, shared_ptr<Structure>
     forget_work();
 
     if (source_ == destination_) {
-        cout << get_name() + ": I can't move food to and from the same place!" << endl;
+        LOG_EVENT(WORK, WARNING) << get_name() + ": I can't move food to and from the same place!" << endl;
         return;
     }
 
     m_source = source_;
     m_destination = destination_;
+    wake();
 
     // Peasant has no food
     if (m_amount == 0.0) {
@@ -154,7 +203,7 @@ void Peasant::start_working(shared_ptr<Structure> source_, shared_ptr<Structure>
 void Peasant::broadcast_current_state() const {
     // Tell View where agents are
     Agent::broadcast_current_state();
-    Model::get_instance()->notify_amount(get_name(), m_amount);
+    Model::get_instance()->notify_amount(get_id(), m_amount);
 }
 
 // output information about the current state
@@ -183,3 +232,42 @@ void Peasant::describe() const {
         throw Error("Unrecognized state in Peasant::describe");
     }
 }
+
+const string& Peasant::get_type_string() const {
+    static const string my_type = "Peasant";
+    return my_type;
+}
+
+// The source and destination are only set while working, and a Peasant only
+// waits while collecting
+void Peasant::save_state(Snapshot_writer& writer) const {
+    Agent::save_state(writer);
+    writer.write_double(m_amount);
+    writer.write_u8(static_cast<std::uint8_t>(m_peasant_state));
+    writer.write_object_ref(m_source.get());
+    writer.write_object_ref(m_destination.get());
+    writer.write_u8(m_is_waiting ? 1 : 0);
+}
+
+void Peasant::restore_state(Snapshot_reader& reader) {
+    Agent::restore_state(reader);
+    m_amount = reader.read_double();
+
+    const int state = reader.read_u8();
+    m_source = reader.read_object_ref<Structure>();
+    m_destination = reader.read_object_ref<Structure>();
+    const int is_waiting = reader.read_u8();
+    if (state > static_cast<int>(Peasant_State::OUTBOUND) || is_waiting > 1) {
+        throw Error("Snapshot file is corrupt!");
+    }
+    m_peasant_state = static_cast<Peasant_State>(state);
+    // only a Peasant collecting at its source waits
+    m_is_waiting = is_waiting != 0;
+    if (m_is_waiting && m_peasant_state != Peasant_State::COLLECTING) {
+        throw Error("Snapshot file is corrupt!");
+    }
+
+    if (is_working() != (m_source && m_destination)) {
+        throw Error("Snapshot file is corrupt!");
+    }
+}
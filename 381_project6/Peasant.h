@@ -23,8 +23,19 @@ public:
     // ask Model to broadcast our current state to all Views
     void broadcast_current_state() const override;
 
+    // return string "Peasant"
+    const std::string& get_type_string() const override;
+
+    // write the work state to a snapshot, and read it back
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // implement Peasant behavior
     void update() override;
+    // a Peasant has work to do while it is moving or working
+    bool is_active() const override;
+    // collecting and depositing are never quiet, walking between them is
+    int get_quiet_updates() const override;
 
     // output information about the current state
     void describe() const override;
@@ -35,6 +46,9 @@ public:
     // stop moving and working
     void stop() override;
 
+    // a Peasant that dies gives up its claim on food
+    void take_hit(int attack_strength, std::shared_ptr<Agent> attacker_ptr) override;
+
     // starts the working process
     // Throws an exception if the source is the same as the destination.
     void start_working(std::shared_ptr<Structure> source_, 
@@ -51,7 +65,7 @@ private:
     enum class Peasant_State { NOT_WORKING, DEPOSITING, COLLECTING, INBOUND, OUTBOUND };
 
     // Returns true if the Peasant is in any 'working' state
-    bool is_working();
+    bool is_working() const;
 
     // sets Peasant state to NOT_WORKING and forgets source and destination Structures
     void forget_work();
@@ -59,10 +73,16 @@ private:
     // Peasant forgets work and outputs stop message
     void stop_working();
 
+    // The source had no food. Waits for some, asleep in the source's queue if
+    // logistics is on, or goes to collect from a source that can serve it sooner.
+    void wait_for_food(double request_amount);
+
     std::shared_ptr<Structure> m_source;
     std::shared_ptr<Structure> m_destination;
     double m_amount;
     Peasant_State m_peasant_state;
+    // asleep until woken by Logistics, still COLLECTING
+    bool m_is_waiting;
 };
 
 #endif // PEASANT_H
@@ -0,0 +1,57 @@
+#include "Pool_allocator.h"
+#include <algorithm>
+#include <cassert>
+
+using std::size_t;
+
+// Number of blocks in the first chunk of a pool, and the most in any chunk
+constexpr size_t kINITIAL_BLOCKS_PER_CHUNK = 64;
+constexpr size_t kMAX_BLOCKS_PER_CHUNK = 65536;
+
+Block_pool::Block_pool(size_t block_size, size_t alignment)
+    : m_blocks_per_chunk(kINITIAL_BLOCKS_PER_CHUNK), mp_free_list(nullptr)
+{
+    // operator new only guarantees the alignment of the fundamental types
+    assert(alignment <= alignof(std::max_align_t));
+
+    // every block must be able to hold a free list link, and blocks follow
+    // each other so each must start at a multiple of both alignments
+    alignment = std::max(alignment, alignof(Free_block));
+    block_size = std::max(block_size, sizeof(Free_block));
+    m_block_size = (block_size + alignment - 1) / alignment * alignment;
+}
+
+Block_pool::~Block_pool() {
+    for (void* chunk : m_chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+// Take the most recently freed block
+void* Block_pool::allocate() {
+    if (!mp_free_list) {
+        add_chunk();
+    }
+
+    Free_block* block = mp_free_list;
+    mp_free_list = block->next;
+    return block;
+}
+
+void Block_pool::deallocate(void* block) noexcept {
+    Free_block* free_block = static_cast<Free_block*>(block);
+    free_block->next = mp_free_list;
+    mp_free_list = free_block;
+}
+
+// The blocks are linked in address order, so a fresh chunk is handed out front to back
+void Block_pool::add_chunk() {
+    char* chunk = static_cast<char*>(::operator new(m_block_size * m_blocks_per_chunk));
+    m_chunks.push_back(chunk);
+
+    for (size_t i = m_blocks_per_chunk; i > 0; --i) {
+        deallocate(chunk + (i - 1) * m_block_size);
+    }
+
+    m_blocks_per_chunk = std::min(2 * m_blocks_per_chunk, kMAX_BLOCKS_PER_CHUNK);
+}
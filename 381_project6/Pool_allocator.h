@@ -0,0 +1,96 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+/*
+Block_pool hands out fixed size blocks of memory carved from large chunks. Freed
+blocks go onto a free list and are handed out again before any new chunk is needed,
+so allocating and freeing a block are both O(1) and only the occasional new chunk
+calls the general purpose heap. Chunks grow geometrically up to a limit.
+
+Pool_allocator<T> is a standard allocator that takes single objects from a pool
+shared by every T, so it can be given to std::allocate_shared: the object and its
+control block are then placed together in a pool used only by objects of that type,
+keeping objects of one type close together however many are created and destroyed.
+Arrays are passed on to the general purpose heap.
+
+Pools are not thread safe, objects must be created and destroyed by one thread at a time.
+*/
+
+class Block_pool {
+public:
+    // blocks are at least block_size bytes and aligned to alignment
+    Block_pool(std::size_t block_size, std::size_t alignment);
+    ~Block_pool();
+
+    void* allocate();
+    void deallocate(void* block) noexcept;
+
+    // disallow copy/move construction or assignment
+    Block_pool(const Block_pool&) = delete;
+    Block_pool& operator= (const Block_pool&) = delete;
+    Block_pool(Block_pool&&) = delete;
+    Block_pool& operator= (Block_pool&&) = delete;
+
+private:
+    struct Free_block {
+        Free_block* next;
+    };
+
+    // allocate a new chunk and put its blocks on the free list
+    void add_chunk();
+
+    std::size_t        m_block_size;
+    std::size_t        m_blocks_per_chunk;
+    Free_block*        mp_free_list;
+    std::vector<void*> m_chunks;
+};
+
+template <typename T>
+class Pool_allocator {
+public:
+    using value_type = T;
+
+    Pool_allocator() noexcept {}
+    template <typename U>
+    Pool_allocator(const Pool_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(get_pool().allocate());
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if (n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        get_pool().deallocate(ptr);
+    }
+
+private:
+    // The pool is never destroyed, objects may still be released to it while
+    // other static objects, such as the Model, are being destroyed at exit
+    static Block_pool& get_pool() {
+        static Block_pool* const pool_ptr = new Block_pool(sizeof(T), alignof(T));
+        return *pool_ptr;
+    }
+};
+
+// every allocator of a type draws on the same pool
+template <typename T, typename U>
+bool operator==(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept {
+    return false;
+}
+
+#endif // POOL_ALLOCATOR_H
@@ -0,0 +1,211 @@
+#include "Profiler.h"
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <iterator>
+
+using std::string;
+using std::vector;
+using std::ostream;
+using std::find_if;
+
+// Number of ticks whose profile is kept
+constexpr std::size_t kMAX_PROFILED_TICKS = 1000;
+
+// Names used in the output, in the order of the Phase and Counter enumerators
+static const char* const kPHASE_NAMES[Profiler::NUM_PHASES] = {
+    "movement", "plan", "update", "combat", "cleanup"
+};
+static const char* const kCOUNTER_NAMES[Profiler::NUM_COUNTERS] = {
+    "agent_searches", "structure_searches", "hits_taken", "withdrawals", "deposits",
+    "view_notifications", "dead_member_sweeps", "agent_deaths"
+};
+
+Profiler* Profiler::get_instance() {
+    static Profiler the_profiler;
+    return &the_profiler;
+}
+
+Profiler::Profiler() : m_current()
+{
+    for (auto& counter : m_counters) {
+        counter.store(0);
+    }
+}
+
+void Profiler::begin_tick(int time) {
+    m_current.time = time;
+    m_current.seconds = 0.0;
+    std::fill(std::begin(m_current.phase_seconds), std::end(m_current.phase_seconds), 0.0);
+    m_current.types.clear();
+    for (auto& counter : m_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    m_tick_start = std::chrono::steady_clock::now();
+}
+
+void Profiler::end_tick() {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_tick_start;
+    m_current.seconds = elapsed.count();
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+        m_current.counters[i] = m_counters[i].load(std::memory_order_relaxed);
+    }
+
+    if (m_ticks.size() == kMAX_PROFILED_TICKS) {
+        m_ticks.pop_front();
+    }
+    m_ticks.push_back(m_current);
+}
+
+// There are only a handful of types, and their strings can be told apart by address
+void Profiler::add_update_time(const string& type, double seconds) {
+    auto iter = find_if(m_current.types.begin(), m_current.types.end(),
+        [&type](const Type_profile& p){ return p.type == &type; });
+
+    if (iter == m_current.types.end()) {
+        m_current.types.push_back(Type_profile{ &type, 0, 0.0 });
+        iter = m_current.types.end() - 1;
+    }
+
+    ++iter->updates;
+    iter->seconds += seconds;
+}
+
+void Profiler::print(ostream& os, int num_ticks, Format format) const {
+    const std::size_t count = std::min(m_ticks.size(), static_cast<std::size_t>(std::max(num_ticks, 0)));
+    const Ticks_t::const_iterator first = m_ticks.end() - count;
+
+    // times are printed in milliseconds with microsecond resolution
+    const std::ios::fmtflags old_flags = os.flags();
+    const std::streamsize old_precision = os.precision();
+    os.setf(std::ios::fixed, std::ios::floatfield);
+    os.precision(3);
+
+    switch (format) {
+    case Format::TEXT:
+        print_text(os, first);
+        break;
+    case Format::CSV:
+        print_csv(os, first);
+        break;
+    case Format::JSON:
+        print_json(os, first);
+        break;
+    }
+
+    os.flags(old_flags);
+    os.precision(old_precision);
+}
+
+// returns the distinct names of types, sorted
+static vector<string> get_type_names(const vector<const string*>& types) {
+    vector<string> names;
+    for (const string* type : types) {
+        names.push_back(*type);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+void Profiler::print_text(ostream& os, Ticks_t::const_iterator first) const {
+    os << "Profile of the last " << (m_ticks.end() - first) << " ticks:" << std::endl;
+
+    for (auto tick = first; tick != m_ticks.end(); ++tick) {
+        os << "Tick " << tick->time << ": " << 1000.0 * tick->seconds << " ms";
+        for (int i = 0; i < NUM_PHASES; ++i) {
+            os << ", " << kPHASE_NAMES[i] << ' ' << 1000.0 * tick->phase_seconds[i];
+        }
+        os << std::endl;
+
+        vector<Type_profile> types = tick->types;
+        std::sort(types.begin(), types.end(),
+            [](const Type_profile& lhs, const Type_profile& rhs){ return *lhs.type < *rhs.type; });
+        for (const Type_profile& p : types) {
+            os << "   " << *p.type << ": " << p.updates << " updates, "
+               << 1000.0 * p.seconds << " ms" << std::endl;
+        }
+
+        os << "  ";
+        for (int i = 0; i < NUM_COUNTERS; ++i) {
+            string name = kCOUNTER_NAMES[i];
+            std::replace(name.begin(), name.end(), '_', ' ');
+            os << (i == 0 ? " " : ", ") << name << ' ' << tick->counters[i];
+        }
+        os << std::endl;
+    }
+}
+
+// One row per tick, with a pair of columns for every type updated in any of the ticks
+void Profiler::print_csv(ostream& os, Ticks_t::const_iterator first) const {
+    vector<const string*> all_types;
+    for (auto tick = first; tick != m_ticks.end(); ++tick) {
+        for (const Type_profile& p : tick->types) {
+            all_types.push_back(p.type);
+        }
+    }
+    const vector<string> type_names = get_type_names(all_types);
+
+    os << "time,total_ms";
+    for (const char* name : kPHASE_NAMES) {
+        os << ',' << name << "_ms";
+    }
+    for (const char* name : kCOUNTER_NAMES) {
+        os << ',' << name;
+    }
+    for (const string& name : type_names) {
+        os << ',' << name << "_updates," << name << "_ms";
+    }
+    os << std::endl;
+
+    for (auto tick = first; tick != m_ticks.end(); ++tick) {
+        os << tick->time << ',' << 1000.0 * tick->seconds;
+        for (double seconds : tick->phase_seconds) {
+            os << ',' << 1000.0 * seconds;
+        }
+        for (long long counter : tick->counters) {
+            os << ',' << counter;
+        }
+        for (const string& name : type_names) {
+            auto iter = find_if(tick->types.begin(), tick->types.end(),
+                [&name](const Type_profile& p){ return *p.type == name; });
+            if (iter == tick->types.end()) {
+                os << ",0," << 0.0;
+            }
+            else {
+                os << ',' << iter->updates << ',' << 1000.0 * iter->seconds;
+            }
+        }
+        os << std::endl;
+    }
+}
+
+// An object holding an array of ticks, one tick per line
+void Profiler::print_json(ostream& os, Ticks_t::const_iterator first) const {
+    os << "{\"ticks\": [";
+
+    for (auto tick = first; tick != m_ticks.end(); ++tick) {
+        os << (tick == first ? "\n" : ",\n");
+        os << "{\"time\": " << tick->time << ", \"total_ms\": " << 1000.0 * tick->seconds;
+
+        os << ", \"phases_ms\": {";
+        for (int i = 0; i < NUM_PHASES; ++i) {
+            os << (i == 0 ? "" : ", ") << '"' << kPHASE_NAMES[i] << "\": "
+               << 1000.0 * tick->phase_seconds[i];
+        }
+
+        os << "}, \"counters\": {";
+        for (int i = 0; i < NUM_COUNTERS; ++i) {
+            os << (i == 0 ? "" : ", ") << '"' << kCOUNTER_NAMES[i] << "\": " << tick->counters[i];
+        }
+
+        os << "}, \"types\": {";
+        for (auto iter = tick->types.begin(); iter != tick->types.end(); ++iter) {
+            os << (iter == tick->types.begin() ? "" : ", ") << '"' << *iter->type
+               << "\": {\"updates\": " << iter->updates << ", \"ms\": " << 1000.0 * iter->seconds << '}';
+        }
+        os << "}}";
+    }
+
+    os << "\n]}" << std::endl;
+}
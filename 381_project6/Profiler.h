@@ -0,0 +1,154 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+
+/*
+Profiler keeps a breakdown of each of the most recent Model updates: how long each
+phase of the tick took, how many objects of each type were updated and for how long,
+and how many times the operations that tend to dominate a tick were performed.
+
+Instrumentation is only compiled in when P6_PROFILING is defined (make PROFILE=1).
+Otherwise the PROFILE_ macros below expand to nothing, nothing is ever recorded and
+the simulation pays nothing for it.
+
+Counters may be incremented concurrently, as they are during a PARALLEL tick's plan
+phase. Everything else must be called from the thread running the update.
+*/
+
+#ifdef P6_PROFILING
+constexpr bool kPROFILING_ENABLED = true;
+#else
+constexpr bool kPROFILING_ENABLED = false;
+#endif
+
+class Profiler {
+public:
+    // Parts of Model::update that are timed
+    enum Phase { MOVEMENT, PLAN, UPDATE, COMBAT, CLEANUP, NUM_PHASES };
+    // Operations that are counted
+    enum Counter {
+        AGENT_SEARCHES, STRUCTURE_SEARCHES, HITS_TAKEN, WITHDRAWALS, DEPOSITS,
+        VIEW_NOTIFICATIONS, DEAD_MEMBER_SWEEPS, AGENT_DEATHS, NUM_COUNTERS
+    };
+    enum class Format { TEXT, CSV, JSON };
+
+    // return pointer to the Profiler
+    static Profiler* get_instance();
+
+    // start and finish recording the tick that brings the Model to time,
+    // counts made between ticks are discarded
+    void begin_tick(int time);
+    void end_tick();
+
+    void add_phase_time(Phase phase, double seconds) { m_current.phase_seconds[phase] += seconds; }
+    // type must be a string that lives as long as the program, as returned by
+    // Sim_object::get_type_string
+    void add_update_time(const std::string& type, double seconds);
+    void count(Counter counter) { m_counters[counter].fetch_add(1, std::memory_order_relaxed); }
+
+    // Prints the breakdown of the most recent num_ticks ticks, oldest first
+    void print(std::ostream& os, int num_ticks, Format format) const;
+
+    // disallow copy/move construction or assignment
+    Profiler(const Profiler&) = delete;
+    Profiler& operator= (const Profiler&) = delete;
+    Profiler(Profiler&&) = delete;
+    Profiler& operator= (Profiler&&) = delete;
+
+private:
+    Profiler();
+
+    struct Type_profile {
+        const std::string* type;
+        long long          updates;
+        double             seconds;
+    };
+
+    struct Tick_profile {
+        int                       time;
+        double                    seconds;
+        double                    phase_seconds[NUM_PHASES];
+        long long                 counters[NUM_COUNTERS];
+        std::vector<Type_profile> types;
+    };
+
+    using Ticks_t = std::deque<Tick_profile>;
+
+    void print_text(std::ostream& os, Ticks_t::const_iterator first) const;
+    void print_csv(std::ostream& os, Ticks_t::const_iterator first) const;
+    void print_json(std::ostream& os, Ticks_t::const_iterator first) const;
+
+    // the most recent ticks, oldest first, and the one being recorded
+    Ticks_t                               m_ticks;
+    Tick_profile                          m_current;
+    std::chrono::steady_clock::time_point m_tick_start;
+    std::atomic<long long>                m_counters[NUM_COUNTERS];
+};
+
+// Adds the time from its construction to its destruction to a phase of the tick
+class Profile_phase_timer {
+public:
+    explicit Profile_phase_timer(Profiler::Phase phase) :
+        m_phase(phase), m_start(std::chrono::steady_clock::now())
+        {}
+    ~Profile_phase_timer() {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+        Profiler::get_instance()->add_phase_time(m_phase, elapsed.count());
+    }
+
+    // disallow copy/move construction or assignment
+    Profile_phase_timer(const Profile_phase_timer&) = delete;
+    Profile_phase_timer& operator= (const Profile_phase_timer&) = delete;
+    Profile_phase_timer(Profile_phase_timer&&) = delete;
+    Profile_phase_timer& operator= (Profile_phase_timer&&) = delete;
+
+private:
+    Profiler::Phase                       m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Adds the time from its construction to its destruction to the updates of a type
+class Profile_update_timer {
+public:
+    explicit Profile_update_timer(const std::string& type) :
+        m_type(type), m_start(std::chrono::steady_clock::now())
+        {}
+    ~Profile_update_timer() {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+        Profiler::get_instance()->add_update_time(m_type, elapsed.count());
+    }
+
+    // disallow copy/move construction or assignment
+    Profile_update_timer(const Profile_update_timer&) = delete;
+    Profile_update_timer& operator= (const Profile_update_timer&) = delete;
+    Profile_update_timer(Profile_update_timer&&) = delete;
+    Profile_update_timer& operator= (Profile_update_timer&&) = delete;
+
+private:
+    const std::string&                    m_type;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#ifdef P6_PROFILING
+#define PROFILE_BEGIN_TICK(time) Profiler::get_instance()->begin_tick(time)
+#define PROFILE_END_TICK() Profiler::get_instance()->end_tick()
+// times the rest of the enclosing scope as part of a Profiler::Phase
+#define PROFILE_PHASE(phase) Profile_phase_timer profile_phase_timer(Profiler::phase)
+// times the rest of the enclosing scope as an update of an object of type
+#define PROFILE_UPDATE(type) Profile_update_timer profile_update_timer(type)
+#define PROFILE_COUNT(counter) Profiler::get_instance()->count(Profiler::counter)
+#else
+#define PROFILE_BEGIN_TICK(time)
+#define PROFILE_END_TICK()
+#define PROFILE_PHASE(phase)
+#define PROFILE_UPDATE(type)
+#define PROFILE_COUNT(counter)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,138 @@
+#include "Render_pipeline.h"
+#include "View.h"
+#include "Worker_pool.h"
+#include <sstream>
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::size_t;
+using std::mutex; using std::unique_lock; using std::lock_guard;
+
+Render_pipeline::Render_pipeline(std::streambuf* target_, int num_threads) :
+    mp_target(target_), m_output(*this), mp_pool(new Worker_pool(num_threads)),
+    m_writing(false), m_stopping(false)
+{
+    m_writer = std::thread(&Render_pipeline::writer_loop, this);
+}
+
+Render_pipeline::~Render_pipeline() {
+    // the writer finishes what it has been handed before it stops
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_cv.notify_one();
+    m_writer.join();
+}
+
+Render_pipeline::Ordered_buffer::int_type Render_pipeline::Ordered_buffer::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        const char ch = traits_type::to_char_type(c);
+        m_pipeline.write(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize Render_pipeline::Ordered_buffer::xsputn(const char* s, std::streamsize n) {
+    m_pipeline.write(s, static_cast<size_t>(n));
+    return n;
+}
+
+int Render_pipeline::Ordered_buffer::sync() {
+    m_pipeline.sync_target();
+    return 0;
+}
+
+void Render_pipeline::write(const char* text, size_t size) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_jobs.empty() && !m_writing) {
+        mp_target->sputn(text, size);
+        return;
+    }
+
+    // the job being written is no longer queued, text after it needs a job of its own
+    if (m_jobs.empty()) {
+        m_jobs.emplace_back();
+    }
+    m_jobs.back().text.append(text, size);
+}
+
+void Render_pipeline::sync_target() {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_jobs.empty() && !m_writing) {
+        mp_target->pubsync();
+    }
+}
+
+int Render_pipeline::get_num_threads() const {
+    return mp_pool->get_num_threads();
+}
+
+// Only the writer uses the pool, and it is idle once everything is written
+void Render_pipeline::set_num_threads(int num_threads) {
+    if (num_threads == get_num_threads()) {
+        return;
+    }
+    // a count the pool rejects is rejected before waiting on the writer
+    unique_ptr<Worker_pool> new_pool(new Worker_pool(num_threads));
+    wait_until_written();
+    mp_pool.swap(new_pool);
+}
+
+void Render_pipeline::render(vector<unique_ptr<View_frame>> frames) {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_jobs.emplace_back();
+        m_jobs.back().frames = std::move(frames);
+    }
+    m_work_cv.notify_one();
+}
+
+void Render_pipeline::wait_until_written() {
+    unique_lock<mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]{ return m_jobs.empty() && !m_writing; });
+}
+
+// Writes jobs in the order they were handed over until stopped with none left
+void Render_pipeline::writer_loop() {
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [this]{ return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_writing = true;
+        lock.unlock();
+
+        write_job(job);
+
+        lock.lock();
+        m_writing = false;
+        m_done_cv.notify_all();
+    }
+}
+
+// Each frame is formatted into a text of its own, so frames can be formatted in any
+// order and on any thread
+void Render_pipeline::write_job(Job& job) {
+    const vector<unique_ptr<View_frame>>& frames = job.frames;
+    m_frame_texts.resize(frames.size());
+    mp_pool->parallel_for(frames.size(), [this, &frames](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::ostringstream text;
+            frames[i]->print(text);
+            m_frame_texts[i] = text.str();
+        }
+    });
+
+    for (size_t i = 0; i < frames.size(); ++i) {
+        mp_target->sputn(m_frame_texts[i].data(), m_frame_texts[i].size());
+    }
+    mp_target->sputn(job.text.data(), job.text.size());
+    mp_target->pubsync();
+}
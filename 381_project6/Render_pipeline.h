@@ -0,0 +1,98 @@
+#ifndef RENDER_PIPELINE_H
+#define RENDER_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <streambuf>
+#include <cstddef>
+
+class View_frame;
+class Worker_pool;
+
+/*
+Render_pipeline prints the frames captured from the Views at a show command off the
+simulation thread. A writer thread formats each show's frames across a Worker_pool,
+then writes them to the target buffer in the order they were captured, while the
+Controller goes on to the next command.
+
+Everything else bound for the target must be written through get_output() instead.
+What is written there while frames are still waiting to be printed is held back and
+written right after them, so the output comes out exactly as if every frame had been
+printed when it was captured. get_output() may be written from any thread.
+*/
+
+class Render_pipeline {
+public:
+    // Frames are written to target_ once formatted by num_threads threads, which must
+    // be at least one, throws Error if there are more than Worker_pool::get_max_threads()
+    Render_pipeline(std::streambuf* target_, int num_threads);
+    // writes out everything handed over, then stops the writer
+    ~Render_pipeline();
+
+    std::streambuf* get_target() const { return mp_target; }
+    std::streambuf* get_output() { return &m_output; }
+    int get_num_threads() const;
+    // Formats frames with num_threads threads from now on, once those handed over
+    // so far are written. Throws Error if num_threads is more than
+    // Worker_pool::get_max_threads().
+    void set_num_threads(int num_threads);
+
+    // Prints frames in the background, after everything written to get_output() so far
+    void render(std::vector<std::unique_ptr<View_frame>> frames);
+    // Returns once everything handed over has been written to the target
+    void wait_until_written();
+
+    // disallow copy/move construction or assignment
+    Render_pipeline(const Render_pipeline&) = delete;
+    Render_pipeline& operator= (const Render_pipeline&) = delete;
+    Render_pipeline(Render_pipeline&&) = delete;
+    Render_pipeline& operator= (Render_pipeline&&) = delete;
+
+private:
+    // The buffer everything else bound for the target is written to
+    class Ordered_buffer : public std::streambuf {
+    public:
+        explicit Ordered_buffer(Render_pipeline& pipeline_) : m_pipeline(pipeline_) {}
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+        int sync() override;
+    private:
+        Render_pipeline& m_pipeline;
+    };
+
+    // A show's frames and the text written after them
+    struct Job {
+        std::vector<std::unique_ptr<View_frame>> frames;
+        std::string                              text;
+    };
+
+    // write text to the target now if nothing is waiting, otherwise after what is
+    void write(const char* text, std::size_t size);
+    // flush the target if nothing is waiting, the writer flushes it after each job
+    void sync_target();
+    // loop run by the writer thread
+    void writer_loop();
+    // format job's frames into m_frame_texts, then write them and its text out
+    void write_job(Job& job);
+
+    std::streambuf*              mp_target;
+    Ordered_buffer               m_output;
+    std::unique_ptr<Worker_pool> mp_pool;
+    std::vector<std::string>     m_frame_texts; // used only by the writer
+
+    std::thread                  m_writer;
+    std::mutex                   m_mutex;
+    std::condition_variable      m_work_cv;
+    std::condition_variable      m_done_cv;
+    std::deque<Job>              m_jobs;        // waiting to be written, oldest first
+    bool                         m_writing;     // the writer is writing a job
+    bool                         m_stopping;
+};
+
+#endif // RENDER_PIPELINE_H
@@ -0,0 +1,209 @@
+#include "Scenario_generator.h"
+#include "Model.h"
+#include "Agent.h"
+#include "Structure.h"
+#include "Agent_factory.h"
+#include "Structure_factory.h"
+#include "Geometry.h"
+#include "Utility.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::mt19937;
+using std::uniform_real_distribution; using std::uniform_int_distribution;
+using std::normal_distribution;
+
+// Number of objects per cluster in the CLUSTERED layout
+constexpr int kOBJECTS_PER_CLUSTER = 200;
+// Out of every 20 Agents: 8 Peasants, 5 Soldiers, 4 Archers and 3 Mages
+constexpr int kAGENT_MIX_PERIOD = 20;
+constexpr int kPEASANTS_IN_MIX = 8;
+constexpr int kSOLDIERS_IN_MIX = 5;
+constexpr int kARCHERS_IN_MIX = 4;
+// Out of every 4 fighters, 1 moves somewhere instead of attacking
+constexpr int kFIGHTERS_PER_MOVER = 4;
+
+Scenario_settings::Layout parse_scenario_layout(const string& name) {
+    if (name == "uniform") {
+        return Scenario_settings::Layout::UNIFORM;
+    }
+    else if (name == "clustered") {
+        return Scenario_settings::Layout::CLUSTERED;
+    }
+    else if (name == "lattice") {
+        return Scenario_settings::Layout::LATTICE;
+    }
+
+    throw Error("Unknown scenario layout!");
+}
+
+const char* get_scenario_layout_name(Scenario_settings::Layout layout) {
+    switch (layout) {
+    case Scenario_settings::Layout::UNIFORM:
+        return "uniform";
+    case Scenario_settings::Layout::CLUSTERED:
+        return "clustered";
+    case Scenario_settings::Layout::LATTICE:
+        return "lattice";
+    default:
+        throw Error("Unknown scenario layout!");
+    }
+}
+
+// returns prefix followed by index padded to 7 digits
+static string make_scenario_name(char prefix, int index) {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%c%07d", prefix, index);
+    return buffer;
+}
+
+// Places objects according to the layout, the i-th call to next() returns the
+// location of the i-th object
+class Scenario_placer {
+public:
+    Scenario_placer(const Scenario_settings& settings, int num_objects, mt19937& rng)
+        : m_layout(settings.layout), m_spacing(settings.spacing), m_rng(rng),
+          m_side(settings.spacing * std::sqrt(static_cast<double>(num_objects))),
+          m_lattice_columns(static_cast<int>(std::ceil(std::sqrt(static_cast<double>(num_objects))))),
+          m_num_placed(0)
+    {
+        if (m_layout == Scenario_settings::Layout::CLUSTERED) {
+            const int num_clusters = std::max(1, num_objects / kOBJECTS_PER_CLUSTER);
+            uniform_real_distribution<double> coord(0.0, m_side);
+            for (int i = 0; i < num_clusters; ++i) {
+                const double x = coord(m_rng);
+                const double y = coord(m_rng);
+                m_cluster_centers.push_back(Point(x, y));
+            }
+        }
+    }
+
+    Point next() {
+        const int index = m_num_placed++;
+
+        switch (m_layout) {
+        case Scenario_settings::Layout::UNIFORM: {
+            uniform_real_distribution<double> coord(0.0, m_side);
+            const double x = coord(m_rng);
+            const double y = coord(m_rng);
+            return Point(x, y);
+        }
+        case Scenario_settings::Layout::CLUSTERED: {
+            uniform_int_distribution<int> which(0, static_cast<int>(m_cluster_centers.size()) - 1);
+            const Point& center = m_cluster_centers[which(m_rng)];
+            // a cluster holds its share of objects at the requested spacing
+            normal_distribution<double> offset(0.0, m_spacing * std::sqrt(kOBJECTS_PER_CLUSTER) / 4.0);
+            const double x = center.x + offset(m_rng);
+            const double y = center.y + offset(m_rng);
+            return Point(x, y);
+        }
+        case Scenario_settings::Layout::LATTICE:
+            return Point((index % m_lattice_columns) * m_spacing,
+                         (index / m_lattice_columns) * m_spacing);
+        default:
+            throw Error("Unknown scenario layout!");
+        }
+    }
+
+private:
+    Scenario_settings::Layout m_layout;
+    double                    m_spacing;
+    mt19937&                  m_rng;
+    double                    m_side;
+    int                       m_lattice_columns;
+    int                       m_num_placed;
+    vector<Point>             m_cluster_centers;
+};
+
+// returns the Agent type for the index-th Agent
+static const char* get_agent_type(int index) {
+    const int slot = index % kAGENT_MIX_PERIOD;
+    if (slot < kPEASANTS_IN_MIX) {
+        return "Peasant";
+    }
+    else if (slot < kPEASANTS_IN_MIX + kSOLDIERS_IN_MIX) {
+        return "Soldier";
+    }
+    else if (slot < kPEASANTS_IN_MIX + kSOLDIERS_IN_MIX + kARCHERS_IN_MIX) {
+        return "Archer";
+    }
+    return "Mage";
+}
+
+void generate_scenario(const Scenario_settings& settings) {
+    if (settings.num_agents < 0 || settings.num_structures < 0 || settings.spacing <= 0.0) {
+        throw Error("Invalid scenario settings!");
+    }
+
+    mt19937 rng(settings.seed);
+    Model* model_ptr = Model::get_instance();
+
+    // Agents and Structures share one layout so they are mixed together.
+    // Agents are added first, their names sort before the Structures'.
+    Scenario_placer placer(settings, settings.num_agents + settings.num_structures, rng);
+
+    vector<shared_ptr<Agent>> agents;
+    agents.reserve(settings.num_agents);
+    for (int i = 0; i < settings.num_agents; ++i) {
+        shared_ptr<Agent> agent_ptr = create_agent(make_scenario_name('a', i), get_agent_type(i),
+                                                   placer.next());
+        model_ptr->add_agent(agent_ptr);
+        agents.push_back(agent_ptr);
+    }
+
+    // Structures alternate between Farms and Town_Halls
+    vector<shared_ptr<Structure>> farms;
+    vector<shared_ptr<Structure>> town_halls;
+    for (int i = 0; i < settings.num_structures; ++i) {
+        const bool is_farm = (i % 2 == 0);
+        shared_ptr<Structure> structure_ptr = create_structure(make_scenario_name('s', i),
+            is_farm ? "Farm" : "Town_Hall", placer.next());
+        model_ptr->add_structure(structure_ptr);
+        (is_farm ? farms : town_halls).push_back(structure_ptr);
+    }
+
+    // Give the orders
+    uniform_real_distribution<double> coord(0.0, settings.spacing *
+        std::sqrt(static_cast<double>(settings.num_agents + settings.num_structures)));
+    int num_fighters = 0;
+
+    for (int i = 0; i < settings.num_agents; ++i) {
+        const shared_ptr<Agent>& agent_ptr = agents[i];
+
+        if (i % kAGENT_MIX_PERIOD < kPEASANTS_IN_MIX) {
+            if (farms.empty() || town_halls.empty()) {
+                continue;
+            }
+            uniform_int_distribution<int> which_farm(0, static_cast<int>(farms.size()) - 1);
+            uniform_int_distribution<int> which_hall(0, static_cast<int>(town_halls.size()) - 1);
+            const int farm_index = which_farm(rng);
+            const int hall_index = which_hall(rng);
+            agent_ptr->start_working(farms[farm_index], town_halls[hall_index]);
+            continue;
+        }
+
+        if (++num_fighters % kFIGHTERS_PER_MOVER == 0) {
+            const double x = coord(rng);
+            const double y = coord(rng);
+            agent_ptr->move_to(Point(x, y));
+            continue;
+        }
+
+        // The nearest Agent other than itself, it may well be out of range
+        vector<shared_ptr<Agent>> nearest = model_ptr->find_k_nearest_agents(agent_ptr->get_location(), 2);
+        for (const shared_ptr<Agent>& target_ptr : nearest) {
+            if (target_ptr != agent_ptr) {
+                agent_ptr->start_attacking(target_ptr);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SCENARIO_GENERATOR_H
+#define SCENARIO_GENERATOR_H
+
+#include <string>
+
+/*
+Scenario generation populates the Model with a large, reproducible world for
+benchmarking: Peasants, Soldiers, Archers and Mages along with Farms and Town_Halls,
+placed by a seeded random number generator, with work and attack orders already
+given. The same settings always produce the same world.
+
+Agents are named a0000000, a0000001, ... and Structures s0000000, s0000001, ...
+so that they sort after the Model's initial objects in the order they are created.
+*/
+
+struct Scenario_settings {
+    // How objects are spread over the world
+    // UNIFORM: uniformly at random over a square
+    // CLUSTERED: in normally distributed clusters of a couple hundred objects
+    // LATTICE: on a regular square lattice
+    enum class Layout { UNIFORM, CLUSTERED, LATTICE };
+
+    int      num_agents = 1000;
+    int      num_structures = 100;
+    Layout   layout = Layout::UNIFORM;
+    unsigned seed = 1;
+    // average distance between neighbouring objects, the world grows with
+    // the number of objects so that density stays the same
+    double   spacing = 3.0;
+};
+
+// returns the Layout named name, throws Error("Unknown scenario layout!") if there is none
+Scenario_settings::Layout parse_scenario_layout(const std::string& name);
+// returns the name of layout
+const char* get_scenario_layout_name(Scenario_settings::Layout layout);
+
+// Adds the scenario's Structures and Agents to the Model, then gives every Peasant
+// a work order between a Farm and a Town_Hall and has Soldiers, Archers and Mages
+// attack the nearest other Agent or move to a random place
+void generate_scenario(const Scenario_settings& settings);
+
+#endif // SCENARIO_GENERATOR_H
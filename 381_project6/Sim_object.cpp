@@ -1,12 +1,32 @@
 #include "Sim_object.h"
 #include <string>
+#include <cassert>
 
 using std::string;
 
-Sim_object::Sim_object(const string& name_) : m_name(name_)
+Sim_object::Sim_object(const string& name_) : m_name(name_), m_id(kNO_OBJECT_ID)
 {
 }
 
 Sim_object::~Sim_object()
 {
 }
+
+void Sim_object::plan_update()
+{
+}
+
+bool Sim_object::is_active() const
+{
+    return true;
+}
+
+int Sim_object::get_quiet_updates() const
+{
+    return 0;
+}
+
+void Sim_object::fast_forward(int ticks_)
+{
+    assert(ticks_ == 0);
+}
@@ -8,6 +8,9 @@
 // TODO
 #include "Utility.h"
 
+class Snapshot_writer;
+class Snapshot_reader;
+
 /* The Sim_object class provides the interface for all of simulation objects. 
 It also stores the object's name, and has pure virtual accessor functions for 
 the object's position and other information. */
@@ -19,14 +22,49 @@ public:
 
     const std::string& get_name() const noexcept { return m_name; };
 
+    // the handle the Model interned the name to, kNO_OBJECT_ID until the object
+    // is added to the Model, which is the only caller of set_id
+    Object_id_t get_id() const noexcept { return m_id; }
+    void set_id(Object_id_t id_) noexcept { m_id = id_; }
+
+    // returns the name of this object's type, the one the factories create it by
+    virtual const std::string& get_type_string() const = 0;
+
+    // write this object's state, other than its name, type and location, to a
+    // snapshot, restore_state reads back exactly what save_state wrote
+    virtual void save_state(Snapshot_writer& writer) const = 0;
+    virtual void restore_state(Snapshot_reader& reader) = 0;
+
     // ask model to notify views of current state
     virtual void broadcast_current_state() const = 0;
     virtual Point get_location() const = 0;
     virtual void describe() const = 0;
     virtual void update() = 0;
 
+    // Read-only preparation for the next update(). Called for every object before
+    // any of them are updated, possibly concurrently with other objects' plan_update,
+    // so it must only read shared state and may only write state of this object.
+    // Does nothing unless overridden.
+    virtual void plan_update();
+
+    // Returns true if the next update() would do anything. The Model stops
+    // updating an object once it returns false, until something wakes the object
+    // again (see Model::wake). Returns true unless overridden.
+    virtual bool is_active() const;
+
+    // Returns how many of the coming updates are quiet for this object: updates in
+    // which it only moves along its way or builds up a stock, without any output
+    // that matters or anything that another object could notice other than its
+    // location. The Model can do all of them at once with fast_forward().
+    // Returns 0 unless overridden.
+    virtual int get_quiet_updates() const;
+    // Do ticks_ quiet updates at once, printing nothing and notifying Views only
+    // of the final state. ticks_ must not exceed get_quiet_updates().
+    virtual void fast_forward(int ticks_);
+
 private:
     const std::string m_name;
+    Object_id_t       m_id;
 };
 
 #endif // SIM_OBJECT_H
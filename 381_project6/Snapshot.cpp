@@ -0,0 +1,273 @@
+#include "Snapshot.h"
+#include "Sim_object.h"
+#include "Utility.h"
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cstring>
+#include <cassert>
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::size_t;
+using std::int32_t; using std::uint32_t; using std::uint8_t; using std::uint64_t;
+using std::ifstream; using std::ofstream;
+
+// Identifies a snapshot file, followed by the format version
+static const char kSNAPSHOT_MAGIC[] = { 'P', '6', 'S', 'N', 'A', 'P' };
+constexpr uint32_t kSNAPSHOT_VERSION = 3;
+// Written in the writer's byte order, reads back differently on a machine
+// with another byte order
+constexpr uint32_t kSNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+// Objects refer to none with this index
+constexpr int32_t kNO_SNAPSHOT_INDEX = -1;
+
+static void throw_corrupt() {
+    throw Error("Snapshot file is corrupt!");
+}
+
+/* Snapshot_writer */
+
+Snapshot_writer::Snapshot_writer(vector<int> index_of_id)
+    : m_index_of_id(std::move(index_of_id))
+{
+}
+
+void Snapshot_writer::write_bytes(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    m_body.insert(m_body.end(), bytes, bytes + size);
+}
+
+void Snapshot_writer::write_u8(uint8_t value) {
+    m_body.push_back(static_cast<char>(value));
+}
+
+void Snapshot_writer::write_i32(int32_t value) {
+    write_bytes(&value, sizeof(value));
+}
+
+void Snapshot_writer::write_double(double value) {
+    write_bytes(&value, sizeof(value));
+}
+
+// strings are written as their length followed by their characters
+void Snapshot_writer::write_string(const string& str) {
+    write_i32(static_cast<int32_t>(str.size()));
+    write_bytes(str.data(), str.size());
+}
+
+// there are only a handful of types, so a linear search finds them fastest
+void Snapshot_writer::write_type(const string& type_name) {
+    auto iter = std::find(m_type_names.begin(), m_type_names.end(), type_name);
+    if (iter == m_type_names.end()) {
+        iter = m_type_names.insert(iter, type_name);
+    }
+
+    assert(m_type_names.size() <= 256);
+    write_u8(static_cast<uint8_t>(iter - m_type_names.begin()));
+}
+
+void Snapshot_writer::write_object_ref(const Sim_object* obj_ptr) {
+    if (!obj_ptr) {
+        write_i32(kNO_SNAPSHOT_INDEX);
+        return;
+    }
+
+    write_id_ref(obj_ptr->get_id());
+}
+
+void Snapshot_writer::write_id_ref(Object_id_t id) {
+    write_i32(get_index(id));
+}
+
+int Snapshot_writer::get_index(Object_id_t id) const {
+    assert(id >= 0 && id < static_cast<Object_id_t>(m_index_of_id.size()));
+    return m_index_of_id[id];
+}
+
+// The header is only complete once every type has been seen, so it is
+// written in front of the body here
+void Snapshot_writer::write_to_file(const string& filename) const {
+    ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw Error("Could not open file for writing!");
+    }
+
+    write(file);
+
+    if (!file.flush()) {
+        throw Error("Could not write snapshot file!");
+    }
+}
+
+void Snapshot_writer::write(std::ostream& os) const {
+    const uint32_t version = kSNAPSHOT_VERSION;
+    const uint32_t byte_order_mark = kSNAPSHOT_BYTE_ORDER_MARK;
+    os.write(kSNAPSHOT_MAGIC, sizeof(kSNAPSHOT_MAGIC));
+    os.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    os.write(reinterpret_cast<const char*>(&byte_order_mark), sizeof(byte_order_mark));
+
+    os.put(static_cast<char>(m_type_names.size()));
+    for (const string& type_name : m_type_names) {
+        os.put(static_cast<char>(type_name.size()));
+        os.write(type_name.data(), type_name.size());
+    }
+
+    os.write(m_body.data(), m_body.size());
+}
+
+// FNV-1a over the type table and the body, the rest of the header never changes
+uint64_t Snapshot_writer::hash() const {
+    uint64_t result = 14695981039346656037ull;
+    auto add_bytes = [&result](const char* bytes, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            result ^= static_cast<unsigned char>(bytes[i]);
+            result *= 1099511628211ull;
+        }
+    };
+
+    for (const string& type_name : m_type_names) {
+        const char length = static_cast<char>(type_name.size());
+        add_bytes(&length, 1);
+        add_bytes(type_name.data(), type_name.size());
+    }
+    add_bytes(m_body.data(), m_body.size());
+    return result;
+}
+
+/* Snapshot_reader */
+
+Snapshot_reader::Snapshot_reader(const string& filename) : m_pos(0)
+{
+    ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw Error("Could not open file for reading!");
+    }
+
+    // Read the whole file at once
+    const std::streamoff size = file.tellg();
+    if (size < 0) {
+        throw Error("Could not read snapshot file!");
+    }
+    m_data.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    if (!file.read(m_data.data(), size)) {
+        throw Error("Could not read snapshot file!");
+    }
+
+    read_header();
+}
+
+Snapshot_reader::Snapshot_reader(vector<char> data) : m_data(std::move(data)), m_pos(0)
+{
+    read_header();
+}
+
+void Snapshot_reader::read_header() {
+    char magic[sizeof(kSNAPSHOT_MAGIC)];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    if (m_data.size() < sizeof(magic) + sizeof(version) + sizeof(byte_order_mark)) {
+        throw Error("Not a snapshot file!");
+    }
+    read_bytes(magic, sizeof(magic));
+    read_bytes(&version, sizeof(version));
+    read_bytes(&byte_order_mark, sizeof(byte_order_mark));
+
+    if (!std::equal(std::begin(magic), std::end(magic), std::begin(kSNAPSHOT_MAGIC))) {
+        throw Error("Not a snapshot file!");
+    }
+    if (byte_order_mark != kSNAPSHOT_BYTE_ORDER_MARK) {
+        throw Error("Snapshot was saved on a machine with a different byte order!");
+    }
+    if (version != kSNAPSHOT_VERSION) {
+        throw Error("Unsupported snapshot version!");
+    }
+
+    const int num_types = read_u8();
+    for (int i = 0; i < num_types; ++i) {
+        const size_t length = read_u8();
+        if (length > m_data.size() - m_pos) {
+            throw_corrupt();
+        }
+        m_type_names.emplace_back(m_data.data() + m_pos, length);
+        m_pos += length;
+    }
+}
+
+void Snapshot_reader::read_bytes(void* data, size_t size) {
+    if (size > m_data.size() - m_pos) {
+        throw_corrupt();
+    }
+    std::memcpy(data, m_data.data() + m_pos, size);
+    m_pos += size;
+}
+
+uint8_t Snapshot_reader::read_u8() {
+    uint8_t value;
+    read_bytes(&value, sizeof(value));
+    return value;
+}
+
+int32_t Snapshot_reader::read_i32() {
+    int32_t value;
+    read_bytes(&value, sizeof(value));
+    return value;
+}
+
+double Snapshot_reader::read_double() {
+    double value;
+    read_bytes(&value, sizeof(value));
+    return value;
+}
+
+string Snapshot_reader::read_string() {
+    const size_t length = static_cast<size_t>(read_count());
+    if (length > m_data.size() - m_pos) {
+        throw_corrupt();
+    }
+
+    string str(m_data.data() + m_pos, length);
+    m_pos += length;
+    return str;
+}
+
+const string& Snapshot_reader::read_type() {
+    const size_t type_index = read_u8();
+    if (type_index >= m_type_names.size()) {
+        throw_corrupt();
+    }
+    return m_type_names[type_index];
+}
+
+int Snapshot_reader::read_count() {
+    const int32_t count = read_i32();
+    if (count < 0) {
+        throw_corrupt();
+    }
+    return count;
+}
+
+void Snapshot_reader::set_objects(vector<shared_ptr<Sim_object>> objects) {
+    m_objects = std::move(objects);
+}
+
+const shared_ptr<Sim_object>* Snapshot_reader::read_object_slot() {
+    const int32_t index = read_i32();
+    if (index == kNO_SNAPSHOT_INDEX) {
+        return nullptr;
+    }
+    if (index < 0 || static_cast<size_t>(index) >= m_objects.size()) {
+        throw_corrupt();
+    }
+    return &m_objects[index];
+}
+
+void Snapshot_reader::expect_end() const {
+    if (m_pos != m_data.size()) {
+        throw_corrupt();
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Utility.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+
+class Sim_object;
+
+/*
+A snapshot is a compact binary image of the whole simulation, written by
+Model::save and read back by Model::restore. The file starts with a header:
+the magic bytes "P6SNAP", the format version, a marker that tells whether the
+writer had the same byte order as the reader, and a table of the type names
+used by the objects. Values follow in the writer's native representation.
+
+Objects refer to each other by their index in the snapshot's object table, -1 for
+none. Every object is created before any object's state is read, so a reference
+can always be resolved.
+
+Snapshot_writer collects everything in memory and writes the file in one go,
+Snapshot_reader reads the whole file into memory before anything is decoded.
+Both throw Error if the file cannot be written or read, the reader also throws
+if the file is not a snapshot or its contents are inconsistent.
+*/
+
+class Snapshot_writer {
+public:
+    // index_of_id holds the snapshot index of each live object's id, -1 for the
+    // ids of removed objects
+    explicit Snapshot_writer(std::vector<int> index_of_id);
+
+    void write_u8(std::uint8_t value);
+    void write_i32(std::int32_t value);
+    void write_double(double value);
+    void write_string(const std::string& str);
+    // writes a type name as its index into the header's type table
+    void write_type(const std::string& type_name);
+    // writes the snapshot index of obj_ptr, -1 if it is nullptr or removed
+    void write_object_ref(const Sim_object* obj_ptr);
+    // writes the snapshot index of the object with id, -1 if it was removed
+    void write_id_ref(Object_id_t id);
+    // Returns the snapshot index of the object with id, -1 if it was removed
+    int get_index(Object_id_t id) const;
+
+    // write the header followed by everything written so far to filename
+    void write_to_file(const std::string& filename) const;
+    // write the header followed by everything written so far to os
+    void write(std::ostream& os) const;
+    // Returns a hash of what write would write, equal for equal snapshots
+    std::uint64_t hash() const;
+
+    // disallow copy/move construction or assignment
+    Snapshot_writer(const Snapshot_writer&) = delete;
+    Snapshot_writer& operator= (const Snapshot_writer&) = delete;
+    Snapshot_writer(Snapshot_writer&&) = delete;
+    Snapshot_writer& operator= (Snapshot_writer&&) = delete;
+
+private:
+    void write_bytes(const void* data, std::size_t size);
+
+    std::vector<int>         m_index_of_id;
+    std::vector<std::string> m_type_names;
+    std::vector<char>        m_body;
+};
+
+class Snapshot_reader {
+public:
+    // reads filename and checks its header
+    explicit Snapshot_reader(const std::string& filename);
+    // reads a snapshot already in memory and checks its header
+    explicit Snapshot_reader(std::vector<char> data);
+
+    std::uint8_t read_u8();
+    std::int32_t read_i32();
+    double read_double();
+    std::string read_string();
+    const std::string& read_type();
+    // reads a count of items, which cannot be negative
+    int read_count();
+
+    // the objects snapshot indices refer to, must be set before references are read
+    void set_objects(std::vector<std::shared_ptr<Sim_object>> objects);
+    const std::vector<std::shared_ptr<Sim_object>>& get_objects() const { return m_objects; }
+    // reads an object reference, empty pointer if it is -1,
+    // throws if the object is not a T
+    template <typename T>
+    std::shared_ptr<T> read_object_ref();
+
+    // throws if anything was left unread
+    void expect_end() const;
+
+    // disallow copy/move construction or assignment
+    Snapshot_reader(const Snapshot_reader&) = delete;
+    Snapshot_reader& operator= (const Snapshot_reader&) = delete;
+    Snapshot_reader(Snapshot_reader&&) = delete;
+    Snapshot_reader& operator= (Snapshot_reader&&) = delete;
+
+private:
+    // read and check the header, and read the type table
+    void read_header();
+    void read_bytes(void* data, std::size_t size);
+    // returns the object at the index read next, nullptr if the index is -1
+    const std::shared_ptr<Sim_object>* read_object_slot();
+
+    std::vector<char>                        m_data;
+    std::size_t                              m_pos;
+    std::vector<std::string>                 m_type_names;
+    std::vector<std::shared_ptr<Sim_object>> m_objects;
+};
+
+template <typename T>
+std::shared_ptr<T> Snapshot_reader::read_object_ref() {
+    const std::shared_ptr<Sim_object>* slot = read_object_slot();
+    if (!slot) {
+        return std::shared_ptr<T>();
+    }
+
+    std::shared_ptr<T> obj_ptr = std::dynamic_pointer_cast<T>(*slot);
+    if (!obj_ptr) {
+        throw Error("Snapshot file is corrupt!");
+    }
+    return obj_ptr;
+}
+
+#endif // SNAPSHOT_H
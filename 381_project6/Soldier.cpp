@@ -5,9 +5,10 @@
 
 // TODO
 #include "Utility.h"
+#include "Event_log.h"
 
 using std::string;
-using std::cout; using std::endl;
+using std::endl;
 using std::shared_ptr; using std::static_pointer_cast;
 
 // Initial attribute values for Soldier class
@@ -30,7 +31,7 @@ void Soldier::do_update() {
     // Infantry is attacking
     // if target is dead, report it, stop attacking and forget target
     if (!is_target_alive()) {
-        cout << get_name() << ": Target is dead" << endl;
+        LOG_EVENT(COMBAT, INFO) << get_name() << ": Target is dead" << endl;
         stop_attacking();
         return;
     }
@@ -44,15 +45,8 @@ void Soldier::do_update() {
     }
 
     // target is in range, aim to maim!
-    cout << get_name() << ": Clang!" << endl;
-    shared_ptr<Agent> this_ptr = static_pointer_cast<Agent>(shared_from_this());
-    get_target().lock()->take_hit(kSOLDIER_INITIAL_STRENGTH, this_ptr);
-
-    // If Infantry killed the target, report it, stop attacking and forget target
-    if (!is_target_alive()) {
-        cout << get_name() << ": I triumph!" << endl;
-        stop_attacking();
-    }
+    LOG_EVENT(COMBAT, INFO) << get_name() << ": Clang!" << endl;
+    hit_target(kSOLDIER_INITIAL_STRENGTH);
 }
 
 // Overrides Agent's take_hit to counterattack when attacked.
@@ -0,0 +1,400 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "Geometry.h"
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <climits>
+#include <cassert>
+
+/*
+Spatial_grid is a uniform grid spatial index over named objects that have a location.
+The plane is divided into square cells of a fixed size and every object is filed under
+the cell that contains its location. Only occupied cells are stored so the indexed area
+is unbounded. Queries visit the cells nearest the query point first, so their cost is
+proportional to the density of objects around that point rather than the total number
+of objects in the grid. A query measures its distance to all the objects of a cell at
+once with the batch operations in Geometry.h. Every distance a query ranks or compares
+comes from batch_distances, however crowded the cell, so ties are resolved the same way
+whatever the cell sizes.
+
+Objects that are at equal distances from a query point are ordered by name so that
+query results are deterministic. T must provide get_name().
+*/
+
+template <typename T>
+class Spatial_grid {
+public:
+    using Ptr_t = std::shared_ptr<T>;
+
+    explicit Spatial_grid(double cell_size_);
+
+    // add an object at location, the object must not already be in the grid
+    void insert(const Ptr_t& obj_ptr, const Point& location);
+    // record that an object has moved to location, the object must be in the grid
+    // returns false if the object was already recorded at location
+    bool move(const T* obj_ptr, const Point& location);
+    // remove an object from the grid, the object must be in the grid
+    void remove(const T* obj_ptr);
+    // remove all objects from the grid
+    void clear();
+
+    // returns the number of objects in the grid
+    std::size_t size() const noexcept { return m_cell_of_obj.size(); }
+
+    // Fills result with all objects within radius of center, sorted by
+    // distance from center then by name.
+    void query_radius(const Point& center, double radius, std::vector<Ptr_t>& result) const;
+
+    // Fills result with the (at most) k objects nearest to center that satisfy pred,
+    // sorted by distance from center then by name.
+    template <typename Pred>
+    void query_k_nearest(const Point& center, std::size_t k, Pred pred,
+                         std::vector<Ptr_t>& result) const;
+
+    // Returns the object nearest to center that satisfies pred, empty pointer if none
+    template <typename Pred>
+    Ptr_t find_nearest(const Point& center, Pred pred) const;
+
+private:
+    using Cell_key_t = std::uint64_t;
+
+    struct Entry {
+        Ptr_t ptr;
+        Point location;
+    };
+    // The entries of a cell are read by the batch operations as strided coordinates
+    static constexpr std::size_t kENTRY_STRIDE = sizeof(Entry) / sizeof(double);
+    static_assert(sizeof(Entry) % sizeof(double) == 0, "Entries must hold whole doubles");
+
+    // An object found by a query along with its distance from the query point
+    struct Candidate {
+        double distance;
+        const Entry* entry;
+    };
+
+    using Cell_t = std::vector<Entry>;
+    using Cells_t = std::unordered_map<Cell_key_t, Cell_t>;
+
+    // Candidates are ordered by distance, ties resolved with name comparison
+    static bool candidate_less(const Candidate& lhs, const Candidate& rhs) {
+        if (lhs.distance == rhs.distance) {
+            return lhs.entry->ptr->get_name() < rhs.entry->ptr->get_name();
+        }
+        return lhs.distance < rhs.distance;
+    }
+
+    // Cell coordinates are clamped to half the int range before they are converted,
+    // a distant location would overflow an int and scans must be able to step past them.
+    // Every location beyond the limit is filed under the outermost cell.
+    int cell_coord(double coord) const {
+        const double limit = INT_MAX / 2;
+        const double cell = std::floor(coord / m_cell_size);
+        return static_cast<int>(std::max(-limit, std::min(cell, limit)));
+    }
+
+    static Cell_key_t make_key(int cx, int cy) {
+        return (static_cast<Cell_key_t>(static_cast<std::uint32_t>(cx)) << 32) |
+               static_cast<std::uint32_t>(cy);
+    }
+
+    Cell_key_t key_for(const Point& location) const {
+        return make_key(cell_coord(location.x), cell_coord(location.y));
+    }
+
+    static int key_x(Cell_key_t key) {
+        return static_cast<int>(static_cast<std::uint32_t>(key >> 32));
+    }
+
+    static int key_y(Cell_key_t key) {
+        return static_cast<int>(static_cast<std::uint32_t>(key));
+    }
+
+    // removes obj_ptr's entry from the cell with key, erasing the cell if it becomes empty
+    void remove_from_cell(Cell_key_t key, const T* obj_ptr);
+
+    // Offer every entry of the cell that satisfies pred to the k best candidates,
+    // distances is where the distances to the cell's entries are computed
+    template <typename Pred>
+    void scan_cell(const Cell_t& cell, const Point& center, std::size_t k, Pred& pred,
+                   std::vector<Candidate>& best, std::vector<double>& distances) const;
+
+    double           m_cell_size;
+    Cells_t          m_cells;
+    std::unordered_map<const T*, Cell_key_t> m_cell_of_obj;
+};
+
+template <typename T>
+Spatial_grid<T>::Spatial_grid(double cell_size_) : m_cell_size(cell_size_)
+{
+    assert(m_cell_size > 0.0);
+}
+
+template <typename T>
+void Spatial_grid<T>::insert(const Ptr_t& obj_ptr, const Point& location) {
+    assert(obj_ptr);
+    Cell_key_t key = key_for(location);
+
+    bool was_inserted = m_cell_of_obj.insert(std::make_pair(obj_ptr.get(), key)).second;
+    assert(was_inserted);
+    (void)was_inserted;
+
+    m_cells[key].push_back(Entry{ obj_ptr, location });
+}
+
+template <typename T>
+bool Spatial_grid<T>::move(const T* obj_ptr, const Point& location) {
+    auto obj_iter = m_cell_of_obj.find(obj_ptr);
+    assert(obj_iter != m_cell_of_obj.end());
+
+    const Cell_key_t old_key = obj_iter->second;
+    const Cell_key_t new_key = key_for(location);
+    Cell_t& old_cell = m_cells[old_key];
+
+    auto entry_iter = std::find_if(old_cell.begin(), old_cell.end(),
+        [obj_ptr](const Entry& e){ return e.ptr.get() == obj_ptr; });
+    assert(entry_iter != old_cell.end());
+
+    // Still in the same cell, only the location changes
+    if (old_key == new_key) {
+        const bool has_moved = entry_iter->location.x != location.x ||
+                               entry_iter->location.y != location.y;
+        entry_iter->location = location;
+        return has_moved;
+    }
+
+    // Refile the object under its new cell
+    Ptr_t moved_ptr = std::move(entry_iter->ptr);
+    *entry_iter = std::move(old_cell.back());
+    old_cell.pop_back();
+    if (old_cell.empty()) {
+        m_cells.erase(old_key);
+    }
+
+    m_cells[new_key].push_back(Entry{ std::move(moved_ptr), location });
+    obj_iter->second = new_key;
+    return true;
+}
+
+template <typename T>
+void Spatial_grid<T>::remove(const T* obj_ptr) {
+    auto obj_iter = m_cell_of_obj.find(obj_ptr);
+    assert(obj_iter != m_cell_of_obj.end());
+
+    remove_from_cell(obj_iter->second, obj_ptr);
+    m_cell_of_obj.erase(obj_iter);
+}
+
+template <typename T>
+void Spatial_grid<T>::remove_from_cell(Cell_key_t key, const T* obj_ptr) {
+    auto cell_iter = m_cells.find(key);
+    assert(cell_iter != m_cells.end());
+    Cell_t& cell = cell_iter->second;
+
+    auto entry_iter = std::find_if(cell.begin(), cell.end(),
+        [obj_ptr](const Entry& e){ return e.ptr.get() == obj_ptr; });
+    assert(entry_iter != cell.end());
+
+    // Order within a cell is irrelevant, swap with the last entry and pop
+    *entry_iter = std::move(cell.back());
+    cell.pop_back();
+
+    if (cell.empty()) {
+        m_cells.erase(cell_iter);
+    }
+}
+
+template <typename T>
+void Spatial_grid<T>::clear() {
+    m_cells.clear();
+    m_cell_of_obj.clear();
+}
+
+template <typename T>
+void Spatial_grid<T>::query_radius(const Point& center, double radius,
+                                   std::vector<Ptr_t>& result) const
+{
+    result.clear();
+    std::vector<Candidate> found;
+    std::vector<double> distances;
+
+    // The distances to all of a cell's entries are measured at once
+    auto scan = [&center, radius, &found, &distances](const Cell_t& cell) {
+        distances.resize(cell.size());
+        batch_distances(center, &cell.front().location.x, &cell.front().location.y,
+                        cell.size(), distances.data(), kENTRY_STRIDE);
+        for (std::size_t i = 0; i < cell.size(); ++i) {
+            if (distances[i] <= radius) {
+                found.push_back(Candidate{ distances[i], &cell[i] });
+            }
+        }
+    };
+
+    const int min_cx = cell_coord(center.x - radius);
+    const int max_cx = cell_coord(center.x + radius);
+    const int min_cy = cell_coord(center.y - radius);
+    const int max_cy = cell_coord(center.y + radius);
+    const double cells_in_box = (static_cast<double>(max_cx) - min_cx + 1.0) *
+                                (static_cast<double>(max_cy) - min_cy + 1.0);
+
+    // Visit whichever is fewer, the cells covering the search box or the occupied cells
+    if (cells_in_box <= static_cast<double>(m_cells.size())) {
+        for (int cx = min_cx; cx <= max_cx; ++cx) {
+            for (int cy = min_cy; cy <= max_cy; ++cy) {
+                auto cell_iter = m_cells.find(make_key(cx, cy));
+                if (cell_iter != m_cells.end()) {
+                    scan(cell_iter->second);
+                }
+            }
+        }
+    }
+    else {
+        for (auto& cell_pair : m_cells) {
+            scan(cell_pair.second);
+        }
+    }
+
+    std::sort(found.begin(), found.end(), candidate_less);
+
+    result.reserve(found.size());
+    for (const Candidate& c : found) {
+        result.push_back(c.entry->ptr);
+    }
+}
+
+template <typename T>
+template <typename Pred>
+void Spatial_grid<T>::scan_cell(const Cell_t& cell, const Point& center, std::size_t k,
+                                Pred& pred, std::vector<Candidate>& best,
+                                std::vector<double>& distances) const
+{
+    distances.resize(cell.size());
+    batch_distances(center, &cell.front().location.x, &cell.front().location.y,
+                    cell.size(), distances.data(), kENTRY_STRIDE);
+
+    // Nothing in the cell can make it into the k best if its nearest entry cannot
+    if (best.size() == k) {
+        const std::size_t nearest = batch_arg_min(distances.data(), distances.size());
+        if (nearest == distances.size() || best.back().distance < distances[nearest]) {
+            return;
+        }
+    }
+
+    for (std::size_t i = 0; i < cell.size(); ++i) {
+        const Entry& e = cell[i];
+        Candidate c{ distances[i], &e };
+
+        // Skip anything that cannot make it into the k best
+        if (best.size() == k && !candidate_less(c, best.back())) {
+            continue;
+        }
+
+        if (!pred(e.ptr)) {
+            continue;
+        }
+
+        // best is kept sorted, insert c at its place and drop the worst if over k
+        best.insert(std::upper_bound(best.begin(), best.end(), c, candidate_less), c);
+        if (best.size() > k) {
+            best.pop_back();
+        }
+    }
+}
+
+template <typename T>
+template <typename Pred>
+void Spatial_grid<T>::query_k_nearest(const Point& center, std::size_t k, Pred pred,
+                                      std::vector<Ptr_t>& result) const
+{
+    result.clear();
+    if (k == 0 || m_cells.empty()) {
+        return;
+    }
+
+    std::vector<Candidate> best;
+    std::vector<double> distances;
+    const int cx = cell_coord(center.x);
+    const int cy = cell_coord(center.y);
+
+    // Search rings of cells around the center cell, ring r is the set of cells
+    // whose Chebyshev distance from the center cell is exactly r
+    std::size_t cells_visited = 0;
+    for (int r = 0; cells_visited < m_cells.size(); ++r) {
+        if (r > 0 && best.size() == k) {
+            // Everything not yet visited lies outside the square covered by rings
+            // 0 .. r - 1, stop if the worst of the k best is nearer than that square's edge
+            const double left = center.x - static_cast<double>(cx - (r - 1)) * m_cell_size;
+            const double right = static_cast<double>(cx + r) * m_cell_size - center.x;
+            const double bottom = center.y - static_cast<double>(cy - (r - 1)) * m_cell_size;
+            const double top = static_cast<double>(cy + r) * m_cell_size - center.y;
+            const double edge_distance = std::min(std::min(left, right), std::min(bottom, top));
+
+            if (best.back().distance < edge_distance) {
+                break;
+            }
+        }
+
+        // When the ring holds more cells than are occupied, finish by visiting the
+        // remaining occupied cells directly rather than walking empty space
+        const double ring_cells = (r == 0) ? 1.0 : 8.0 * r;
+        if (ring_cells > static_cast<double>(m_cells.size())) {
+            for (auto& cell_pair : m_cells) {
+                const int dx = std::abs(key_x(cell_pair.first) - cx);
+                const int dy = std::abs(key_y(cell_pair.first) - cy);
+                if (std::max(dx, dy) >= r) {
+                    scan_cell(cell_pair.second, center, k, pred, best, distances);
+                }
+            }
+            break;
+        }
+
+        auto visit = [&](int x, int y) {
+            auto cell_iter = m_cells.find(make_key(x, y));
+            if (cell_iter != m_cells.end()) {
+                ++cells_visited;
+                scan_cell(cell_iter->second, center, k, pred, best, distances);
+            }
+        };
+
+        if (r == 0) {
+            visit(cx, cy);
+            continue;
+        }
+
+        for (int x = cx - r; x <= cx + r; ++x) {
+            visit(x, cy - r);
+            visit(x, cy + r);
+        }
+        for (int y = cy - r + 1; y <= cy + r - 1; ++y) {
+            visit(cx - r, y);
+            visit(cx + r, y);
+        }
+    }
+
+    result.reserve(best.size());
+    for (const Candidate& c : best) {
+        result.push_back(c.entry->ptr);
+    }
+}
+
+template <typename T>
+template <typename Pred>
+typename Spatial_grid<T>::Ptr_t Spatial_grid<T>::find_nearest(const Point& center,
+                                                              Pred pred) const
+{
+    std::vector<Ptr_t> result;
+    query_k_nearest(center, 1, pred, result);
+
+    if (result.empty()) {
+        return Ptr_t();
+    }
+
+    return result.front();
+}
+
+#endif // SPATIAL_GRID_H
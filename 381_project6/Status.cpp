@@ -1,11 +1,56 @@
 #include "Status.h"
+#include "Utility.h"
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+#include <iterator>
 
 using std::string;
-using std::cout; using std::endl;
+using std::vector;
+using std::ostream; using std::ostringstream; using std::endl;
+using std::unique_ptr;
 
+namespace {
+    // The header and the name and value of every object shown, in the order shown
+    class Status_frame : public View_frame {
+    public:
+        struct Row {
+            string name;
+            double value;
+        };
 
-Status::Status(const string& name) : View(name)
+        Status_frame(const string& header_, vector<Row>&& rows_) :
+            m_header(header_), m_rows(std::move(rows_)) {}
+
+        void print(ostream& os) const override;
+
+    private:
+        string      m_header;
+        vector<Row> m_rows;
+    };
+}
+
+// Print the rows the way Status::do_draw_body does
+void Status_frame::print(ostream& os) const {
+    const std::ios::fmtflags old_flags = os.flags();
+    const std::streamsize old_precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+
+    os << m_header;
+    for (const Row& row : m_rows) {
+        os << row.name << ": " << row.value << endl;
+    }
+    os << "--------------" << endl;
+
+    os.flags(old_flags);
+    os.precision(old_precision);
+}
+
+
+Status::Status(const string& name) :
+    View(name), m_draw_order_is_stale(false),
+    m_rank_mode(Rank_mode::ALL), m_rank_count(0), m_rank_threshold(0.0)
 {
 }
 
@@ -13,41 +58,211 @@ Status::~Status()
 {
 }
 
-// if it exists, remove the object that has name from this Status 
-void Status::update_remove(const string& name) {
-    auto iter = m_objects.find(name);
-
-    // Do nothing if name not found
-    if (iter == m_objects.end()) {
+// if it exists, remove the object that has id from this Status 
+void Status::update_remove(Object_id_t id) {
+    // Do nothing if id not found
+    if (id >= static_cast<Object_id_t>(m_objects.size()) || !m_objects[id].is_present) {
         return;
     }
 
     // Remove found object
-    m_objects.erase(iter);
+    m_objects[id].is_present = false;
+    m_draw_order_is_stale = true;
+    if (m_rank_mode != Rank_mode::ALL) {
+        m_ranked.erase(std::make_pair(m_objects[id].value, id));
+    }
 }
 
 void Status::clear() {
     m_objects.clear();
+    m_draw_order.clear();
+    m_draw_order_is_stale = false;
+    m_ranked.clear();
+}
+
+void Status::show_all() {
+    set_rank_mode(Rank_mode::ALL);
 }
 
-// Print object names followed by their associated status value
-void Status::do_draw_body() {
-    for (auto& obj : m_objects) {
-        cout << obj.first << ": " << obj.second << endl;
+void Status::show_lowest(int count) {
+    if (count <= 0) {
+        throw Error("Count must be positive!");
     }
-    cout << "--------------" << endl;
+    set_rank_mode(Rank_mode::LOWEST);
+    m_rank_count = count;
+}
+
+void Status::show_highest(int count) {
+    if (count <= 0) {
+        throw Error("Count must be positive!");
+    }
+    set_rank_mode(Rank_mode::HIGHEST);
+    m_rank_count = count;
+}
+
+void Status::show_below(double threshold) {
+    set_rank_mode(Rank_mode::BELOW);
+    m_rank_threshold = threshold;
+}
+
+void Status::show_above(double threshold) {
+    set_rank_mode(Rank_mode::ABOVE);
+    m_rank_threshold = threshold;
+}
+
+// The objects are only ordered by value while they are ranked
+void Status::set_rank_mode(Rank_mode mode) {
+    if (mode == Rank_mode::ALL) {
+        m_ranked.clear();
+    }
+    else if (m_rank_mode == Rank_mode::ALL) {
+        for (Object_id_t id = 0; id < static_cast<Object_id_t>(m_objects.size()); ++id) {
+            if (m_objects[id].is_present) {
+                m_ranked.emplace_hint(m_ranked.end(), m_objects[id].value, id);
+            }
+        }
+    }
+    m_rank_mode = mode;
+}
+
+// bring the name order of the present objects up to date
+void Status::update_draw_order() {
+    if (!m_draw_order_is_stale) {
+        return;
+    }
+
+    m_draw_order.clear();
+    for (Object_id_t id = 0; id < static_cast<Object_id_t>(m_objects.size()); ++id) {
+        if (m_objects[id].is_present) {
+            m_draw_order.push_back(id);
+        }
+    }
+
+    sort_by_object_name(m_draw_order);
+    m_draw_order_is_stale = false;
+}
+
+// Walking the ranked objects from either end only visits those that are shown
+const vector<Object_id_t>& Status::get_shown_ids() {
+    switch (m_rank_mode) {
+    case Rank_mode::ALL:
+        update_draw_order();
+        return m_draw_order;
+    case Rank_mode::LOWEST:
+    case Rank_mode::BELOW: {
+        m_ranked_ids.clear();
+        for (auto iter = m_ranked.begin(); iter != m_ranked.end(); ++iter) {
+            if (m_rank_mode == Rank_mode::LOWEST ?
+                static_cast<int>(m_ranked_ids.size()) == m_rank_count :
+                iter->first >= m_rank_threshold) {
+                break;
+            }
+            m_ranked_ids.push_back(iter->second);
+        }
+        return m_ranked_ids;
+    }
+    case Rank_mode::HIGHEST:
+    case Rank_mode::ABOVE: {
+        // walked down one run of equal values at a time, each run in id order
+        m_ranked_ids.clear();
+        auto run_end = m_ranked.end();
+        while (run_end != m_ranked.begin()) {
+            const double value = std::prev(run_end)->first;
+            if (m_rank_mode == Rank_mode::ABOVE && value <= m_rank_threshold) {
+                break;
+            }
+            auto run_begin = m_ranked.lower_bound(std::make_pair(value, kNO_OBJECT_ID));
+            for (auto iter = run_begin; iter != run_end; ++iter) {
+                if (m_rank_mode == Rank_mode::HIGHEST &&
+                    static_cast<int>(m_ranked_ids.size()) == m_rank_count) {
+                    return m_ranked_ids;
+                }
+                m_ranked_ids.push_back(iter->second);
+            }
+            run_end = run_begin;
+        }
+        return m_ranked_ids;
+    }
+    default:
+        throw Error("Unrecognized rank mode in Status::get_shown_ids");
+    }
+}
+
+// e.g. "Lowest 10 of 250:" or "Below 5.00, 3 of 250:"
+void Status::print_rank_line(ostream& os, std::size_t num_shown) const {
+    switch (m_rank_mode) {
+    case Rank_mode::ALL:
+        return;
+    case Rank_mode::LOWEST:
+        os << "Lowest ";
+        break;
+    case Rank_mode::HIGHEST:
+        os << "Highest ";
+        break;
+    case Rank_mode::BELOW:
+        os << "Below " << m_rank_threshold << ", ";
+        break;
+    case Rank_mode::ABOVE:
+        os << "Above " << m_rank_threshold << ", ";
+        break;
+    }
+    os << num_shown << " of " << m_ranked.size() << ":" << endl;
+}
+
+// Print object names followed by their associated status value, in name order or
+// ranked by value
+void Status::do_draw_body(ostream& os) {
+    const vector<Object_id_t>& shown_ids = get_shown_ids();
+
+    print_rank_line(os, shown_ids.size());
+    for (Object_id_t id : shown_ids) {
+        os << get_object_name(id) << ": " << m_objects[id].value << endl;
+    }
+    os << "--------------" << endl;
+}
+
+// The header is short and printed right away, the values are copied as they are
+unique_ptr<View_frame> Status::capture() {
+    const vector<Object_id_t>& shown_ids = get_shown_ids();
+
+    ostringstream header;
+    header << std::fixed << std::setprecision(2);
+    do_draw_header(header);
+    print_rank_line(header, shown_ids.size());
+
+    vector<Status_frame::Row> rows;
+    rows.reserve(shown_ids.size());
+    for (Object_id_t id : shown_ids) {
+        rows.push_back(Status_frame::Row{ get_object_name(id), m_objects[id].value });
+    }
+
+    return unique_ptr<View_frame>(new Status_frame(header.str(), std::move(rows)));
 }
 
 // update the status value of an object, if that object is not currently
 // contained in this Status then add it.
-void Status::update_status(const string& name, double val) {
-    auto obj_iter = m_objects.find(name);
+void Status::update_status(Object_id_t id, double val) {
+    if (id >= static_cast<Object_id_t>(m_objects.size())) {
+        m_objects.resize(id + 1, Status_object{ 0.0, false });
+    }
 
-    if (obj_iter == m_objects.end()) {
-        m_objects[name] = val;
+    Status_object& obj = m_objects[id];
+    if (m_rank_mode != Rank_mode::ALL) {
+        // the ranked set is ordered by value then id, an object whose value changed
+        // is taken out and put back in at its new place
+        if (obj.is_present) {
+            if (obj.value == val) {
+                return;
+            }
+            m_ranked.erase(std::make_pair(obj.value, id));
+        }
+        m_ranked.emplace(val, id);
     }
-    else {
-        obj_iter->second = val;
+
+    if (!obj.is_present) {
+        obj.is_present = true;
+        m_draw_order_is_stale = true;
     }
+    obj.value = val;
 }
 
@@ -2,36 +2,89 @@
 #define STATUS_H
 
 #include "View.h"
+#include <vector>
+#include <set>
+#include <utility>
+#include <cstddef>
 
 
 /*
     Status is an abstract base class of Views that can display numerical information
     related to an object.
+
+    By default every object is shown, in name order. A Status can instead rank the
+    objects by value and show only the few with the lowest or highest values, or
+    those with values below or above a threshold. While it does, the objects are kept
+    ordered by value as their values change, at O(log n) per change, so that showing
+    m of them costs O(m) however many there are. Objects with equal values are shown
+    in the order they were added to the world, for the lowest and the highest alike.
 */
 class Status : public View {
 public:
     // Make Status an abstract class
     virtual ~Status() = 0;
 
-    // Remove named object from Status objects container
-    void update_remove(const std::string& name) override;
+    // Remove object with id from Status objects container
+    void update_remove(Object_id_t id) override;
     // Remove all objects
     void clear() override;
 
+    // Copies the names and values of the objects, which are formatted when the frame
+    // is printed
+    std::unique_ptr<View_frame> capture() override;
+
+    // Show every object in name order
+    void show_all();
+    // Show the count objects with the lowest or highest values, lowest or highest
+    // first. Throws Error if count is not positive.
+    void show_lowest(int count);
+    void show_highest(int count);
+    // Show the objects with values below or above threshold, lowest or highest first
+    void show_below(double threshold);
+    void show_above(double threshold);
+
 protected:
     Status(const std::string& name);
 
-    // Updates an objects status value, adds object name to container if the
+    // Updates an objects status value, adds object id to container if the
     // object is not already there.
-    void update_status(const std::string& name, double val);
+    void update_status(Object_id_t id, double val);
 
 private:
-    using Status_objects_t = std::map<std::string, double>;
+    // Status value of an object, indexed by the object's id
+    struct Status_object {
+        double value;
+        bool   is_present;
+    };
+    using Status_objects_t = std::vector<Status_object>;
+
+    // Which objects are shown, see the show functions
+    enum class Rank_mode { ALL, LOWEST, HIGHEST, BELOW, ABOVE };
+    using Ranked_t = std::set<std::pair<double, Object_id_t>>;
 
     // Hook for drawing
-    void do_draw_body() override;
+    void do_draw_body(std::ostream& os) override;
+    // bring m_draw_order up to date
+    void update_draw_order();
+    // Returns the ids of the objects to show, in the order they are shown
+    const std::vector<Object_id_t>& get_shown_ids();
+    // print the line that says which objects are ranked, if they are
+    void print_rank_line(std::ostream& os, std::size_t num_shown) const;
+    // rank the objects as mode says, ordering them by value if they were not already
+    void set_rank_mode(Rank_mode mode);
+
+    Status_objects_t         m_objects;
+    // ids of the present objects in name order, rebuilt when objects are added or removed
+    std::vector<Object_id_t> m_draw_order;
+    bool                     m_draw_order_is_stale;
 
-    Status_objects_t m_objects;
+    Rank_mode                m_rank_mode;
+    int                      m_rank_count;
+    double                   m_rank_threshold;
+    // every present object by value, kept only while ranking
+    Ranked_t                 m_ranked;
+    // the ids of the ranked objects last shown
+    std::vector<Object_id_t> m_ranked_ids;
 };
 
 #endif // STATUS_H
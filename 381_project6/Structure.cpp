@@ -28,7 +28,7 @@ void Structure::describe() const {
 
 // ask model to notify views of current state
 void Structure::broadcast_current_state() const {
-    Model::get_instance()->notify_location(get_name(), get_location());
+    Model::get_instance()->notify_location(get_id(), get_location());
 }
 
 double Structure::withdraw(double amount_to_get) {
@@ -38,3 +38,21 @@ double Structure::withdraw(double amount_to_get) {
 void Structure::deposit(double amount_to_give)
 {
 }
+
+double Structure::get_available_amount() const
+{
+    return 0.0;
+}
+
+double Structure::get_production_rate() const
+{
+    return 0.0;
+}
+
+void Structure::save_state(Snapshot_writer& writer) const
+{
+}
+
+void Structure::restore_state(Snapshot_reader& reader)
+{
+}
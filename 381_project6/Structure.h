@@ -16,6 +16,8 @@ public:
     Point get_location() const override { return m_location; }
 
     void update() override;
+    // a Structure does nothing on update unless a derived class says otherwise
+    bool is_active() const override { return false; }
 
     // output information about the current state
     void describe() const override;
@@ -23,9 +25,17 @@ public:
     // ask model to notify views of current state
     void broadcast_current_state() const override;
 
+    // a Structure's only state is its location, which is not part of the
+    // state saved to a snapshot, derived classes add their own
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // fat interface for derived types
     virtual double withdraw(double amount_to_get);
     virtual void deposit(double amount_to_give);
+    // the most a withdraw could return right now, and the food added each update
+    virtual double get_available_amount() const;
+    virtual double get_production_rate() const;
 
 private:
     Point m_location;
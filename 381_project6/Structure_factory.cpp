@@ -4,21 +4,23 @@
 #include "Farm.h"
 #include "Geometry.h"
 #include "Utility.h"
+#include "Pool_allocator.h"
 #include <string>
 #include <memory>
 
 using std::string;
-using std::shared_ptr; using std::make_shared;
+using std::shared_ptr; using std::allocate_shared;
 
 shared_ptr<Structure> create_structure(const string& name, const string& type, Point location) {
     shared_ptr<Structure> new_structure_ptr;
 
-    // Determine what type of Structure to create, throw Error if no such type
+    // Determine what type of Structure to create, throw Error if no such type;
+    // each type is allocated together with its control block from a pool of its own
     if (type == "Farm") {
-        new_structure_ptr = make_shared<Farm>(name, location);
+        new_structure_ptr = allocate_shared<Farm>(Pool_allocator<Farm>(), name, location);
     }
     else if (type == "Town_Hall") {
-        new_structure_ptr = make_shared<Town_Hall>(name, location);
+        new_structure_ptr = allocate_shared<Town_Hall>(Pool_allocator<Town_Hall>(), name, location);
     }
     else {
         throw Error("Trying to create structure of unknown type!");
@@ -0,0 +1,202 @@
+#include "Telemetry.h"
+#include "Model.h"
+#include "Utility.h"
+#include <ostream>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+
+using std::string;
+using std::vector;
+using std::ostream; using std::endl;
+using std::uint8_t; using std::int32_t; using std::uint32_t;
+using std::mutex; using std::unique_lock; using std::lock_guard;
+
+// Identifies a telemetry file, followed by the format version
+static const char kTELEMETRY_MAGIC[] = { 'P', '6', 'T', 'E', 'L', 'E' };
+constexpr uint32_t kTELEMETRY_VERSION = 1;
+// Written in the writer's byte order, as in a snapshot
+constexpr uint32_t kTELEMETRY_BYTE_ORDER_MARK = 0x01020304;
+// Tags of the records
+constexpr uint8_t kNAMES_RECORD = 1;
+constexpr uint8_t kCHANGES_RECORD = 2;
+constexpr uint8_t kCLEAR_RECORD = 3;
+// The buffer is handed to the writer once it holds this many bytes
+constexpr std::size_t kHAND_OVER_SIZE = 1 << 18;
+
+Telemetry::Telemetry(const string& filename) :
+    View("telemetry"), m_filename(filename),
+    m_file(filename, std::ios::binary | std::ios::trunc),
+    m_num_changes(0), m_num_named_ids(0), m_write_failed(false), m_stopping(false)
+{
+    if (!m_file) {
+        throw Error("Could not open file for writing!");
+    }
+
+    m_file.write(kTELEMETRY_MAGIC, sizeof(kTELEMETRY_MAGIC));
+    m_file.write(reinterpret_cast<const char*>(&kTELEMETRY_VERSION), sizeof(kTELEMETRY_VERSION));
+    m_file.write(reinterpret_cast<const char*>(&kTELEMETRY_BYTE_ORDER_MARK),
+                 sizeof(kTELEMETRY_BYTE_ORDER_MARK));
+    if (!m_file.flush()) {
+        throw Error("Could not write telemetry file!");
+    }
+
+    m_writer = std::thread(&Telemetry::writer_loop, this);
+}
+
+Telemetry::~Telemetry() {
+    hand_over();
+
+    // the writer finishes what it has been handed before it stops
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_cv.notify_one();
+    m_writer.join();
+}
+
+template <typename T>
+void Telemetry::append(const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(value));
+}
+
+template <typename T>
+void Telemetry::append(const vector<T>& values) {
+    const char* bytes = reinterpret_cast<const char*>(values.data());
+    m_buffer.insert(m_buffer.end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+void Telemetry::begin_record(uint8_t tag) {
+    append(tag);
+    append(static_cast<int32_t>(Model::get_instance()->get_time()));
+}
+
+void Telemetry::record_names(Object_id_t past_last_id) {
+    begin_record(kNAMES_RECORD);
+    append(static_cast<uint32_t>(m_num_named_ids));
+    append(static_cast<uint32_t>(past_last_id - m_num_named_ids));
+    for (; m_num_named_ids < past_last_id; ++m_num_named_ids) {
+        const string& name = get_object_name(m_num_named_ids);
+        append(static_cast<uint32_t>(name.size()));
+        m_buffer.insert(m_buffer.end(), name.begin(), name.end());
+    }
+}
+
+// The values of each field are gathered into a column before they are appended
+void Telemetry::apply_changes(const vector<View_change>& changes) {
+    if (changes.empty()) {
+        return;
+    }
+
+    m_ids.clear();
+    m_fields.clear();
+    m_xs.clear();
+    m_ys.clear();
+    m_healths.clear();
+    m_amounts.clear();
+
+    Object_id_t past_last_id = m_num_named_ids;
+    for (const View_change& change : changes) {
+        past_last_id = std::max(past_last_id, change.id + 1);
+
+        // nothing else matters about an object that is gone
+        const unsigned fields = (change.fields & View_change::GONE) ?
+            static_cast<unsigned>(View_change::GONE) : change.fields;
+        m_ids.push_back(change.id);
+        m_fields.push_back(static_cast<uint8_t>(fields));
+
+        if (fields & View_change::LOCATION) {
+            m_xs.push_back(change.x);
+            m_ys.push_back(change.y);
+        }
+        if (fields & View_change::HEALTH) {
+            m_healths.push_back(change.health);
+        }
+        if (fields & View_change::AMOUNT) {
+            m_amounts.push_back(change.amount);
+        }
+    }
+
+    if (past_last_id > m_num_named_ids) {
+        record_names(past_last_id);
+    }
+
+    begin_record(kCHANGES_RECORD);
+    append(static_cast<uint32_t>(m_ids.size()));
+    append(m_ids);
+    append(m_fields);
+    append(m_xs);
+    append(m_ys);
+    append(m_healths);
+    append(m_amounts);
+    m_num_changes += static_cast<long long>(changes.size());
+
+    if (m_buffer.size() >= kHAND_OVER_SIZE) {
+        hand_over();
+    }
+}
+
+// The ids are interned again from scratch, their names must be recorded again
+void Telemetry::clear() {
+    begin_record(kCLEAR_RECORD);
+    m_num_named_ids = 0;
+}
+
+void Telemetry::do_draw_body(ostream& os) {
+    os << "Telemetry: " << m_num_changes << " changes recorded to " << m_filename;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_write_failed) {
+            os << ", could not write all of them!";
+        }
+    }
+    os << endl;
+}
+
+// The buffer goes to the writer, a spare one takes its place
+void Telemetry::hand_over() {
+    if (m_buffer.empty()) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_chunks.push_back(vector<char>());
+        m_chunks.back().swap(m_buffer);
+        if (!m_spare_chunks.empty()) {
+            m_buffer.swap(m_spare_chunks.back());
+            m_spare_chunks.pop_back();
+        }
+    }
+    m_work_cv.notify_one();
+}
+
+// Writes chunks in the order they were handed over until stopped with none left
+void Telemetry::writer_loop() {
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [this]{ return m_stopping || !m_chunks.empty(); });
+        if (m_chunks.empty()) {
+            break;
+        }
+
+        vector<char> chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+        lock.unlock();
+
+        const bool written = static_cast<bool>(m_file.write(chunk.data(), chunk.size()));
+        chunk.clear();
+
+        lock.lock();
+        if (!written) {
+            m_write_failed = true;
+        }
+        m_spare_chunks.push_back(std::move(chunk));
+    }
+
+    if (!m_file.flush()) {
+        m_write_failed = true;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "View.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+/*
+A Telemetry view shows nothing but the number of changes it has seen. Instead it
+streams the changes to every object's state to a binary file for offline analysis,
+one record per tick, so it asks to be sent the changes after every tick.
+
+The file starts with the magic bytes "P6TELE", the format version and a byte order
+marker as in a snapshot. Records follow, each a tag byte and the time it was made at:
+- names: the first id and the number of ids that follow, then the name of each,
+  written before the first changes to objects with those ids
+- changes: the number of objects that changed, then their ids, then a byte of
+  View_change::Field bits for each, then the x and the y of those whose location
+  changed, the health of those whose health changed and the amount of those whose
+  amount changed, in the order of the ids. Objects that are gone only have GONE set.
+- clear: every object and name seen so far is forgotten, as the world was replaced
+Numbers are 32 bit integers and doubles, strings are their length and characters.
+Ticks jumped over by fast_forward are recorded as one.
+
+Records are encoded on the simulation thread into a buffer, which is handed to a
+writer thread whenever it fills up, so the tick loop never waits for the file.
+*/
+
+class Telemetry : public View {
+public:
+    // Creates filename and writes the header, throws Error if it cannot be written
+    explicit Telemetry(const std::string& filename);
+    // writes out everything recorded so far, then closes the file
+    ~Telemetry();
+
+    // Records the batch of changes as one record
+    void apply_changes(const std::vector<View_change>& changes) override;
+    // Records that everything seen so far is forgotten
+    void clear() override;
+
+    bool wants_every_tick() const override { return true; }
+
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator= (const Telemetry&) = delete;
+    Telemetry(Telemetry&&) = delete;
+    Telemetry& operator= (Telemetry&&) = delete;
+
+private:
+    // Hook for drawing
+    void do_draw_body(std::ostream& os) override;
+
+    // start a record with tag at the current time
+    void begin_record(std::uint8_t tag);
+    // append the bytes of value or values to the buffer
+    template <typename T>
+    void append(const T& value);
+    template <typename T>
+    void append(const std::vector<T>& values);
+    // record the names of the ids from m_num_named_ids up to past_last_id
+    void record_names(Object_id_t past_last_id);
+    // hand the buffer to the writer
+    void hand_over();
+    // loop run by the writer thread
+    void writer_loop();
+
+    std::string               m_filename;
+    std::ofstream             m_file;
+    long long                 m_num_changes;
+    Object_id_t               m_num_named_ids;  // ids whose names were recorded
+
+    // records not yet handed to the writer
+    std::vector<char>         m_buffer;
+    // columns of the changes record being encoded, kept for their capacity
+    std::vector<std::int32_t> m_ids;
+    std::vector<std::uint8_t> m_fields;
+    std::vector<double>       m_xs, m_ys, m_healths, m_amounts;
+
+    std::thread               m_writer;
+    std::mutex                m_mutex;
+    std::condition_variable   m_work_cv;
+    std::deque<std::vector<char>> m_chunks;     // waiting to be written, oldest first
+    std::vector<std::vector<char>> m_spare_chunks; // written out, kept for their capacity
+    bool                      m_write_failed;
+    bool                      m_stopping;
+};
+
+#endif // TELEMETRY_H
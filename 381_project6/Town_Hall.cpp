@@ -1,7 +1,10 @@
 #include "Town_Hall.h"
 #include "Geometry.h"
 #include "Utility.h"
+#include "Snapshot.h"
+#include "Profiler.h"
 #include "Model.h"
+#include "Logistics.h"
 #include <string>
 #include <cmath>
 #include <iostream>
@@ -28,20 +31,30 @@ Town_Hall::~Town_Hall()
 
 // deposit adds in the supplied amount
 void Town_Hall::deposit(double deposit_amount) {
+    PROFILE_COUNT(DEPOSITS);
     m_food_amount += deposit_amount;
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
+    Model::get_instance()->get_logistics().food_added(*this);
+}
+
+// nothing is available while a withdraw would return less than the minimum
+double Town_Hall::get_available_amount() const {
+    const double available = m_food_amount - m_food_amount * kTOWNHALL_TAX_RATE;
+    return available < kTOWNHALL_MIN_WITHDRAW ? 0.0 : available;
 }
 
 // ask model to notify views of current state
 void Town_Hall::broadcast_current_state() const {
     Structure::broadcast_current_state();
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
 }
 
 // Return whichever is less, the request or (the amount on hand - 10%) (a "tax"),
 // but amounts less than 1.0 are not supplied - the amount returned is zero.
 // update the amount on hand by subtracting the amount returned.
 double Town_Hall::withdraw(double amount_to_obtain) {
+    PROFILE_COUNT(WITHDRAWALS);
+
     double return_amount = fmin(amount_to_obtain,
                                 m_food_amount - m_food_amount * kTOWNHALL_TAX_RATE);
 
@@ -52,7 +65,7 @@ double Town_Hall::withdraw(double amount_to_obtain) {
 
     // Reduce amount on hand by amount to be returned
     m_food_amount -= return_amount ;
-    Model::get_instance()->notify_amount(get_name(), m_food_amount);
+    Model::get_instance()->notify_amount(get_id(), m_food_amount);
 
     return return_amount;
 }
@@ -63,3 +76,18 @@ void Town_Hall::describe() const {
     Structure::describe();
     cout << "   Contains " << m_food_amount << endl;
 }
+
+const string& Town_Hall::get_type_string() const {
+    static const string my_type = "Town_Hall";
+    return my_type;
+}
+
+void Town_Hall::save_state(Snapshot_writer& writer) const {
+    Structure::save_state(writer);
+    writer.write_double(m_food_amount);
+}
+
+void Town_Hall::restore_state(Snapshot_reader& reader) {
+    Structure::restore_state(reader);
+    m_food_amount = reader.read_double();
+}
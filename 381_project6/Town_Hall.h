@@ -27,9 +27,19 @@ public:
     // ask model to notify views of current state
     void broadcast_current_state() const override;
 
+    // return string "Town_Hall"
+    const std::string& get_type_string() const override;
+
+    // write the food amount to a snapshot, and read it back
+    void save_state(Snapshot_writer& writer) const override;
+    void restore_state(Snapshot_reader& reader) override;
+
     // output information about the current state
     void describe() const override;
 
+    // the amount a withdraw of everything on hand would return
+    double get_available_amount() const override;
+
     // Return whichever is less, the request or (the amount on hand - 10%) (a "tax"),
     // but amounts less than 1.0 are not supplied - the amount returned is zero.
     // update the amount on hand by subtracting the amount returned.
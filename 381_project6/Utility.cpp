@@ -0,0 +1,25 @@
+#include "Utility.h"
+#include <algorithm>
+
+using std::count;
+using std::streamsize;
+
+
+// count a single character written past the (empty) put area
+Counting_streambuf::int_type Counting_streambuf::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        ++m_char_count;
+        if (traits_type::to_char_type(c) == '\n') {
+            ++m_line_count;
+        }
+    }
+
+    return traits_type::not_eof(c);
+}
+
+// count a block of characters, all of them are always accepted
+streamsize Counting_streambuf::xsputn(const char* s, streamsize n) {
+    m_char_count += n;
+    m_line_count += count(s, s + n, '\n');
+    return n;
+}
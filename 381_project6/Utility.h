@@ -12,6 +12,7 @@
 #include <exception>
 #include <memory>
 #include <map>
+#include <streambuf>
 #include <cassert>
 
 // Forward declarations
@@ -22,6 +23,11 @@ class Sim_object;
 /* Utility declarations, functions, and classes used by other modules */
 /* ################################################################## */
 
+// Dense integer handle the Model interns each Sim_object's name to when the
+// object is added. Handles are never reused, even after the object is removed.
+using Object_id_t = int;
+constexpr Object_id_t kNO_OBJECT_ID = -1;
+
 // a simple class for error exceptions that inherits from std::exception
 class Error : public std::exception {
 public:
@@ -33,4 +39,21 @@ private:
     const std::string msg;
 };
 
+// a stream buffer that discards everything written to it, only counting
+// the characters and lines it was given
+class Counting_streambuf : public std::streambuf {
+public:
+    Counting_streambuf() :
+        m_char_count(0), m_line_count(0)
+        {}
+    long long get_char_count() const noexcept {return m_char_count;}
+    long long get_line_count() const noexcept {return m_line_count;}
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+private:
+    long long m_char_count;
+    long long m_line_count;
+};
+
 #endif // UTILITY_H
@@ -1,31 +1,49 @@
 #include "View.h"
 #include "Geometry.h"
+#include "Model.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 
 using std::string;
-using std::cout; using std::endl;
+using std::vector;
+using std::sort;
+using std::cout;
+using std::ostream; using std::ostringstream;
 using std::ios; using std::streamsize; using std::fixed; using std::setprecision;
+using std::unique_ptr;
 
 namespace {
-    // Object to save and restore cout settings
+    // Object to save and restore a stream's settings
     // Settings saved when object is created then restored when object destroyed
-    class Cout_settings_saver {
+    class Stream_settings_saver {
     public:
         // Save settings
-        Cout_settings_saver() : m_form_flags(cout.flags()), m_old_precision(cout.precision())
+        explicit Stream_settings_saver(ostream& os) :
+            m_os(os), m_form_flags(os.flags()), m_old_precision(os.precision())
         {}
 
         // Restore settings
-        ~Cout_settings_saver() {
-            cout.flags(m_form_flags);
-            cout.precision(m_old_precision);
+        ~Stream_settings_saver() {
+            m_os.flags(m_form_flags);
+            m_os.precision(m_old_precision);
         }
 
     private:
+        ostream& m_os;
         ios::fmtflags m_form_flags;
         streamsize m_old_precision;
     };
+
+    // A frame holding the text the View was drawn as
+    class Text_frame : public View_frame {
+    public:
+        explicit Text_frame(const string& text) : m_text(text) {}
+        void print(ostream& os) const override { os.write(m_text.data(), m_text.size()); }
+    private:
+        string m_text;
+    };
 }
 
 View::View(const string& name)
@@ -37,37 +55,67 @@ View::~View()
 {
 }
 
-void View::update_location(const string& name, const Point& location)
+void View::update_location(Object_id_t id, const Point& location)
 {
 }
 
-void View::update_health(const string& name, double health)
+void View::update_health(Object_id_t id, double health)
 {
 }
 
-void View::update_amount(const string& name, double amount)
+void View::update_amount(Object_id_t id, double amount)
 {
 }
 
-void View::update_remove(const string& name)
+void View::update_remove(Object_id_t id)
 {
 }
 
-void View::do_draw_header()
+void View::apply_changes(const vector<View_change>& changes) {
+    for (const View_change& change : changes) {
+        // nothing else matters about an object that is gone
+        if (change.fields & View_change::GONE) {
+            update_remove(change.id);
+            continue;
+        }
+
+        if (change.fields & View_change::LOCATION) {
+            update_location(change.id, Point(change.x, change.y));
+        }
+        if (change.fields & View_change::HEALTH) {
+            update_health(change.id, change.health);
+        }
+        if (change.fields & View_change::AMOUNT) {
+            update_amount(change.id, change.amount);
+        }
+    }
+}
+
+void View::do_draw_header(ostream& os)
 {
 }
 
 void View::draw() {
+    print(cout);
+}
+
+unique_ptr<View_frame> View::capture() {
+    ostringstream text;
+    print(text);
+    return unique_ptr<View_frame>(new Text_frame(text.str()));
+}
+
+void View::print(ostream& os) {
     // Save previous output settings
-    Cout_settings_saver css;
+    Stream_settings_saver sss(os);
 
     // Display doubles with exactly 2 digits after the decimal point
-    cout << fixed;
-    cout << setprecision(2);
+    os << fixed;
+    os << setprecision(2);
 
     // Hooks for printing View information
-    do_draw_header();
-    do_draw_body();
+    do_draw_header(os);
+    do_draw_body(os);
 
     // Restore previous output settings when function ends
 }
@@ -79,3 +127,14 @@ void View::clear()
 const string& View::get_name() {
     return m_name;
 }
+
+const string& View::get_object_name(Object_id_t id) {
+    return Model::get_instance()->get_name_of(id);
+}
+
+void View::sort_by_object_name(vector<Object_id_t>& ids) {
+    const Model* model_ptr = Model::get_instance();
+    sort(ids.begin(), ids.end(), [model_ptr](Object_id_t lhs, Object_id_t rhs){
+        return model_ptr->get_name_of(lhs) < model_ptr->get_name_of(rhs);
+    });
+}
@@ -1,20 +1,36 @@
 #ifndef VIEW_H
 #define VIEW_H
 
+#include "Utility.h"
 #include <vector>
 #include <string>
-#include <map>
+#include <memory>
+#include <iosfwd>
 
-// Forward declaration
+// Forward declarations
 struct Point;
+struct View_change;
+
+// What a View showed at one moment, copied out of it so that it can be printed
+// later on any thread while the View and the world keep changing
+class View_frame {
+public:
+    virtual ~View_frame() {}
+    // prints the frame exactly as View::draw printed the View when it was captured
+    virtual void print(std::ostream& os) const = 0;
+};
 
 /* *** View class ***
 The View class encapsulates the data and functions needed to generate the map
 display, and control its properties. It has a "memory" for the names and locations
-of the to-be-plotted objects.
+of the to-be-plotted objects. Objects are identified by the ids the Model interned
+their names to, names are only looked up when drawing.
+
+The Model buffers changes and delivers them all at once with apply_changes, which
+makes the individual update calls below.
 
 Usage: 
-1. Call the update_location function with the name and position of each object
+1. Call the update_location function with the id and position of each object
 to be plotted. If the object is not already in the View's memory, it will be added
 along with its location. If it is already present, its location will be set to the 
 supplied location. If a single object changes location, its location can be separately
@@ -22,7 +38,8 @@ updated with a call to update_location.
 2. Call the update_remove function with the name of any object that should no longer
 be plotted. This must be done *after* any call to update_location that 
 has the same object name since update_location will add any object name supplied.
-3. Call the draw function to print out the map. 
+3. Call the draw function to print out the map, or capture to copy what draw would
+print into a frame that can be printed later. 
 4. As needed, change the origin, scale, or displayed size of the map 
 with the appropriate functions. Since the view "remembers" the previously updated
 information, immediately calling the draw function will print out a map showing the previous objects
@@ -37,27 +54,44 @@ public:
 
     virtual ~View();
 
-    // Save the supplied name and location for future use in a draw() call
-    // If the name is already present,the new location replaces the previous one.
-    virtual void update_location(const std::string& name, const Point& location);
-    virtual void update_health(const std::string& name, double health);
-    virtual void update_amount(const std::string& name, double amount);
-    virtual void update_remove(const std::string& name);
+    // Save the supplied id and location for future use in a draw() call
+    // If the id is already present,the new location replaces the previous one.
+    virtual void update_location(Object_id_t id, const Point& location);
+    virtual void update_health(Object_id_t id, double health);
+    virtual void update_amount(Object_id_t id, double amount);
+    virtual void update_remove(Object_id_t id);
     virtual void clear();
 
+    // Apply a batch of changes through the update functions above
+    virtual void apply_changes(const std::vector<View_change>& changes);
+    // Returns true if the View must be sent the changes after every tick, not only
+    // before it is drawn
+    virtual bool wants_every_tick() const { return false; }
+
     // prints out the View information
     void draw();
+    // Returns a frame of what draw would print now. By default the View is drawn into
+    // the frame right away, Views that are costly to print copy what they need instead.
+    virtual std::unique_ptr<View_frame> capture();
 
     // returns the name of the View
     const std::string& get_name();
 
 protected:
-    // hooks called when 'draw' is called, to be defined in derived classes.
-    // draw_header() does nothing in this base class
-    virtual void do_draw_header();
-    virtual void do_draw_body() = 0;
+    // hooks called when 'draw' is called, to be defined in derived classes, that print
+    // to os. draw_header() does nothing in this base class
+    virtual void do_draw_header(std::ostream& os);
+    virtual void do_draw_body(std::ostream& os) = 0;
+
+    // returns the name of the object with id
+    static const std::string& get_object_name(Object_id_t id);
+    // sorts ids by the names of their objects
+    static void sort_by_object_name(std::vector<Object_id_t>& ids);
 
 private:
+    // prints the View to os with doubles shown to 2 decimal places
+    void print(std::ostream& os);
+
     std::string m_name;
 };
 
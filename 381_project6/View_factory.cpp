@@ -5,6 +5,7 @@
 #include "Local_map.h"
 #include "Health_status.h"
 #include "Amount_status.h"
+#include "Telemetry.h"
 #include "Utility.h"
 #include "Model.h"
 #include <memory>
@@ -13,7 +14,7 @@
 using std::string;
 using std::shared_ptr; using std::make_shared;
 
-View_factory_return create_view(const string& name) {
+View_factory_return create_view(const string& name, const string& filename) {
     View_factory_return ret_val;
 
     // Check what type of View user wants
@@ -31,6 +32,10 @@ View_factory_return create_view(const string& name) {
         // create an amount status view that shows the food amounts of Sim_objects
         ret_val.view_ptr = make_shared<Amount_status>();
     }
+    else if (name == "telemetry") {
+        // create a telemetry view that streams every change to the file
+        ret_val.view_ptr = make_shared<Telemetry>(filename);
+    }
     else {
         // Create a local map view centered on a Sim_object that matches the input name,
         // throw an Error if no such object exists
@@ -40,7 +45,7 @@ View_factory_return create_view(const string& name) {
             throw Error("No object of that name!");
         }
 
-        ret_val.view_ptr = make_shared<Local_map>(obj_ptr->get_name());
+        ret_val.view_ptr = make_shared<Local_map>(obj_ptr->get_name(), obj_ptr->get_id());
     }
 
     return ret_val;
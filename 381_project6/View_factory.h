@@ -12,6 +12,9 @@ struct View_factory_return {
     std::weak_ptr<World_map> world_map_ptr;
 };
 
-View_factory_return create_view(const std::string& name);
+// Creates the View called name, a local map if name is that of an object. A
+// telemetry View writes to the file filename, which no other View needs.
+// Throws Error if there is no such View or the file cannot be written.
+View_factory_return create_view(const std::string& name, const std::string& filename = "");
 
 #endif // VIEW_FACTORY_H
@@ -0,0 +1,120 @@
+#include "Worker_pool.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cassert>
+
+using std::size_t;
+using std::mutex; using std::unique_lock; using std::lock_guard;
+
+// More threads than this per core only add switching overhead
+constexpr int kMAX_THREADS_PER_CORE = 4;
+
+Worker_pool::Worker_pool(int num_threads_)
+    : mp_task(nullptr), m_count(0), m_generation(0), m_pending(0), m_stopping(false)
+{
+    assert(num_threads_ >= 1);
+    if (num_threads_ > get_max_threads()) {
+        throw Error("Too many threads!");
+    }
+
+    // chunk 0 is always run by the calling thread, threads already started
+    // must be joined if starting another one fails
+    try {
+        for (int i = 1; i < num_threads_; ++i) {
+            m_threads.emplace_back(&Worker_pool::worker_loop, this, i);
+        }
+    }
+    catch (...) {
+        stop_workers();
+        throw;
+    }
+}
+
+Worker_pool::~Worker_pool() {
+    stop_workers();
+}
+
+int Worker_pool::get_max_threads() {
+    return kMAX_THREADS_PER_CORE * std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void Worker_pool::stop_workers() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_cv.notify_all();
+
+    for (std::thread& t : m_threads) {
+        t.join();
+    }
+}
+
+void Worker_pool::parallel_for(size_t count, const Task_t& task) {
+    if (count == 0) {
+        return;
+    }
+
+    // Not worth waking anyone for a single thread
+    if (m_threads.empty()) {
+        task(0, count);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        mp_task = &task;
+        m_count = count;
+        m_pending = static_cast<int>(m_threads.size());
+        ++m_generation;
+    }
+    m_work_cv.notify_all();
+
+    run_chunk(0);
+
+    // Wait for the workers to finish their chunks
+    unique_lock<mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]{ return m_pending == 0; });
+    mp_task = nullptr;
+}
+
+void Worker_pool::worker_loop(int chunk_index_) {
+    unsigned seen_generation = 0;
+
+    while (true) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_work_cv.wait(lock, [this, seen_generation]{
+                return m_stopping || m_generation != seen_generation;
+            });
+
+            if (m_stopping) {
+                return;
+            }
+            seen_generation = m_generation;
+        }
+
+        run_chunk(chunk_index_);
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_done_cv.notify_one();
+    }
+}
+
+// Chunks are as even as possible, the first (count % threads) chunks get one extra item
+void Worker_pool::run_chunk(int chunk_index_) {
+    const size_t num_chunks = static_cast<size_t>(get_num_threads());
+    const size_t chunk = static_cast<size_t>(chunk_index_);
+    const size_t base_size = m_count / num_chunks;
+    const size_t extra = m_count % num_chunks;
+
+    const size_t begin = chunk * base_size + (chunk < extra ? chunk : extra);
+    const size_t end = begin + base_size + (chunk < extra ? 1 : 0);
+
+    if (begin < end) {
+        (*mp_task)(begin, end);
+    }
+}
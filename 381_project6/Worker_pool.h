@@ -0,0 +1,67 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+/*
+Worker_pool is a fixed set of threads used to split a loop over many independent
+items across all cores. The threads are created once and sleep between loops.
+The thread that calls parallel_for() takes part in the work, so a pool of one
+thread runs everything on the calling thread.
+*/
+
+class Worker_pool {
+public:
+    using Task_t = std::function<void(std::size_t begin, std::size_t end)>;
+
+    // num_threads_ is the total number of threads that share each loop,
+    // including the calling thread, and must be at least one.
+    // Throws Error if num_threads_ is more than get_max_threads().
+    explicit Worker_pool(int num_threads_);
+    // stops and joins the worker threads
+    ~Worker_pool();
+
+    int get_num_threads() const { return static_cast<int>(m_threads.size()) + 1; }
+
+    // the most threads a pool may have, a small multiple of the number of cores
+    static int get_max_threads();
+
+    // Calls task(begin, end) on contiguous chunks that together cover [0, count),
+    // one chunk per thread, and returns when every chunk is done. Chunks run
+    // concurrently so task must only write state that belongs to its own items,
+    // and must not throw.
+    void parallel_for(std::size_t count, const Task_t& task);
+
+    // disallow copy/move construction or assignment
+    Worker_pool(const Worker_pool&) = delete;
+    Worker_pool& operator= (const Worker_pool&) = delete;
+    Worker_pool(Worker_pool&&) = delete;
+    Worker_pool& operator= (Worker_pool&&) = delete;
+
+private:
+    // tell the worker threads to stop and join them
+    void stop_workers();
+    // loop run by each worker thread, chunk_index_ selects its chunk of each loop
+    void worker_loop(int chunk_index_);
+    // run chunk_index_'s share of the current loop
+    void run_chunk(int chunk_index_);
+
+    std::vector<std::thread> m_threads;
+    std::mutex               m_mutex;
+    std::condition_variable  m_work_cv;
+    std::condition_variable  m_done_cv;
+
+    // the loop currently being worked on
+    const Task_t*            mp_task;
+    std::size_t              m_count;
+    unsigned                 m_generation;  // incremented for every new loop
+    int                      m_pending;     // worker chunks not yet finished
+    bool                     m_stopping;
+};
+
+#endif // WORKER_POOL_H
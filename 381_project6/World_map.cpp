@@ -4,7 +4,7 @@
 #include <iostream>
 
 using std::string;
-using std::cout; using std::endl;
+using std::ostream; using std::endl;
 
 // default World_map settings
 constexpr double kDEFAULT_MAP_SCALE = 2.0;
@@ -22,23 +22,41 @@ World_map::World_map(const string& name)
 {
 }
 
-void World_map::do_draw_header() {
+void World_map::do_draw_header(ostream& os) {
     // Print current Map settings
-    cout << "Display size: " << m_size
+    os << "Display size: " << m_size
          << ", scale: " << m_scale
-         << ", origin: " << get_origin() << endl;
+         << ", origin: " << get_origin();
+    // the default detail is not mentioned
+    switch (get_detail()) {
+    case Detail::NAMES:
+        break;
+    case Detail::COUNTS:
+        os << ", detail: counts";
+        break;
+    case Detail::DENSITY:
+        os << ", detail: density";
+        break;
+    }
+    os << endl;
 }
 
-void World_map::do_draw_body() {
-    Grid_info grid_info = generate_grid_info();
+void World_map::do_draw_body(ostream& os) {
+    update_frame();
 
-    // Print offgrid objects message if any
-    if (!grid_info.m_offgrid_objs.empty()) {
-        print_offgrid_helper(grid_info.m_offgrid_objs);
+    // Print offgrid objects message if any, objects are only named at full detail
+    if (get_detail() != Detail::NAMES) {
+        print_offgrid_summary(os);
+    }
+    else {
+        const Offgrid_objs_t& offgrid_objs = get_offgrid_objs();
+        if (!offgrid_objs.empty()) {
+            print_offgrid_helper(os, offgrid_objs);
+        }
     }
 
     // Print the objects that are on the grid
-    print_grid_helper(grid_info.m_grid);
+    print_grid_helper(os);
 }
 
 void World_map::set_origin(const Point& origin) {
@@ -55,6 +73,7 @@ void World_map::set_size(int size_) {
     }
 
     m_size = size_;
+    invalidate_layout();
 }
 
 void World_map::set_scale(double scale_) {
@@ -64,12 +83,19 @@ void World_map::set_scale(double scale_) {
     }
 
     m_scale = scale_;
+    invalidate_layout();
+}
+
+void World_map::set_detail(Detail detail) {
+    Map::set_detail(detail);
 }
 
 void World_map::set_defaults() {
     set_origin(Point(kDEFAULT_MAP_ORIGINX, kDEFAULT_MAP_ORIGINY));
+    Map::set_detail(Detail::NAMES);
     m_scale = kDEFAULT_MAP_SCALE;
     m_size = kDEFAULT_MAP_SIZE;
+    invalidate_layout();
 }
 
 double World_map::get_scale() const {
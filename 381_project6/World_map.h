@@ -10,7 +10,9 @@
     A World_map shows a large area of the world. It keeps track of all objects that
     have reported a location and displays information about the whereabouts of 
     those objects. Objects outside the visible area of the World_map will be
-    reported as such.
+    reported as such. At less detail than names, the cells show how many objects are
+    in them and the objects outside are summed up by direction, so a World_map of any
+    number of objects is drawn in the same time and space.
 */
 class World_map : public Map {
 public:
@@ -27,6 +29,9 @@ public:
     // If scale is not postive, will throw Error("New map scale must be positive!");
     void set_scale(double scale_);
 
+    // show cells by names, counts or density glyphs, see Map::Detail
+    void set_detail(Detail detail);
+
     // set the parameters to the default values
     void set_defaults();
 
@@ -37,8 +42,8 @@ public:
     World_map& operator= (World_map&&) = delete;
 
 private:
-    void do_draw_header() override;
-    void do_draw_body() override;
+    void do_draw_header(std::ostream& os) override;
+    void do_draw_body(std::ostream& os) override;
 
     double get_scale() const override;
     int get_size() const override;
@@ -0,0 +1,305 @@
+/*
+Benchmark driver. Generates a scenario (see Scenario_generator.h), then times
+Model::update, drawing every open View as the show command does, and
+Model::describe, and prints one line of results as CSV or JSON.
+Everything the simulation itself prints is discarded while it runs.
+
+usage: p6bench [--agents N] [--structures M] [--layout uniform|clustered|lattice]
+               [--seed S] [--ticks T] [--local-maps K]
+               [--tick-mode sequential|batched|parallel] [--threads P]
+               [--format csv|json] [--header]
+--structures defaults to a tenth of the agents, --header only prints the CSV header.
+*/
+
+#include "Model.h"
+#include "View.h"
+#include "View_factory.h"
+#include "Scenario_generator.h"
+#include "Utility.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <exception>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace std;
+
+struct Bench_options {
+    Scenario_settings scenario;
+    int               ticks = 10;
+    int               local_maps = 10;
+    Model::Tick_mode  tick_mode = Model::Tick_mode::SEQUENTIAL;
+    int               threads = 1;
+    bool              json = false;
+    bool              header_only = false;
+};
+
+// Results of one benchmark run, times are in seconds
+struct Bench_results {
+    double setup_time = 0.0;
+    double update_time = 0.0;
+    double show_time = 0.0;
+    double describe_time = 0.0;
+    long long agent_updates = 0;
+    long long rss_growth_kb = 0;
+};
+
+static const char* const kCSV_HEADER =
+    "agents,structures,layout,seed,ticks,tick_mode,threads,setup_s,update_ms_per_tick,"
+    "ticks_per_sec,agent_updates_per_sec,show_ms,describe_ms,peak_rss_growth_kb,bytes_per_agent";
+
+static void print_usage() {
+    cerr << "usage: p6bench [--agents N] [--structures M] [--layout uniform|clustered|lattice]\n"
+         << "               [--seed S] [--ticks T] [--local-maps K]\n"
+         << "               [--tick-mode sequential|batched|parallel] [--threads P]\n"
+         << "               [--format csv|json] [--header]" << endl;
+}
+
+// returns the integer in arg, throws Error if it is not a non-negative integer
+static int parse_count(const string& arg) {
+    size_t used = 0;
+    int value = -1;
+    try {
+        value = stoi(arg, &used);
+    }
+    catch (exception&) {
+    }
+
+    if (used != arg.size() || value < 0) {
+        throw Error("Expected a non-negative integer!");
+    }
+    return value;
+}
+
+static const char* get_tick_mode_name(Model::Tick_mode mode) {
+    switch (mode) {
+    case Model::Tick_mode::SEQUENTIAL:
+        return "sequential";
+    case Model::Tick_mode::BATCHED:
+        return "batched";
+    case Model::Tick_mode::PARALLEL:
+        return "parallel";
+    default:
+        throw Error("Unrecognized tick mode!");
+    }
+}
+
+// Fill options from the command line, throws Error on anything unrecognized
+static Bench_options parse_options(int argc, char* argv[]) {
+    Bench_options options;
+    bool structures_given = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const string option = argv[i];
+        if (option == "--header") {
+            options.header_only = true;
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            throw Error("Missing value for " + option);
+        }
+        const string value = argv[++i];
+
+        if (option == "--agents") {
+            options.scenario.num_agents = parse_count(value);
+        }
+        else if (option == "--structures") {
+            options.scenario.num_structures = parse_count(value);
+            structures_given = true;
+        }
+        else if (option == "--layout") {
+            options.scenario.layout = parse_scenario_layout(value);
+        }
+        else if (option == "--seed") {
+            options.scenario.seed = static_cast<unsigned>(parse_count(value));
+        }
+        else if (option == "--ticks") {
+            options.ticks = parse_count(value);
+        }
+        else if (option == "--local-maps") {
+            options.local_maps = parse_count(value);
+        }
+        else if (option == "--tick-mode") {
+            if (value == "sequential") {
+                options.tick_mode = Model::Tick_mode::SEQUENTIAL;
+            }
+            else if (value == "batched") {
+                options.tick_mode = Model::Tick_mode::BATCHED;
+            }
+            else if (value == "parallel") {
+                options.tick_mode = Model::Tick_mode::PARALLEL;
+            }
+            else {
+                throw Error("Unknown tick mode " + value);
+            }
+        }
+        else if (option == "--threads") {
+            options.threads = parse_count(value);
+            if (options.threads < 1) {
+                throw Error("Need at least one thread!");
+            }
+        }
+        else if (option == "--format") {
+            if (value != "csv" && value != "json") {
+                throw Error("Unknown format " + value);
+            }
+            options.json = (value == "json");
+        }
+        else {
+            throw Error("Unknown option " + option);
+        }
+    }
+
+    if (!structures_given) {
+        options.scenario.num_structures = max(2, options.scenario.num_agents / 10);
+    }
+
+    return options;
+}
+
+// returns the peak resident set size of the process so far, in kilobytes
+static long long get_peak_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Generate the scenario and time each part of the simulation
+static Bench_results run_bench(const Bench_options& options) {
+    Bench_results results;
+    Model* model_ptr = Model::get_instance();
+    model_ptr->set_tick_mode(options.tick_mode, options.threads);
+
+    const long long start_rss_kb = get_peak_rss_kb();
+    auto start = chrono::steady_clock::now();
+    generate_scenario(options.scenario);
+    results.setup_time = seconds_since(start);
+
+    // The views a user would have open: the map, both status views, and
+    // local maps of the first few Agents
+    vector<shared_ptr<View>> views;
+    views.push_back(create_view("map").view_ptr);
+    views.push_back(create_view("health").view_ptr);
+    views.push_back(create_view("amounts").view_ptr);
+    for (int i = 0; i < options.local_maps && i < options.scenario.num_agents; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "a%07d", i);
+        views.push_back(create_view(name).view_ptr);
+    }
+    for (auto& view_ptr : views) {
+        model_ptr->attach(view_ptr);
+    }
+
+    const long long start_agent_updates = model_ptr->get_agent_update_count();
+    for (int tick = 0; tick < options.ticks; ++tick) {
+        start = chrono::steady_clock::now();
+        model_ptr->update();
+        results.update_time += seconds_since(start);
+
+        // the same work as the show command
+        start = chrono::steady_clock::now();
+        model_ptr->flush_view_changes();
+        for (auto& view_ptr : views) {
+            view_ptr->draw();
+        }
+        results.show_time += seconds_since(start);
+    }
+    results.agent_updates = model_ptr->get_agent_update_count() - start_agent_updates;
+
+    start = chrono::steady_clock::now();
+    model_ptr->describe();
+    results.describe_time = seconds_since(start);
+
+    results.rss_growth_kb = get_peak_rss_kb() - start_rss_kb;
+    return results;
+}
+
+static void print_results(ostream& os, const Bench_options& options, const Bench_results& results) {
+    const Scenario_settings& scenario = options.scenario;
+    const double ticks = options.ticks;
+    const double update_ms_per_tick = ticks > 0 ? 1000.0 * results.update_time / ticks : 0.0;
+    const double ticks_per_sec = results.update_time > 0.0 ? ticks / results.update_time : 0.0;
+    const double updates_per_sec = results.update_time > 0.0 ?
+                                   results.agent_updates / results.update_time : 0.0;
+    const double show_ms = ticks > 0 ? 1000.0 * results.show_time / ticks : 0.0;
+    const double describe_ms = 1000.0 * results.describe_time;
+    const double bytes_per_agent = scenario.num_agents > 0 ?
+                                   1024.0 * results.rss_growth_kb / scenario.num_agents : 0.0;
+
+    os.setf(ios::fixed, ios::floatfield);
+    os.precision(3);
+
+    if (!options.json) {
+        os << scenario.num_agents << ',' << scenario.num_structures << ','
+           << get_scenario_layout_name(scenario.layout) << ',' << scenario.seed << ','
+           << options.ticks << ',' << get_tick_mode_name(options.tick_mode) << ','
+           << options.threads << ',' << results.setup_time << ',' << update_ms_per_tick << ','
+           << ticks_per_sec << ',' << updates_per_sec << ',' << show_ms << ','
+           << describe_ms << ',' << results.rss_growth_kb << ',' << bytes_per_agent << endl;
+        return;
+    }
+
+    os << "{\"agents\": " << scenario.num_agents
+       << ", \"structures\": " << scenario.num_structures
+       << ", \"layout\": \"" << get_scenario_layout_name(scenario.layout) << '"'
+       << ", \"seed\": " << scenario.seed
+       << ", \"ticks\": " << options.ticks
+       << ", \"tick_mode\": \"" << get_tick_mode_name(options.tick_mode) << '"'
+       << ", \"threads\": " << options.threads
+       << ", \"setup_s\": " << results.setup_time
+       << ", \"update_ms_per_tick\": " << update_ms_per_tick
+       << ", \"ticks_per_sec\": " << ticks_per_sec
+       << ", \"agent_updates_per_sec\": " << updates_per_sec
+       << ", \"show_ms\": " << show_ms
+       << ", \"describe_ms\": " << describe_ms
+       << ", \"peak_rss_growth_kb\": " << results.rss_growth_kb
+       << ", \"bytes_per_agent\": " << bytes_per_agent << '}' << endl;
+}
+
+int main(int argc, char* argv[]) {
+    Bench_options options;
+    try {
+        options = parse_options(argc, argv);
+    }
+    catch (Error& e) {
+        cerr << e.what() << endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.header_only) {
+        cout << kCSV_HEADER << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Results go to the real standard output, the simulation's chatter goes nowhere
+    ostream results_out(cout.rdbuf());
+    Counting_streambuf discarded;
+    cout.rdbuf(&discarded);
+
+    // simulation output is formatted the way the program's main sets it up
+    cout.setf(ios::fixed, ios::floatfield);
+    cout.precision(2);
+
+    int exit_status = EXIT_SUCCESS;
+    try {
+        print_results(results_out, options, run_bench(options));
+    }
+    catch (exception& e) {
+        cerr << e.what() << endl;
+        exit_status = EXIT_FAILURE;
+    }
+
+    // The Model outlives main, give it back the real standard output
+    cout.rdbuf(results_out.rdbuf());
+    return exit_status;
+}
@@ -3,12 +3,17 @@ Main module. Your project must use this file as-is
 */
 
 #include <iostream>
+#include <string>
 #include "Controller.h"
 
 using namespace std;
 
-// The main function simply creates the Controller object and tells it to run. 
-int main ()
+// The main function simply creates the Controller object and tells it to run.
+// "p6exe --headless [script]" runs the commands in script (or standard input)
+// without prompts or per-object output and reports how fast the simulation ran.
+// "p6exe --record journal" records the session to journal, "p6exe --replay journal
+// [--verify]" replays one headless, checking every tick against it if asked.
+int main (int argc, char* argv[])
 {
     // Set output to show two decimal places
     //cout << fixed << setprecision(2) << endl;
@@ -18,5 +23,23 @@ int main ()
     // create the Controller object and go
     Controller controller;
 
-    controller.run();
+    if (argc > 1 && string(argv[1]) == "--headless") {
+        controller.run_headless(argc > 2 ? argv[2] : "");
+    }
+    else if (argc > 2 && string(argv[1]) == "--replay") {
+        controller.run_replay(argv[2], argc > 3 && string(argv[3]) == "--verify");
+    }
+    else if (argc > 2 && string(argv[1]) == "--record") {
+        try {
+            controller.start_recording(argv[2]);
+        }
+        catch (exception& e) {
+            cout << e.what() << endl;
+            return 1;
+        }
+        controller.run();
+    }
+    else {
+        controller.run();
+    }
 }